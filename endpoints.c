@@ -57,6 +57,7 @@
 
 #include "utils.h"
 #include "endpoints.h"
+#include "routes.h"
 
 #if PLATFORM_EQ(PLATFORM_BSD)
 # if PLATFORM_LT(PLATFORM_BSD, PLATFORM_BSDOS)
@@ -64,25 +65,129 @@ extern char *strdup(const char *);
 # endif
 #endif
 
+/*
+ * Endpoints live in two places.  The list keeps them in registration order
+ * (newest first) for anything that walks them; the rest find them by name.
+ *
+ * Built-in names are resolved through the generated `route_table', which
+ * maps each to a slot of its own, so a lookup is one hash and one compare.
+ * Anything else goes into a table using open addressing with linear
+ * probing, kept at most half full.
+ */
 endpoint_t *endpoints = NULL;
 
+static endpoint_t  *builtin_endpoints[ROUTE_MAX];
+static router_t     endpoint_router    = { NULL };
+static endpoint_t **endpoint_table = NULL;
+static size_t       table_size     = 0;
+static size_t       table_count    = 0;
+
+#define TABLE_MIN_SIZE  16
+
+/*
+ * Slot holding `name', or the empty slot where it would go.
+ */
+static
+size_t
+table_slot(endpoint_t    **table,
+           size_t          size,
+           const char     *name,
+           unsigned long   hash)
+{
+  size_t mask = size - 1;
+  size_t i    = hash & mask;
+
+  while (table[i] != NULL) {
+    if (table[i]->hash == hash && strcmp(table[i]->name, name) == 0) {
+      break;
+    }
+
+    i = (i + 1) & mask;
+  }
+
+  return i;
+}
+
+static
+void
+table_grow(void)
+{
+  endpoint_t **table = NULL;
+  size_t       size  = table_size ? table_size * 2 : TABLE_MIN_SIZE;
+  size_t       i     = 0;
+
+  table = xcalloc(size, sizeof(endpoint_t *));
+
+  for (i = 0; i < table_size; i++) {
+    if (endpoint_table[i] != NULL) {
+      table[table_slot(table,
+                       size,
+                       endpoint_table[i]->name,
+                       endpoint_table[i]->hash)] = endpoint_table[i];
+    }
+  }
+
+  MAYBE_FREE(endpoint_table);
+
+  endpoint_table = table;
+  table_size     = size;
+}
+
 void
 endpoint_init(void)
 {
   endpoints = NULL;
+
+  memset(builtin_endpoints, 0, sizeof(builtin_endpoints));
+  router_init(&endpoint_router);
+
+  MAYBE_FREE(endpoint_table);
+  table_size  = 0;
+  table_count = 0;
 }
 
 endpoint_t *
 endpoint_create(const char *name, const void *instance)
 {
-  endpoint_t *node = xmalloc(sizeof(endpoint_t));
+  endpoint_t **where   = NULL;
+  endpoint_t  *node    = xmalloc(sizeof(endpoint_t));
+  route_t      route   = endpoint_route(name);
+  size_t       slot    = 0;
+  char        *pattern = NULL;
 
-  node->hash     = pjw_hash(name);
+  node->hash     = str_hash(name);
   node->name     = strdup(name);
   node->instance = instance;
   node->next     = NULL;
   node->prev     = NULL;
 
+  if (route != ROUTE_NONE) {
+    where = &builtin_endpoints[route];
+  } else {
+    if ((table_count + 1) * 2 > table_size) {
+      table_grow();
+    }
+
+    slot  = table_slot(endpoint_table, table_size, node->name, node->hash);
+    where = &endpoint_table[slot];
+
+    if (*where == NULL) {
+      table_count++;
+    }
+  }
+
+  /* A later registration under the same name takes over lookups. */
+  if (*where != NULL) {
+    syslog(LOG_WARNING, "Endpoint %s registered twice", name);
+  }
+
+  *where = node;
+
+  pattern = xmalloc(strlen(name) + sizeof("/*" ENDPOINT_MEMBER_PARAM));
+  sprintf(pattern, "%s/*%s", name, ENDPOINT_MEMBER_PARAM);
+  endpoint_add_route(node, pattern);
+  free(pattern);
+
   if (endpoints == NULL) {
     endpoints = node;
     goto out;
@@ -96,21 +201,65 @@ out:
   return node;
 }
 
+/*
+ * The built-in route `name' names, or ROUTE_NONE.
+ */
+route_t
+endpoint_route(const char *name)
+{
+  const route_entry_t *entry = NULL;
+
+  entry = &route_table[str_hash_seeded(name, ROUTE_SEED) & ROUTE_MASK];
+
+  if (entry->name != NULL && strcmp(entry->name, name) == 0) {
+    return entry->route;
+  }
+
+  return ROUTE_NONE;
+}
+
+endpoint_t *
+endpoint_builtin(route_t route)
+{
+  return (route == ROUTE_NONE) ? NULL : builtin_endpoints[route];
+}
+
 endpoint_t *
 endpoint_find(const char *name)
 {
-  unsigned long  hash = pjw_hash(name);
-  endpoint_t    *node = endpoints;
+  route_t route = endpoint_route(name);
 
-  while (node != NULL) {
-    if (node->hash == hash) {
-      return node;
-    }
+  if (route != ROUTE_NONE) {
+    return builtin_endpoints[route];
+  }
 
-    node = node->next;
+  if (table_count == 0) {
+    return NULL;
   }
 
-  return NULL;
+  return endpoint_table[table_slot(endpoint_table,
+                                   table_size,
+                                   name,
+                                   str_hash(name))];
+}
+
+/*
+ * Have `node' answer to paths matching `pattern' as well; see router.h for
+ * the syntax.  Parameters are handed to the module's `serve'.
+ */
+void
+endpoint_add_route(endpoint_t *node, const char *pattern)
+{
+  router_add(&endpoint_router, pattern, node);
+}
+
+/*
+ * The endpoint whose pattern matches `path', or NULL.
+ */
+endpoint_t *
+endpoint_match(const char *path, route_match_t *match)
+{
+  return (endpoint_t *)router_match(&endpoint_router, path, match);
 }
 
 void
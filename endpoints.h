@@ -50,17 +50,45 @@
 
 #include <sys/types.h>
 
+#include "router.h"
+
+/*
+ * Every endpoint `name' also answers to `name/<member path>', with the
+ * member path captured under this parameter name.
+ */
+#define ENDPOINT_MEMBER_PARAM  "member"
+
 typedef struct endpoint_s {
   struct endpoint_s *prev;              /* Next in list. */
   struct endpoint_s *next;              /* Previous in list. */
-  unsigned long      hash;              /* Hash of name for lookup. */
+  unsigned long      hash;              /* `str_hash' of name. */
   const char        *name;              /* Name string. */
   const void        *instance;          /* Instance of handler. */
 } endpoint_t;
 
+/*
+ * Built-in routes, as listed in modules.def.
+ */
+typedef enum {
+  ROUTE_NONE = -1,
+#define SM_MODULE(__name, __init) ROUTE_##__name,
+#define SM_ROUTE(__name)          ROUTE_##__name,
+#include "modules.def"
+  ROUTE_MAX
+} route_t;
+
+typedef struct {
+  const char *name;
+  route_t     route;
+} route_entry_t;
+
 void        endpoint_init(void);
 endpoint_t *endpoint_create(const char *name, const void *instance);
 endpoint_t *endpoint_find(const char *name);
+route_t     endpoint_route(const char *name);
+endpoint_t *endpoint_builtin(route_t route);
+void        endpoint_add_route(endpoint_t *node, const char *pattern);
+endpoint_t *endpoint_match(const char *path, route_match_t *match);
 void        endpoint_traverse(void (*callback)(const void *));
 
 #define endpoint_foreach(i) \
@@ -122,12 +122,13 @@ extern int  select();
 # endif
 #endif
 
-static int    nfiles;
-static long   nwatches;
-static int   *fd_rw;
-static void **fd_data;
-static int    nreturned;
-static int    next_ridx;
+static int                nfiles;
+static long               nwatches;
+static int               *fd_rw;
+static void             **fd_data;
+static fdwatch_handler_t *fd_handler;
+static int                nreturned;
+static int                next_ridx;
 
 #if defined(HAVE_KQUEUE)
 
@@ -234,11 +235,13 @@ fdwatch_get_nfiles(void)
 #endif
 
   nwatches = 0;
-  fd_rw    = xmalloc(sizeof(int) * nfiles);
-  fd_data  = xmalloc(sizeof(void *) * nfiles);
+  fd_rw      = xmalloc(sizeof(int) * nfiles);
+  fd_data    = xmalloc(sizeof(void *) * nfiles);
+  fd_handler = xmalloc(sizeof(fdwatch_handler_t) * nfiles);
 
   for (i = 0; i < nfiles; ++i) {
-    fd_rw[i] = -1;
+    fd_rw[i]      = -1;
+    fd_handler[i] = NULL;
   }
 
   if (INIT(nfiles) == -1) {
@@ -257,8 +260,27 @@ fdwatch_add_fd(int fd, void *client_data, int rw)
   }
 
   ADD_FD(fd, rw);
-  fd_rw[fd]   = rw;
-  fd_data[fd] = client_data;
+  fd_rw[fd]      = rw;
+  fd_data[fd]    = client_data;
+  fd_handler[fd] = NULL;
+}
+
+/*
+ * Watch `fd' on behalf of something other than the HTTP server, such as a
+ * module waiting on kernel events.  `handler' is run from
+ * `fdwatch_get_next_client_data' when `fd' is ready.
+ */
+void
+fdwatch_add_handler(int               fd,
+                    int               rw,
+                    fdwatch_handler_t handler,
+                    void             *client_data)
+{
+  fdwatch_add_fd(fd, client_data, rw);
+
+  if (fd >= 0 && fd < nfiles && fd_rw[fd] == rw) {
+    fd_handler[fd] = handler;
+  }
 }
 
 void
@@ -270,8 +292,9 @@ fdwatch_del_fd(int fd)
   }
 
   DEL_FD(fd);
-  fd_rw[fd]   = -1;
-  fd_data[fd] = NULL;
+  fd_rw[fd]      = -1;
+  fd_data[fd]    = NULL;
+  fd_handler[fd] = NULL;
 }
 
 int
@@ -310,6 +333,12 @@ fdwatch_get_next_client_data(void)
     return NULL;
   }
 
+  /* Not ours to hand back; deal with it here. */
+  if (fd_handler[fd] != NULL) {
+    (fd_handler[fd])(fd, fd_data[fd]);
+    return NULL;
+  }
+
   return fd_data[fd];
 }
 
@@ -527,6 +556,7 @@ devpoll_add_fd(int fd, int rw)
   switch (rw) {
     case FDW_READ:  dpevents[ndpevents].events = POLLIN;  break;
     case FDW_WRITE: dpevents[ndpevents].events = POLLOUT; break;
+    case FDW_PRI:   dpevents[ndpevents].events = POLLPRI; break;
     default:                                              break;
   }
 
@@ -608,6 +638,9 @@ devpoll_check_fd(int fd)
     case FDW_WRITE:
       return dprevents[ridx].events & (POLLOUT | POLLHUP | POLLNVAL);
 
+    case FDW_PRI:
+      return dprevents[ridx].events & (POLLPRI | POLLHUP | POLLNVAL);
+
     default:
       return 0;
   }
@@ -667,6 +700,7 @@ poll_add_fd(int fd, int rw)
   switch (rw) {
     case FDW_READ:  pollfds[npoll_fds].events = POLLIN;  break;
     case FDW_WRITE: pollfds[npoll_fds].events = POLLOUT; break;
+    case FDW_PRI:   pollfds[npoll_fds].events = POLLPRI; break;
     default:                                             break;
   }
 
@@ -705,7 +739,8 @@ poll_watch(long tmout)
   }
 
   for (i = 0; i < npoll_fds; ++i) {
-    if (pollfds[i].revents & (POLLIN | POLLOUT | POLLERR | POLLHUP | POLLNVAL))
+    if (pollfds[i].revents &
+        (POLLIN | POLLOUT | POLLPRI | POLLERR | POLLHUP | POLLNVAL))
     {
       poll_rfdidx[ridx++] = pollfds[i].fd;
       if (ridx == r) {
@@ -739,6 +774,9 @@ poll_check_fd(int fd)
     case FDW_WRITE:
       return pollfds[fdidx].revents & (POLLOUT | POLLHUP | POLLNVAL);
 
+    case FDW_PRI:
+      return pollfds[fdidx].revents & (POLLPRI | POLLHUP | POLLNVAL);
+
     default:
       return 0;
   }
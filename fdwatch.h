@@ -51,13 +51,24 @@
 
 #define FDW_READ  0
 #define FDW_WRITE 1
+#define FDW_PRI   2                     /* Priority events; poll(2) only. */
 
 #ifndef INFTIM
 # define INFTIM -1
 #endif
 
+/*
+ * Called for a descriptor added with `fdwatch_add_handler' when it is
+ * ready, instead of it being handed back by `fdwatch_get_next_client_data'.
+ */
+typedef void (*fdwatch_handler_t)(int fd, void *client_data);
+
 int   fdwatch_get_nfiles(void);
 void  fdwatch_add_fd(int fd, void *client_data, int rw);
+void  fdwatch_add_handler(int               fd,
+                          int               rw,
+                          fdwatch_handler_t handler,
+                          void             *client_data);
 void  fdwatch_del_fd(int fd);
 int   fdwatch(long timeout_msecs);
 int   fdwatch_check_fd(int fd);
@@ -90,6 +90,7 @@ extern       sleep();
 extern       perror();
 extern       time();
 extern       fcntl();
+extern double strtod();
 typedef int socklen_t;
 #  ifndef EXIT_FAILURE
 #   define EXIT_FAILURE 1
@@ -426,8 +427,8 @@ send_response(http_conn_t *conn,
               char        *extraheads,
               char        *form)
 {
-  json_node_t *obj = json_mkobject();
-  char        *json       = NULL;
+  json_node_t *obj  = json_arena_mkroot(JSON_OBJECT);
+  char        *json = NULL;
 
   send_mime(conn,
             status,
@@ -437,13 +438,17 @@ send_response(http_conn_t *conn,
             -1,
             0);
 
-  json_prepend_member(obj, "path",    json_mkstring(conn->decoded_url));
-  json_prepend_member(obj, "content", json_mkstring(form));
-  json_prepend_member(obj, "title",   json_mkstring(title));
-  json_prepend_member(obj, "status",  json_mknumber(status));
+  json_prepend_member(obj, "path",    json_arena_mkstring(obj,
+                                                          conn->decoded_url));
+  json_prepend_member(obj, "content", json_arena_mkstring(obj, form));
+  json_prepend_member(obj, "title",   json_arena_mkstring(obj, title));
+  json_prepend_member(obj, "status",  json_arena_mkint64(obj, status));
 
   json = json_stringify(obj, NULL);
   add_response(conn, json);
+
+  free(json);
+  json_delete(obj);
 }
 
 httpd_t *
@@ -501,6 +506,11 @@ httpd_get_conn(httpd_t *hs, int fd, http_conn_t *conn)
     conn->max_query       = 0;
     conn->max_path        = 0;
     conn->max_decoded_url = 0;
+    conn->data_iov        = NULL;
+    conn->max_data_iov    = 0;
+
+    json_writer_init(&conn->body);
+    json_index_init(&conn->index);
 
     httpd_realloc_str(&conn->read_buf,    &conn->read_size,       500);
     httpd_realloc_str(&conn->decoded_url, &conn->max_decoded_url, 2);
@@ -560,7 +570,9 @@ httpd_get_conn(httpd_t *hs, int fd, http_conn_t *conn)
   conn->path[0]        = '\0';
   conn->hdrhost        = "";
   conn->mime_flag      = 1;
+  conn->encoding       = SM_ENCODING_JSON;
   conn->data_address   = NULL;
+  conn->data_iovcnt    = 0;
 
   memset(&conn->client_addr, 0, sizeof(conn->client_addr));
   memmove(&conn->client_addr, &sa, sockaddr_len(&sa));
@@ -800,6 +812,89 @@ httpd_method_str(int method)
   }
 }
 
+/*
+ * Media types we can answer with.  The first entry for an encoding is the
+ * one sent back as the Content-Type.
+ */
+static const struct {
+  const char    *type;
+  sm_encoding_t  encoding;
+} media_types[] = {
+  { "application/json",        SM_ENCODING_JSON    },
+  { "application/cbor",        SM_ENCODING_CBOR    },
+  { "application/msgpack",     SM_ENCODING_MSGPACK },
+  { "application/x-msgpack",   SM_ENCODING_MSGPACK },
+  { "application/vnd.msgpack", SM_ENCODING_MSGPACK },
+  { NULL,                      SM_ENCODING_JSON    }
+};
+
+static
+char *
+media_type(int encoding)
+{
+  int i = 0;
+
+  for (i = 0; media_types[i].type != NULL; i++) {
+    if ((int)media_types[i].encoding == encoding) {
+      return (char *)media_types[i].type;
+    }
+  }
+
+  return "application/json";
+}
+
+/*
+ * Pick a response encoding from the value of an Accept header.  The first
+ * listed type we can produce wins unless it carries `q=0'; other q-values
+ * are not weighed.  Anything else, wildcards included, means JSON.
+ */
+static
+int
+parse_accept(const char *cp)
+{
+  const char *name = NULL;
+  size_t      len  = 0;
+  int         q0   = 0;
+  int         i    = 0;
+
+  while (*cp != '\0') {
+    cp   += strspn(cp, " \t,");
+    name  = cp;
+    len   = strcspn(cp, ",;");
+    cp   += len;
+
+    while (len > 0 && (name[len - 1] == ' ' || name[len - 1] == '\t')) {
+      len--;
+    }
+
+    q0 = 0;
+    while (*cp == ';') {
+      cp++;
+      cp += strspn(cp, " \t");
+
+      if ((cp[0] == 'q' || cp[0] == 'Q') && cp[1] == '=') {
+        q0 = (strtod(&cp[2], NULL) == 0.0);
+      }
+
+      cp += strcspn(cp, ",;");
+    }
+
+    if (q0 || len == 0) {
+      continue;
+    }
+
+    for (i = 0; media_types[i].type != NULL; i++) {
+      if (strlen(media_types[i].type) == len &&
+          strncasecmp(name, media_types[i].type, len) == 0)
+      {
+        return media_types[i].encoding;
+      }
+    }
+  }
+
+  return SM_ENCODING_JSON;
+}
+
 int
 httpd_parse_request(http_conn_t *conn)
 {
@@ -950,6 +1045,8 @@ httpd_parse_request(http_conn_t *conn)
           httpd_send_err(conn, 400, err400title, "", err400form);
           return -1;
         }
+      } else if (strncasecmp(buf, "Accept:", 7) == 0) {
+        conn->encoding = parse_accept(&buf[7]);
       }
     }
   }
@@ -964,17 +1061,283 @@ httpd_parse_request(http_conn_t *conn)
   return 0;
 }
 
+/* {{{ Field selection: */
+
+#define SEL_WHOLE  1                    /* Member is sent as it is. */
+#define SEL_PART   2                    /* Some members below it are sent. */
+
+static const char strFields[] = "fields=";
+
+/*
+ * Append `len' bytes at `base' to the gathered body.
+ */
+static
+size_t
+add_slice(http_conn_t *conn, const char *base, size_t len)
+{
+  struct iovec *last = NULL;
+
+  if (conn->data_iovcnt > 0) {
+    last = &conn->data_iov[conn->data_iovcnt - 1];
+
+    if ((const char *)last->iov_base + last->iov_len == base) {
+      last->iov_len += len;
+      return len;
+    }
+  }
+
+  if (conn->data_iovcnt == conn->max_data_iov) {
+    conn->max_data_iov = conn->max_data_iov ? conn->max_data_iov * 2 : 16;
+    conn->data_iov     = xrealloc(conn->data_iov,
+                                  conn->max_data_iov * sizeof(struct iovec));
+  }
+
+  conn->data_iov[conn->data_iovcnt].iov_base = (void *)base;
+  conn->data_iov[conn->data_iovcnt].iov_len  = len;
+  conn->data_iovcnt++;
+
+  return len;
+}
+
+/*
+ * Gather an object holding the marked members below `parent'.  Returns the
+ * number of bytes added.
+ */
+static
+size_t
+add_selection(http_conn_t        *conn,
+              const json_index_t *index,
+              const char         *marks,
+              int                 parent)
+{
+  const json_member_t *m     = NULL;
+  const char          *json  = index->json;
+  size_t               total = 0;
+  bool                 first = true;
+  int                  i     = 0;
+
+  total += add_slice(conn, "{", 1);
+
+  for (i = (parent < 0) ? 0 : parent + 1; i < index->count; i++) {
+    m = &index->members[i];
+
+    if (parent >= 0 && m->key >= index->members[parent].end) {
+      break;
+    }
+
+    if (m->parent != parent || marks[i] == 0) {
+      continue;
+    }
+
+    if (!first) {
+      total += add_slice(conn, ",", 1);
+    }
+    first = false;
+
+    if (marks[i] == SEL_WHOLE) {
+      total += add_slice(conn, json + m->key, m->end - m->key);
+    } else {
+      total += add_slice(conn, json + m->key, m->value - m->key);
+      total += add_selection(conn, index, marks, i);
+    }
+  }
+
+  total += add_slice(conn, "}", 1);
+
+  return total;
+}
+
+/*
+ * Return the decoded value of the `fields' query parameter, or NULL.  The
+ * caller frees it.
+ */
+static
+char *
+query_fields(const char *query)
+{
+  const char *cp  = query;
+  char       *ret = NULL;
+  size_t      len = 0;
+
+  while (cp != NULL && *cp != '\0') {
+    if (strncmp(cp, strFields, sizeof(strFields) - 1) == 0) {
+      cp  += sizeof(strFields) - 1;
+      len  = strcspn(cp, "&");
+      ret  = xmalloc(len + 1);
+
+      memcpy(ret, cp, len);
+      ret[len] = '\0';
+      strdecode(ret, ret);
+
+      return ret;
+    }
+
+    cp = strchr(cp, '&');
+    if (cp != NULL) {
+      cp++;
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Answer with part of the `length' byte document described by `index': the
+ * member named by `subpath' (`cpu/numOnline' style) and, within it, only
+ * the comma-separated dotted `fields', which is taken apart in place.  The
+ * body is gathered straight from the document.  Returns the body length,
+ * or -1 if `subpath' names nothing.
+ */
+static
+off_t
+select_fields(http_conn_t        *conn,
+              const json_index_t *index,
+              size_t              length,
+              const char         *subpath,
+              char               *fields)
+{
+  const json_member_t *m     = NULL;
+  char                *marks = NULL;
+  char                *field = NULL;
+  char                *next  = NULL;
+  off_t                total = 0;
+  int                  root  = -1;
+  int                  i     = 0;
+
+  if (index == NULL) {
+    return -1;
+  }
+
+  root = json_index_lookup(index, -1, subpath, '/');
+  if (root < 0 && subpath[strspn(subpath, "/")] != '\0') {
+    return -1;
+  }
+
+  conn->data_address = (char *)index->json;
+
+  if (root >= 0) {
+    m = &index->members[root];
+
+    if (fields == NULL || index->json[m->value] != '{') {
+      add_slice(conn, index->json + m->value, m->end - m->value);
+      return m->end - m->value;
+    }
+  }
+
+  if (fields == NULL) {
+    add_slice(conn, index->json, length);
+    return length;
+  }
+
+  marks = xcalloc(index->count ? index->count : 1, 1);
+
+  for (field = fields; field != NULL; field = next) {
+    next = strchr(field, ',');
+    if (next != NULL) {
+      *next++ = '\0';
+    }
+
+    i = json_index_lookup(index, root, field, '.');
+    if (i < 0 || i == root) {
+      continue;
+    }
+
+    marks[i] = SEL_WHOLE;
+
+    for (i = index->members[i].parent;
+         i != root;
+         i = index->members[i].parent)
+    {
+      if (marks[i] == 0) {
+        marks[i] = SEL_PART;
+      }
+    }
+  }
+
+  total = add_selection(conn, index, marks, root);
+
+  free(marks);
+
+  return total;
+}
+
+/* }}} */
+
+#define SERVE_DECLINED  1
+
+/*
+ * Answer a request that matched one of a module's own routes, such as
+ * `cpu/:core', by letting the module write the body in the encoding asked
+ * for.  Returns SERVE_DECLINED, having sent nothing, if the module has no
+ * such thing; `cpu/usage' is a member of `cpu', not a core.
+ */
+static
+int
+serve_request(http_conn_t         *conn,
+              sm_base_t           *inst,
+              const route_match_t *match,
+              char                *fields,
+              struct timeval      *tv)
+{
+  int    encoding = (fields != NULL) ? SM_ENCODING_JSON : conn->encoding;
+  size_t length   = 0;
+  off_t  selected = 0;
+
+  json_writer_reset(&conn->body);
+  json_writer_set_format(&conn->body, (json_format_t)encoding);
+
+  if (inst->vtab->serve == NULL ||
+      !(inst->vtab->serve)(inst, match, &conn->body))
+  {
+    return SERVE_DECLINED;
+  }
+
+  conn->data_address = json_writer_finish(&conn->body);
+  length             = json_writer_length(&conn->body);
+
+  /* Parts of a document are only ever sent as JSON. */
+  if (fields != NULL) {
+    if (!json_index_build(&conn->index, conn->data_address, length)) {
+      httpd_send_err(conn, 500, err500title, "", err500form);
+      return -1;
+    }
+
+    selected = select_fields(conn, &conn->index, length, "", fields);
+    length   = (selected < 0) ? 0 : (size_t)selected;
+  }
+
+  send_mime(conn,
+            200,
+            ok200title,
+            "",
+            "Vary: Accept\015\012",
+            media_type(encoding),
+            length,
+            tv->tv_sec);
+  return 0;
+}
+
 static
 int
 really_start_request(http_conn_t *conn, struct timeval *tv)
 {
-  endpoint_t  *node      = NULL;
-  sm_base_t   *inst      = NULL;
+  endpoint_t          *node      = NULL;
+  sm_base_t           *inst      = NULL;
+  size_t               length    = 0;
+  off_t                selected  = 0;
+  int                  served    = 0;
+  const char          *subpath   = NULL;
+  char                *fields    = NULL;
+  route_t              route     = ROUTE_NONE;
+  route_match_t        match;
+  const route_param_t *member    = NULL;
 #ifdef DEBUG
-  char         buf[1024] = {0};
-  time_t       now       = 0;
+  char                 buf[1024] = {0};
+  time_t               now       = 0;
 #endif
 
+  match.nparams = 0;
+
   if (conn->method != HTTP_METHOD_GET  &&
       conn->method != HTTP_METHOD_HEAD &&
       conn->method != HTTP_METHOD_POST)
@@ -998,7 +1361,9 @@ really_start_request(http_conn_t *conn, struct timeval *tv)
   fprintf(stderr, "  Header host:  %s\n", conn->hdrhost);
 #endif
 
-  if ((strcmp(conn->path, "die")) == 0) {
+  route = endpoint_route(conn->path);
+
+  if (route == ROUTE_die) {
       extern void terminate_app(void);
 
       httpd_send_err(conn, 200, ok200title, "", "OK");
@@ -1008,7 +1373,7 @@ really_start_request(http_conn_t *conn, struct timeval *tv)
       return 0;
   }
 #ifdef DEBUG
-  else if ((strcmp(conn->path, "derp")) == 0) {
+  else if (route == ROUTE_derp) {
     extern void dump_data(void);
 
     httpd_send_err(conn, 200, ok200title, "", "OK");
@@ -1018,7 +1383,17 @@ really_start_request(http_conn_t *conn, struct timeval *tv)
   }
 #endif
 
-  node = endpoint_find(conn->path);
+  if (route != ROUTE_NONE) {
+    node = endpoint_builtin(route);
+  } else {
+    node = endpoint_find(conn->path);
+  }
+
+  /* Not a plain name, so perhaps `cpu/3' or `all/cpu'. */
+  if (node == NULL) {
+    node = endpoint_match(conn->path, &match);
+  }
+
   if (node == NULL) {
     syslog(LOG_ERR, "Could not find route for %s", conn->path);
     httpd_send_err(conn, 404, err404title, "", err404form);
@@ -1036,7 +1411,51 @@ really_start_request(http_conn_t *conn, struct timeval *tv)
     generate_json(inst);
   }
 
-  conn->data_address = inst->vtab->json_buffer;
+  fields = query_fields(conn->query);
+
+  member = route_param(&match, ENDPOINT_MEMBER_PARAM);
+  if (member != NULL) {
+    subpath = member->value;
+  } else if (match.nparams > 0) {
+    served = serve_request(conn, inst, &match, fields, tv);
+
+    if (served != SERVE_DECLINED) {
+      MAYBE_FREE(fields);
+      return served;
+    }
+
+    /* Not one of the module's own; try it as a member instead. */
+    subpath  = conn->path + strlen(node->name);
+    subpath += strspn(subpath, "/");
+  }
+
+  /* Parts of a document are only ever sent as JSON. */
+  if (subpath != NULL || fields != NULL) {
+    selected = select_fields(conn,
+                             index_json(inst),
+                             inst->vtab->json_length,
+                             (subpath != NULL) ? subpath : "",
+                             fields);
+    MAYBE_FREE(fields);
+
+    if (selected < 0) {
+      conn->data_iovcnt = 0;
+      httpd_send_err(conn, 404, err404title, "", err404form);
+      return -1;
+    }
+
+    send_mime(conn,
+              200,
+              ok200title,
+              "",
+              "Vary: Accept\015\012",
+              media_type(SM_ENCODING_JSON),
+              selected,
+              tv->tv_sec);
+    return 0;
+  }
+
+  conn->data_address = (char *)encode_json(inst, conn->encoding, &length);
 
   if (conn->data_address == NULL) {
     syslog(LOG_ERR, "Conversion to JSON failed for route %s", conn->path);
@@ -1048,9 +1467,11 @@ really_start_request(http_conn_t *conn, struct timeval *tv)
             200,
             ok200title,
             "",
-            "",
-            "application/json",
-            inst->vtab->json_length,
+            "Vary: Accept\015\012",
+            (inst->vtab->content_type != NULL
+             ? (char *)inst->vtab->content_type
+             : media_type(conn->encoding)),
+            length,
             tv->tv_sec);
   return 0;
 }
@@ -1088,6 +1509,9 @@ httpd_destroy_conn(http_conn_t *conn)
     MAYBE_FREE(conn->query);
     MAYBE_FREE(conn->response);
     MAYBE_FREE(conn->path);
+    MAYBE_FREE(conn->data_iov);
+    json_writer_free(&conn->body);
+    json_index_free(&conn->index);
 
     conn->read_buf     = NULL;
     conn->data_address = NULL;
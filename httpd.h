@@ -51,6 +51,7 @@
 
 #include <sys/types.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -92,7 +93,13 @@ typedef struct {
   char        *query;
   char        *response;
   char        *data_address;
+  struct iovec *data_iov;       /* If any, the body is gathered from these. */
+  int          data_iovcnt;
+  int          max_data_iov;
+  json_writer_t body;           /* Body written per request, if any. */
+  json_index_t index;           /* Members of `body', for `fields'. */
   int          mime_flag;
+  int          encoding;        /* SM_ENCODING_* from Accept. */
   size_t       response_len;
   size_t       max_query;
   size_t       max_reqhost;
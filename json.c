@@ -63,6 +63,12 @@
 
 #include "utils.h"
 
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
 #if PLATFORM_LT(PLATFORM_BSD, PLATFORM_BSDOS)
 extern char   *strdup();
 # if PLATFORM_LT(PLATFORM_BSD, PLATFORM_ULTRIX)
@@ -168,24 +174,6 @@ utf8_validate_cz(const char *s)
   }
 }
 
-/* Validate a null-terminated UTF-8 string. */
-static
-bool
-utf8_validate(const char *s)
-{
-  int len = 0;
-  
-  for (; *s != 0; s += len) {
-    len = utf8_validate_cz(s);
-
-    if (len == 0) {
-      return false;
-    }
-  }
-  
-  return true;
-}
-
 /*
  * Read a single UTF-8 character starting at @s,
  * returning the length, in bytes, of the character read.
@@ -280,11 +268,121 @@ to_surrogate_pair(uchar_t unicode, uint16_t *uc, uint16_t *lc)
   *lc = (n & 0x3FF) | 0xDC00;
 }
 
-typedef struct {
-  char *cur;
-  char *end;
-  char *start;
-} SB;
+/* {{{ Arenas: */
+
+/*
+ * Size of a regular arena block.  Requests larger than a quarter of this get
+ * a block of their own so that they do not strand the tail of the current
+ * one.
+ */
+#define ARENA_BLOCK_SIZE  4096
+
+typedef union {
+  double  d;
+  long    l;
+  void   *p;
+} arena_align_t;
+
+typedef struct arena_block_s {
+  struct arena_block_s *next;
+  size_t                size;
+  size_t                used;
+  arena_align_t         data[1];
+} arena_block_t;
+
+struct json_arena_s {
+  arena_block_t *blocks;                /* Current block first. */
+  json_node_t   *root;                  /* First node allocated; the owner. */
+};
+
+static
+json_arena_t *
+arena_new(void)
+{
+  json_arena_t *arena = xmalloc(sizeof(json_arena_t));
+
+  arena->blocks = NULL;
+  arena->root   = NULL;
+
+  return arena;
+}
+
+static
+arena_block_t *
+arena_block(size_t size)
+{
+  arena_block_t *blk = NULL;
+
+  blk       = xmalloc(offsetof(arena_block_t, data) + size);
+  blk->size = size;
+  blk->used = 0;
+  blk->next = NULL;
+
+  return blk;
+}
+
+static
+void *
+arena_alloc(json_arena_t *arena, size_t n)
+{
+  arena_block_t *blk = arena->blocks;
+  char          *ret = NULL;
+
+  n = (n + sizeof(arena_align_t) - 1) & ~(sizeof(arena_align_t) - 1);
+
+  if (blk == NULL || blk->size - blk->used < n) {
+    if (blk != NULL && n > ARENA_BLOCK_SIZE / 4) {
+      /* Oversized: chain it behind the current block. */
+      arena_block_t *big = arena_block(n);
+
+      big->used = n;
+      big->next = blk->next;
+      blk->next = big;
+
+      return big->data;
+    }
+
+    blk           = arena_block(MAX(ARENA_BLOCK_SIZE, n));
+    blk->next     = arena->blocks;
+    arena->blocks = blk;
+  }
+
+  ret        = (char *)blk->data + blk->used;
+  blk->used += n;
+
+  return ret;
+}
+
+static
+char *
+arena_strdup(json_arena_t *arena, const char *str)
+{
+  size_t  len = strlen(str) + 1;
+  char   *ret = arena_alloc(arena, len);
+
+  memcpy(ret, str, len);
+
+  return ret;
+}
+
+static
+void
+arena_free(json_arena_t *arena)
+{
+  arena_block_t *blk  = arena->blocks;
+  arena_block_t *next = NULL;
+
+  for (; blk != NULL; blk = next) {
+    next = blk->next;
+    free(blk);
+  }
+
+  free(arena);
+}
+
+/* }}} */
+
+typedef json_buf_t SB;
 
 static
 void
@@ -359,6 +457,499 @@ sb_free(SB *sb)
   sb->start = NULL;
 }
 
+/* {{{ Number formatting: */
+
+#ifndef UINT64_C
+# define UINT64_C(__c)  __UINT64_C(__c)
+#endif
+
+/* Largest magnitude below which every integer is exact in a double. */
+#define DOUBLE_EXACT_INT  9007199254740992.0
+
+static const char digit_pairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static
+int
+count_digits(uint64_t v)
+{
+  int n = 1;
+
+  for (;;) {
+    if (v < 10)    { return n;     }
+    if (v < 100)   { return n + 1; }
+    if (v < 1000)  { return n + 2; }
+    if (v < 10000) { return n + 3; }
+
+    v /= 10000;
+    n += 4;
+  }
+}
+
+/*
+ * Write @v in decimal to @out, two digits per division, filling from the
+ * least significant end.  Returns the number of characters written; no
+ * terminator is added.
+ */
+static
+int
+format_uint64(uint64_t v, char *out)
+{
+  int       len = count_digits(v);
+  char     *p   = out + len;
+  unsigned  idx = 0;
+
+  while (v >= 100) {
+    idx  = (unsigned)(v % 100) * 2;
+    v   /= 100;
+
+    *--p = digit_pairs[idx + 1];
+    *--p = digit_pairs[idx];
+  }
+
+  if (v >= 10) {
+    idx  = (unsigned)v * 2;
+    *--p = digit_pairs[idx + 1];
+    *--p = digit_pairs[idx];
+  } else {
+    *--p = (char)('0' + v);
+  }
+
+  return len;
+}
+
+static
+int
+format_int64(int64_t v, char *out)
+{
+  if (v < 0) {
+    *out = '-';
+    return 1 + format_uint64((uint64_t)0 - (uint64_t)v, out + 1);
+  }
+
+  return format_uint64((uint64_t)v, out);
+}
+
+/*
+ * Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers", PLDI 2010).  Produces the shortest digit string
+ * that reads back as the same double in all but a vanishing fraction of
+ * cases, and always one that round-trips.
+ */
+
+typedef struct {
+  uint64_t f;
+  int      e;
+} diy_fp_t;
+
+#define DP_SIGNIFICAND_SIZE  52
+#define DP_EXPONENT_BIAS     (0x3FF + DP_SIGNIFICAND_SIZE)
+#define DP_MIN_EXPONENT      (-DP_EXPONENT_BIAS)
+#define DP_EXPONENT_MASK     UINT64_C(0x7FF0000000000000)
+#define DP_SIGNIFICAND_MASK  UINT64_C(0x000FFFFFFFFFFFFF)
+#define DP_HIDDEN_BIT        UINT64_C(0x0010000000000000)
+
+/* Normalised 64-bit significands of 1e-348, 1e-340, ..., 1e340. */
+static const struct {
+  uint64_t f;
+  int      e;
+} cached_powers[] = {
+  { UINT64_C(0xfa8fd5a0081c0288), -1220 },   /* 1e-348 */
+  { UINT64_C(0xbaaee17fa23ebf76), -1193 },   /* 1e-340 */
+  { UINT64_C(0x8b16fb203055ac76), -1166 },   /* 1e-332 */
+  { UINT64_C(0xcf42894a5dce35ea), -1140 },   /* 1e-324 */
+  { UINT64_C(0x9a6bb0aa55653b2d), -1113 },   /* 1e-316 */
+  { UINT64_C(0xe61acf033d1a45df), -1087 },   /* 1e-308 */
+  { UINT64_C(0xab70fe17c79ac6ca), -1060 },   /* 1e-300 */
+  { UINT64_C(0xff77b1fcbebcdc4f), -1034 },   /* 1e-292 */
+  { UINT64_C(0xbe5691ef416bd60c), -1007 },   /* 1e-284 */
+  { UINT64_C(0x8dd01fad907ffc3c),  -980 },   /* 1e-276 */
+  { UINT64_C(0xd3515c2831559a83),  -954 },   /* 1e-268 */
+  { UINT64_C(0x9d71ac8fada6c9b5),  -927 },   /* 1e-260 */
+  { UINT64_C(0xea9c227723ee8bcb),  -901 },   /* 1e-252 */
+  { UINT64_C(0xaecc49914078536d),  -874 },   /* 1e-244 */
+  { UINT64_C(0x823c12795db6ce57),  -847 },   /* 1e-236 */
+  { UINT64_C(0xc21094364dfb5637),  -821 },   /* 1e-228 */
+  { UINT64_C(0x9096ea6f3848984f),  -794 },   /* 1e-220 */
+  { UINT64_C(0xd77485cb25823ac7),  -768 },   /* 1e-212 */
+  { UINT64_C(0xa086cfcd97bf97f4),  -741 },   /* 1e-204 */
+  { UINT64_C(0xef340a98172aace5),  -715 },   /* 1e-196 */
+  { UINT64_C(0xb23867fb2a35b28e),  -688 },   /* 1e-188 */
+  { UINT64_C(0x84c8d4dfd2c63f3b),  -661 },   /* 1e-180 */
+  { UINT64_C(0xc5dd44271ad3cdba),  -635 },   /* 1e-172 */
+  { UINT64_C(0x936b9fcebb25c996),  -608 },   /* 1e-164 */
+  { UINT64_C(0xdbac6c247d62a584),  -582 },   /* 1e-156 */
+  { UINT64_C(0xa3ab66580d5fdaf6),  -555 },   /* 1e-148 */
+  { UINT64_C(0xf3e2f893dec3f126),  -529 },   /* 1e-140 */
+  { UINT64_C(0xb5b5ada8aaff80b8),  -502 },   /* 1e-132 */
+  { UINT64_C(0x87625f056c7c4a8b),  -475 },   /* 1e-124 */
+  { UINT64_C(0xc9bcff6034c13053),  -449 },   /* 1e-116 */
+  { UINT64_C(0x964e858c91ba2655),  -422 },   /* 1e-108 */
+  { UINT64_C(0xdff9772470297ebd),  -396 },   /* 1e-100 */
+  { UINT64_C(0xa6dfbd9fb8e5b88f),  -369 },   /* 1e-92 */
+  { UINT64_C(0xf8a95fcf88747d94),  -343 },   /* 1e-84 */
+  { UINT64_C(0xb94470938fa89bcf),  -316 },   /* 1e-76 */
+  { UINT64_C(0x8a08f0f8bf0f156b),  -289 },   /* 1e-68 */
+  { UINT64_C(0xcdb02555653131b6),  -263 },   /* 1e-60 */
+  { UINT64_C(0x993fe2c6d07b7fac),  -236 },   /* 1e-52 */
+  { UINT64_C(0xe45c10c42a2b3b06),  -210 },   /* 1e-44 */
+  { UINT64_C(0xaa242499697392d3),  -183 },   /* 1e-36 */
+  { UINT64_C(0xfd87b5f28300ca0e),  -157 },   /* 1e-28 */
+  { UINT64_C(0xbce5086492111aeb),  -130 },   /* 1e-20 */
+  { UINT64_C(0x8cbccc096f5088cc),  -103 },   /* 1e-12 */
+  { UINT64_C(0xd1b71758e219652c),   -77 },   /* 1e-4 */
+  { UINT64_C(0x9c40000000000000),   -50 },   /* 1e4 */
+  { UINT64_C(0xe8d4a51000000000),   -24 },   /* 1e12 */
+  { UINT64_C(0xad78ebc5ac620000),     3 },   /* 1e20 */
+  { UINT64_C(0x813f3978f8940984),    30 },   /* 1e28 */
+  { UINT64_C(0xc097ce7bc90715b3),    56 },   /* 1e36 */
+  { UINT64_C(0x8f7e32ce7bea5c70),    83 },   /* 1e44 */
+  { UINT64_C(0xd5d238a4abe98068),   109 },   /* 1e52 */
+  { UINT64_C(0x9f4f2726179a2245),   136 },   /* 1e60 */
+  { UINT64_C(0xed63a231d4c4fb27),   162 },   /* 1e68 */
+  { UINT64_C(0xb0de65388cc8ada8),   189 },   /* 1e76 */
+  { UINT64_C(0x83c7088e1aab65db),   216 },   /* 1e84 */
+  { UINT64_C(0xc45d1df942711d9a),   242 },   /* 1e92 */
+  { UINT64_C(0x924d692ca61be758),   269 },   /* 1e100 */
+  { UINT64_C(0xda01ee641a708dea),   295 },   /* 1e108 */
+  { UINT64_C(0xa26da3999aef774a),   322 },   /* 1e116 */
+  { UINT64_C(0xf209787bb47d6b85),   348 },   /* 1e124 */
+  { UINT64_C(0xb454e4a179dd1877),   375 },   /* 1e132 */
+  { UINT64_C(0x865b86925b9bc5c2),   402 },   /* 1e140 */
+  { UINT64_C(0xc83553c5c8965d3d),   428 },   /* 1e148 */
+  { UINT64_C(0x952ab45cfa97a0b3),   455 },   /* 1e156 */
+  { UINT64_C(0xde469fbd99a05fe3),   481 },   /* 1e164 */
+  { UINT64_C(0xa59bc234db398c25),   508 },   /* 1e172 */
+  { UINT64_C(0xf6c69a72a3989f5c),   534 },   /* 1e180 */
+  { UINT64_C(0xb7dcbf5354e9bece),   561 },   /* 1e188 */
+  { UINT64_C(0x88fcf317f22241e2),   588 },   /* 1e196 */
+  { UINT64_C(0xcc20ce9bd35c78a5),   614 },   /* 1e204 */
+  { UINT64_C(0x98165af37b2153df),   641 },   /* 1e212 */
+  { UINT64_C(0xe2a0b5dc971f303a),   667 },   /* 1e220 */
+  { UINT64_C(0xa8d9d1535ce3b396),   694 },   /* 1e228 */
+  { UINT64_C(0xfb9b7cd9a4a7443c),   720 },   /* 1e236 */
+  { UINT64_C(0xbb764c4ca7a44410),   747 },   /* 1e244 */
+  { UINT64_C(0x8bab8eefb6409c1a),   774 },   /* 1e252 */
+  { UINT64_C(0xd01fef10a657842c),   800 },   /* 1e260 */
+  { UINT64_C(0x9b10a4e5e9913129),   827 },   /* 1e268 */
+  { UINT64_C(0xe7109bfba19c0c9d),   853 },   /* 1e276 */
+  { UINT64_C(0xac2820d9623bf429),   880 },   /* 1e284 */
+  { UINT64_C(0x80444b5e7aa7cf85),   907 },   /* 1e292 */
+  { UINT64_C(0xbf21e44003acdd2d),   933 },   /* 1e300 */
+  { UINT64_C(0x8e679c2f5e44ff8f),   960 },   /* 1e308 */
+  { UINT64_C(0xd433179d9c8cb841),   986 },   /* 1e316 */
+  { UINT64_C(0x9e19db92b4e31ba9),  1013 },   /* 1e324 */
+  { UINT64_C(0xeb96bf6ebadf77d9),  1039 },   /* 1e332 */
+  { UINT64_C(0xaf87023b9bf0ee6b),  1066 },   /* 1e340 */
+};
+
+static
+diy_fp_t
+diy_fp_from_double(double d)
+{
+  diy_fp_t ret;
+  uint64_t bits = 0;
+  int      be   = 0;
+
+  memcpy(&bits, &d, sizeof(bits));
+
+  be = (int)((bits & DP_EXPONENT_MASK) >> DP_SIGNIFICAND_SIZE);
+
+  if (be != 0) {
+    ret.f = (bits & DP_SIGNIFICAND_MASK) + DP_HIDDEN_BIT;
+    ret.e = be - DP_EXPONENT_BIAS;
+  } else {
+    ret.f = bits & DP_SIGNIFICAND_MASK;
+    ret.e = DP_MIN_EXPONENT + 1;
+  }
+
+  return ret;
+}
+
+static
+diy_fp_t
+diy_fp_mul(diy_fp_t x, diy_fp_t y)
+{
+  const uint64_t M32 = UINT64_C(0xFFFFFFFF);
+  uint64_t       a   = x.f >> 32;
+  uint64_t       b   = x.f & M32;
+  uint64_t       c   = y.f >> 32;
+  uint64_t       d   = y.f & M32;
+  uint64_t       ac  = a * c;
+  uint64_t       bc  = b * c;
+  uint64_t       ad  = a * d;
+  uint64_t       bd  = b * d;
+  uint64_t       tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+  diy_fp_t       ret;
+
+  tmp   += UINT64_C(1) << 31;           /* Round. */
+  ret.f  = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+  ret.e  = x.e + y.e + 64;
+
+  return ret;
+}
+
+static
+diy_fp_t
+diy_fp_normalize(diy_fp_t x)
+{
+  while ((x.f & (UINT64_C(1) << 63)) == 0) {
+    x.f <<= 1;
+    x.e--;
+  }
+
+  return x;
+}
+
+static
+void
+diy_fp_boundaries(diy_fp_t v, diy_fp_t *minus, diy_fp_t *plus)
+{
+  diy_fp_t pl;
+  diy_fp_t mi;
+
+  pl.f = (v.f << 1) + 1;
+  pl.e = v.e - 1;
+  pl   = diy_fp_normalize(pl);
+
+  if (v.f == DP_HIDDEN_BIT) {
+    mi.f = (v.f << 2) - 1;
+    mi.e = v.e - 2;
+  } else {
+    mi.f = (v.f << 1) - 1;
+    mi.e = v.e - 1;
+  }
+
+  mi.f <<= mi.e - pl.e;
+  mi.e   = pl.e;
+
+  *minus = mi;
+  *plus  = pl;
+}
+
+static
+diy_fp_t
+cached_power(int e, int *k)
+{
+  diy_fp_t ret;
+  double   dk  = (-61 - e) * 0.30102999566398114 + 347;
+  int      ik  = (int)dk;
+  unsigned idx = 0;
+
+  if (dk - ik > 0.0) {
+    ik++;
+  }
+
+  idx   = (unsigned)(ik >> 3) + 1;
+  *k    = -(-348 + (int)idx * 8);
+  ret.f = cached_powers[idx].f;
+  ret.e = cached_powers[idx].e;
+
+  return ret;
+}
+
+static
+void
+grisu_round(char     *buf,
+            int       len,
+            uint64_t  delta,
+            uint64_t  rest,
+            uint64_t  ten_kappa,
+            uint64_t  wp_w)
+{
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w ||
+          wp_w - rest > rest + ten_kappa - wp_w))
+  {
+    buf[len - 1]--;
+    rest += ten_kappa;
+  }
+}
+
+static
+void
+grisu_digits(diy_fp_t  w,
+             diy_fp_t  mp,
+             uint64_t  delta,
+             char     *buf,
+             int      *len,
+             int      *k)
+{
+  static const uint32_t pow10[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    1000000000
+  };
+  int      shift = -mp.e;
+  uint64_t one   = UINT64_C(1) << shift;
+  uint64_t wp_w  = mp.f - w.f;
+  uint32_t p1    = (uint32_t)(mp.f >> shift);
+  uint64_t p2    = mp.f & (one - 1);
+  int      kappa = count_digits(p1);
+  uint64_t tmp   = 0;
+  uint32_t d     = 0;
+
+  *len = 0;
+
+  while (kappa > 0) {
+    d   = p1 / pow10[kappa - 1];
+    p1 %= pow10[kappa - 1];
+
+    if (d != 0 || *len != 0) {
+      buf[(*len)++] = (char)('0' + d);
+    }
+
+    kappa--;
+    tmp = ((uint64_t)p1 << shift) + p2;
+
+    if (tmp <= delta) {
+      *k += kappa;
+      grisu_round(buf, *len, delta, tmp,
+                  (uint64_t)pow10[kappa] << shift, wp_w);
+      return;
+    }
+  }
+
+  for (;;) {
+    p2    *= 10;
+    delta *= 10;
+    d      = (uint32_t)(p2 >> shift);
+
+    if (d != 0 || *len != 0) {
+      buf[(*len)++] = (char)('0' + d);
+    }
+
+    p2 &= one - 1;
+    kappa--;
+
+    if (p2 < delta) {
+      *k += kappa;
+      grisu_round(buf, *len, delta, p2, one,
+                  wp_w * (-kappa < 10 ? pow10[-kappa] : 0));
+      return;
+    }
+  }
+}
+
+/*
+ * Lay out @len significant digits in @buf scaled by 10^@k the way a reader
+ * expects: plain integers and fractions where that is short, exponent form
+ * otherwise.  @buf must have room for 26 characters.
+ */
+static
+int
+grisu_prettify(char *buf, int len, int k)
+{
+  int kk = len + k;                     /* 10^(kk-1) <= v < 10^kk */
+  int i  = 0;
+
+  if (k >= 0 && kk <= 21) {
+    for (i = len; i < kk; i++) {
+      buf[i] = '0';
+    }
+
+    return kk;
+  }
+
+  if (kk > 0 && kk <= 21) {
+    memmove(&buf[kk + 1], &buf[kk], len - kk);
+    buf[kk] = '.';
+
+    return len + 1;
+  }
+
+  if (kk > -6 && kk <= 0) {
+    int offset = 2 - kk;
+
+    memmove(&buf[offset], &buf[0], len);
+    buf[0] = '0';
+    buf[1] = '.';
+
+    for (i = 2; i < offset; i++) {
+      buf[i] = '0';
+    }
+
+    return len + offset;
+  }
+
+  if (len > 1) {
+    memmove(&buf[2], &buf[1], len - 1);
+    buf[1]  = '.';
+    len    += 1;
+  }
+
+  buf[len++] = 'e';
+  kk--;
+
+  if (kk < 0) {
+    buf[len++] = '-';
+    kk         = -kk;
+  } else {
+    buf[len++] = '+';
+  }
+
+  return len + format_uint64((uint64_t)kk, &buf[len]);
+}
+
+/*
+ * Format @num as a JSON number into @out, which must have room for 32
+ * characters.  Integral values take the integer path; NaN and infinities,
+ * which JSON cannot represent, become `null'.  Returns the length written.
+ */
+static
+int
+format_double(double num, char *out)
+{
+  diy_fp_t v;
+  diy_fp_t w;
+  diy_fp_t wm;
+  diy_fp_t wp;
+  diy_fp_t c;
+  char    *p   = out;
+  int      len = 0;
+  int      k   = 0;
+
+  if (num != num || num - num != 0) {
+    memcpy(out, "null", 4);
+    return 4;
+  }
+
+  if (num > -DOUBLE_EXACT_INT && num < DOUBLE_EXACT_INT &&
+      (double)(int64_t)num == num)
+  {
+    return format_int64((int64_t)num, out);
+  }
+
+  if (num < 0) {
+    *p++ = '-';
+    num  = -num;
+  }
+
+  v = diy_fp_from_double(num);
+  diy_fp_boundaries(v, &wm, &wp);
+
+  c     = cached_power(wp.e, &k);
+  w     = diy_fp_mul(diy_fp_normalize(v), c);
+  wp    = diy_fp_mul(wp, c);
+  wm    = diy_fp_mul(wm, c);
+  wm.f++;
+  wp.f--;
+
+  grisu_digits(w, wp, wp.f - wm.f, p, &len, &k);
+
+  return (int)(p - out) + grisu_prettify(p, len, k);
+}
+
+/* }}} */
+
 static void emit_value(SB *out, const json_node_t *node);
 static void emit_value_indented(SB                *out,
                                 const json_node_t *node,
@@ -366,6 +957,8 @@ static void emit_value_indented(SB                *out,
                                 int                indent_level);
 static void emit_string(SB *out, const char *str);
 static void emit_number(SB *out, double num);
+static void emit_int64(SB *out, int64_t num);
+static void emit_uint64(SB *out, uint64_t num);
 static void emit_array(SB *out, const json_node_t *array);
 static void emit_array_indented(SB                *out,
                                 const json_node_t *array,
@@ -377,15 +970,15 @@ static void emit_object_indented(SB                *out,
                                  const char        *space,
                                  int                indent_level);
 
-static bool parse_array(const char **sp, json_node_t **out);
-static bool parse_object(const char **sp, json_node_t **out);
-static bool parse_value(const char **sp, json_node_t **out);
-bool        parse_string(const char **sp, char **out);
+static bool parse_array(const char **sp, json_node_t **out, json_arena_t *);
+static bool parse_object(const char **sp, json_node_t **out, json_arena_t *);
+static bool parse_value(const char **sp, json_node_t **out, json_arena_t *);
+static bool parse_string(const char **sp, char **out, json_arena_t *);
 static bool parse_number(const char **sp, double *out);
 
 static int write_hex16(char *out, uint16_t val);
 
-static json_node_t *mknode(json_tag_t tag);
+static json_node_t *mknode(json_arena_t *arena, json_tag_t tag);
 static void         append_node(json_node_t *parent, json_node_t *child);
 static void         prepend_node(json_node_t *parent, json_node_t *child);
 static void         append_member(json_node_t *object,
@@ -393,16 +986,17 @@ static void         append_member(json_node_t *object,
                                   json_node_t *value);
 
 static bool tag_is_valid(unsigned int tag);
-static bool number_is_valid(const char *num);
 
 json_node_t *
 json_decode(const char *json)
 {
-  const char  *s   = json;
-  json_node_t *ret = NULL;
+  const char   *s     = json;
+  json_node_t  *ret   = NULL;
+  json_arena_t *arena = arena_new();
 
   skip_space(&s);
-  if (!parse_value(&s, &ret)) {
+  if (!parse_value(&s, &ret, arena)) {
+    arena_free(arena);
     return NULL;
   }
 
@@ -451,6 +1045,16 @@ json_stringify(const json_node_t *node, const char *space)
 void
 json_delete(json_node_t *node)
 {
+  if (node != NULL && node->arena != NULL) {
+    json_remove_from_parent(node);
+
+    if (node == node->arena->root) {
+      arena_free(node->arena);
+    }
+
+    return;
+  }
+
   if (node != NULL) {
     json_remove_from_parent(node);
 
@@ -521,6 +1125,21 @@ json_find_member(json_node_t *object, const char *name)
   return NULL;
 }
 
+/*
+ * Numeric value of @node as a double, whichever number kind it holds.
+ * Non-numbers read as zero.
+ */
+double
+json_get_number(const json_node_t *node)
+{
+  switch (node->tag) {
+    case JSON_NUMBER: return node->_u._number;
+    case JSON_INT64:  return (double)node->_u._int64;
+    case JSON_UINT64: return (double)node->_u._uint64;
+    default:          return 0.0;
+  }
+}
+
 json_node_t *
 json_first_child(const json_node_t *node)
 {
@@ -533,28 +1152,41 @@ json_first_child(const json_node_t *node)
 
 static
 json_node_t *
-mknode(json_tag_t tag)
+mknode(json_arena_t *arena, json_tag_t tag)
 {
   json_node_t *ret = NULL;
 
-  ret      = xcalloc(1, sizeof(json_node_t));
+  if (arena != NULL) {
+    ret = arena_alloc(arena, sizeof(json_node_t));
+    memset(ret, 0, sizeof(json_node_t));
+
+    ret->arena = arena;
+    if (arena->root == NULL) {
+      arena->root = ret;
+    }
+  } else {
+    ret = xcalloc(1, sizeof(json_node_t));
+  }
+
   ret->tag = tag;
 
   return ret;
 }
 
-json_node_t *
-json_mknull(void)
+static
+char *
+node_strdup(json_arena_t *arena, const char *s)
 {
-  return mknode(JSON_NULL);
+  return arena != NULL ? arena_strdup(arena, s) : strdup(s);
 }
 
+static
 json_node_t *
-json_mkbool(bool b)
+mkbool(json_arena_t *arena, bool b)
 {
   json_node_t *ret = NULL;
 
-  ret           = mknode(JSON_BOOL);
+  ret           = mknode(arena, JSON_BOOL);
   ret->_u._bool = b;
 
   return ret;
@@ -562,43 +1194,168 @@ json_mkbool(bool b)
 
 static
 json_node_t *
-mkstring(char *s)
+mkstring(json_arena_t *arena, char *s)
 {
   json_node_t *ret = NULL;
 
-  ret             = mknode(JSON_STRING);
+  ret             = mknode(arena, JSON_STRING);
   ret->_u._string = s;
 
   return ret;
 }
 
+static
 json_node_t *
-json_mkstring(const char *s)
+mknumber(json_arena_t *arena, double n)
 {
-  return mkstring(strdup(s));
+  json_node_t *ret = NULL;
+
+  ret             = mknode(arena, JSON_NUMBER);
+  ret->_u._number = n;
+
+  return ret;
 }
 
+static
 json_node_t *
-json_mknumber(double n)
+mkint64(json_arena_t *arena, int64_t n)
 {
   json_node_t *ret = NULL;
 
-  ret             = mknode(JSON_NUMBER);
-  ret->_u._number = n;
+  ret            = mknode(arena, JSON_INT64);
+  ret->_u._int64 = n;
 
   return ret;
 }
 
+static
 json_node_t *
-json_mkarray(void)
+mkuint64(json_arena_t *arena, uint64_t n)
 {
-  return mknode(JSON_ARRAY);
-}
+  json_node_t *ret = NULL;
+
+  ret             = mknode(arena, JSON_UINT64);
+  ret->_u._uint64 = n;
+
+  return ret;
+}
+
+json_node_t *
+json_mknull(void)
+{
+  return mknode(NULL, JSON_NULL);
+}
+
+json_node_t *
+json_mkbool(bool b)
+{
+  return mkbool(NULL, b);
+}
+
+json_node_t *
+json_mkstring(const char *s)
+{
+  return mkstring(NULL, strdup(s));
+}
+
+json_node_t *
+json_mknumber(double n)
+{
+  return mknumber(NULL, n);
+}
+
+json_node_t *
+json_mkint64(int64_t n)
+{
+  return mkint64(NULL, n);
+}
+
+json_node_t *
+json_mkuint64(uint64_t n)
+{
+  return mkuint64(NULL, n);
+}
+
+json_node_t *
+json_mkarray(void)
+{
+  return mknode(NULL, JSON_ARRAY);
+}
 
 json_node_t *
 json_mkobject(void)
 {
-  return mknode(JSON_OBJECT);
+  return mknode(NULL, JSON_OBJECT);
+}
+
+json_node_t *
+json_arena_mkroot(json_tag_t tag)
+{
+  return mknode(arena_new(), tag);
+}
+
+json_node_t *
+json_arena_mknull(const json_node_t *tree)
+{
+  assert(tree->arena != NULL);
+
+  return mknode(tree->arena, JSON_NULL);
+}
+
+json_node_t *
+json_arena_mkbool(const json_node_t *tree, bool b)
+{
+  assert(tree->arena != NULL);
+
+  return mkbool(tree->arena, b);
+}
+
+json_node_t *
+json_arena_mkstring(const json_node_t *tree, const char *s)
+{
+  assert(tree->arena != NULL);
+
+  return mkstring(tree->arena, arena_strdup(tree->arena, s));
+}
+
+json_node_t *
+json_arena_mknumber(const json_node_t *tree, double n)
+{
+  assert(tree->arena != NULL);
+
+  return mknumber(tree->arena, n);
+}
+
+json_node_t *
+json_arena_mkint64(const json_node_t *tree, int64_t n)
+{
+  assert(tree->arena != NULL);
+
+  return mkint64(tree->arena, n);
+}
+
+json_node_t *
+json_arena_mkuint64(const json_node_t *tree, uint64_t n)
+{
+  assert(tree->arena != NULL);
+
+  return mkuint64(tree->arena, n);
+}
+
+json_node_t *
+json_arena_mkarray(const json_node_t *tree)
+{
+  assert(tree->arena != NULL);
+
+  return mknode(tree->arena, JSON_ARRAY);
+}
+
+json_node_t *
+json_arena_mkobject(const json_node_t *tree)
+{
+  assert(tree->arena != NULL);
+
+  return mknode(tree->arena, JSON_OBJECT);
 }
 
 static
@@ -648,6 +1405,7 @@ json_append_element(json_node_t *array, json_node_t *element)
 {
   assert(array->tag == JSON_ARRAY);
   assert(element->parent == NULL);
+  assert(element->arena == array->arena);
 
   append_node(array, element);
 }
@@ -657,6 +1415,7 @@ json_prepend_element(json_node_t *array, json_node_t *element)
 {
   assert(array->tag == JSON_ARRAY);
   assert(element->parent == NULL);
+  assert(element->arena == array->arena);
 
   prepend_node(array, element);
 }
@@ -666,8 +1425,9 @@ json_append_member(json_node_t *object, const char *key, json_node_t *value)
 {
   assert(object->tag == JSON_OBJECT);
   assert(value->parent == NULL);
+  assert(value->arena == object->arena);
 
-  append_member(object, strdup(key), value);
+  append_member(object, node_strdup(object->arena, key), value);
 }
 
 void
@@ -675,8 +1435,9 @@ json_prepend_member(json_node_t *object, const char *key, json_node_t *value)
 {
   assert(object->tag == JSON_OBJECT);
   assert(value->parent == NULL);
+  assert(value->arena == object->arena);
 
-  value->key = strdup(key);
+  value->key = node_strdup(object->arena, key);
   prepend_node(object, value);
 }
 
@@ -698,8 +1459,9 @@ json_remove_from_parent(json_node_t *node)
       parent->_u.children.tail = node->prev;
     }
 
-    free(node->key);
-    node->key = NULL;
+    if (node->arena == NULL) {
+      free(node->key);
+    }
 
     node->parent = NULL;
     node->prev   = node->next = NULL;
@@ -718,6 +1480,8 @@ emit_value(SB *out, const json_node_t *node)
     case JSON_BOOL:   sb_puts(out, node->_u._bool ? "true" : "false"); break;
     case JSON_STRING: emit_string(out, node->_u._string);              break;
     case JSON_NUMBER: emit_number(out, node->_u._number);              break;
+    case JSON_INT64:  emit_int64(out, node->_u._int64);                break;
+    case JSON_UINT64: emit_uint64(out, node->_u._uint64);              break;
     case JSON_ARRAY:  emit_array(out, node);                           break;
     case JSON_OBJECT: emit_object(out, node);                          break;
     default:          assert(false);
@@ -737,221 +1501,1979 @@ emit_value_indented(SB                *out,
     case JSON_BOOL:   sb_puts(out, node->_u._bool ? "true" : "false");   break;
     case JSON_STRING: emit_string(out, node->_u._string);                break;
     case JSON_NUMBER: emit_number(out, node->_u._number);                break;
+    case JSON_INT64:  emit_int64(out, node->_u._int64);                  break;
+    case JSON_UINT64: emit_uint64(out, node->_u._uint64);                break;
     case JSON_ARRAY:  emit_array_indented(out, node, space, ilevel);     break;
     case JSON_OBJECT: emit_object_indented(out, node, space, ilevel);    break;
     default:          assert(false);
   }
 }
 
-static
-void
-emit_array(SB *out, const json_node_t *array)
-{
-  const json_node_t *element = NULL;
+static
+void
+emit_array(SB *out, const json_node_t *array)
+{
+  const json_node_t *element = NULL;
+
+  sb_putc(out, '[');
+
+  json_foreach(element, array) {
+    emit_value(out, element);
+
+    if (element->next != NULL) {
+      sb_putc(out, ',');
+    }
+  }
+
+  sb_putc(out, ']');
+}
+
+static
+void
+emit_array_indented(SB                *out,
+                    const json_node_t *array,
+                    const char        *space,
+                    int                ilevel)
+{
+  const json_node_t *element = array->_u.children.head;
+  int                i       = 0;
+
+  if (element == NULL) {
+    sb_puts(out, "[]");
+    return;
+  }
+
+  sb_puts(out, "[\n");
+  while (element != NULL) {
+    for (i = 0; i < ilevel + 1; i++) {
+      sb_puts(out, space);
+    }
+    emit_value_indented(out, element, space, ilevel + 1);
+
+    element = element->next;
+    sb_puts(out, element != NULL ? ",\n" : "\n");
+  }
+
+  for (i = 0; i < ilevel; i++) {
+    sb_puts(out, space);
+  }
+
+  sb_putc(out, ']');
+}
+
+static
+void
+emit_object(SB *out, const json_node_t *object)
+{
+  const json_node_t *member = NULL;
+
+  sb_putc(out, '{');
+
+  json_foreach(member, object) {
+    emit_string(out, member->key);
+    sb_putc(out, ':');
+    emit_value(out, member);
+
+    if (member->next != NULL) {
+      sb_putc(out, ',');
+    }
+  }
+
+  sb_putc(out, '}');
+}
+
+static
+void
+emit_object_indented(SB                *out,
+                     const json_node_t *object,
+                     const char        *space,
+                     int                ilevel)
+{
+  const json_node_t *member = object->_u.children.head;
+  int                i      = 0;
+
+  if (member == NULL) {
+    sb_puts(out, "{}");
+    return;
+  }
+
+  sb_puts(out, "{\n");
+
+  while (member != NULL) {
+    for (i = 0; i < ilevel + 1; i++) {
+      sb_puts(out, space);
+    }
+
+    emit_string(out, member->key);
+    sb_puts(out, ": ");
+    emit_value_indented(out, member, space, ilevel + 1);
+
+    member = member->next;
+    sb_puts(out, member != NULL ? ",\n" : "\n");
+  }
+
+  for (i = 0; i < ilevel; i++) {
+    sb_puts(out, space);
+  }
+
+  sb_putc(out, '}');
+}
+
+#if defined(__AVX2__)
+/*
+ * Keiser and Lemire's check of 32 bytes of UTF-8, from "Validating UTF-8
+ * In Less Than One Instruction Per Byte".  Lookups on the nibbles of each
+ * byte and the one before it flag every bad pair; the bytes two and three
+ * back say where a continuation byte is owed.  @v must start on a
+ * character.  The result is zero if the block is well formed, as far as
+ * can be told without the bytes after it; see `utf8_incomplete'.
+ */
+#define U8_TOO_SHORT       0x01
+#define U8_TOO_LONG        0x02
+#define U8_OVERLONG_3      0x04
+#define U8_TOO_LARGE       0x08
+#define U8_SURROGATE       0x10
+#define U8_OVERLONG_2      0x20
+#define U8_TOO_LARGE_1000  0x40
+#define U8_OVERLONG_4      0x40
+#define U8_TWO_CONTS       0x80
+#define U8_CARRY           (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+#define U8_TABLE(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p)         \
+  _mm256_setr_epi8((char)(a), (char)(b), (char)(c), (char)(d),          \
+                   (char)(e), (char)(f), (char)(g), (char)(h),          \
+                   (char)(i), (char)(j), (char)(k), (char)(l),          \
+                   (char)(m), (char)(n), (char)(o), (char)(p),          \
+                   (char)(a), (char)(b), (char)(c), (char)(d),          \
+                   (char)(e), (char)(f), (char)(g), (char)(h),          \
+                   (char)(i), (char)(j), (char)(k), (char)(l),          \
+                   (char)(m), (char)(n), (char)(o), (char)(p))
+
+/* @v moved up @n bytes, with zeros -- ASCII -- shifted in. */
+#define U8_PREV(v, n)                                                   \
+  _mm256_alignr_epi8((v),                                               \
+                     _mm256_permute2x128_si256((v), (v), 0x08),         \
+                     16 - (n))
+
+static
+__m256i
+utf8_check_block(__m256i v)
+{
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i byte_1_high = U8_TABLE(
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+    U8_TOO_SHORT | U8_OVERLONG_2,
+    U8_TOO_SHORT,
+    U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+    U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4);
+  const __m256i byte_1_low = U8_TABLE(
+    U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,
+    U8_CARRY | U8_OVERLONG_2,
+    U8_CARRY,
+    U8_CARRY,
+    U8_CARRY | U8_TOO_LARGE,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000);
+  const __m256i byte_2_high = U8_TABLE(
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 |
+      U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 |
+      U8_TOO_LARGE,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE |
+      U8_TOO_LARGE,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE |
+      U8_TOO_LARGE,
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT);
+  __m256i prev1 = U8_PREV(v, 1);
+  __m256i cases = _mm256_and_si256(
+    _mm256_and_si256(
+      _mm256_shuffle_epi8(byte_1_high,
+                          _mm256_and_si256(_mm256_srli_epi16(prev1, 4),
+                                           nibble)),
+      _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+    _mm256_shuffle_epi8(byte_2_high,
+                        _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+  /* Only 111_____ two back, or 1111____ three back, leave the top bit. */
+  __m256i owed  = _mm256_and_si256(
+    _mm256_or_si256(
+      _mm256_subs_epu8(U8_PREV(v, 2), _mm256_set1_epi8(0xE0 - 0x80)),
+      _mm256_subs_epu8(U8_PREV(v, 3), _mm256_set1_epi8(0xF0 - 0x80))),
+    _mm256_set1_epi8((char)0x80));
+
+  return _mm256_xor_si256(owed, cases);
+}
+
+/*
+ * Whether @v ends part way through a sequence, so that the next block
+ * owes continuation bytes.
+ */
+static
+bool
+utf8_incomplete(__m256i v)
+{
+  const __m256i max = _mm256_setr_epi8(
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+
+  __m256i       over = _mm256_subs_epu8(v, max);
+
+  return !_mm256_testz_si256(over, over);
+}
+#endif
+
+/*
+ * Step over the characters at the start of @s that can be copied verbatim,
+ * stopping at the first that cannot or at the first to start @n or more
+ * bytes in.  Returns the number of bytes stepped over, which may pass @n
+ * by the rest of a multi-byte character.  @s is NUL-terminated, so a
+ * sequence cut short at the end is caught by its terminator.
+ */
+static
+size_t
+plain_chars(const unsigned char *s, size_t n)
+{
+  size_t run = 0;
+  int    len = 0;
+
+  while (run < n) {
+    unsigned char c = s[run];
+
+    if (c < 0x80) {
+      if (c < 0x20 || c == '"' || c == '\\') {
+        break;
+      }
+
+      run++;
+    } else if ((len = utf8_validate_cz((const char *)s + run)) != 0) {
+      run += len;
+    } else {
+      break;
+    }
+  }
+
+  return run;
+}
+
+/*
+ * Back up from @run to the lead byte of the last character before it, a
+ * character that runs on past @run.  A lead byte is never more than three
+ * bytes back.
+ */
+#define CHAR_START(s, run) do {                                 \
+    size_t __i = 1;                                             \
+                                                                \
+    for (__i = 1; __i <= 3 && __i <= (run); __i++) {            \
+      if ((s)[(run) - __i] >= 0xC0) {                           \
+        (run) -= __i;                                           \
+        break;                                                  \
+      }                                                         \
+                                                                \
+      if ((s)[(run) - __i] < 0x80) {                            \
+        break;                                                  \
+      }                                                         \
+    }                                                           \
+  } while (0)
+
+/*
+ * Length of the run at the start of @s, at most @n bytes, that can be copied
+ * into a JSON string verbatim: printable ASCII other than `"' and `\', and
+ * well-formed UTF-8.  Control characters and invalid sequences end the run
+ * and are left to the scalar path in `emit_string'.
+ *
+ * Blocks of ASCII are passed over sixteen or thirty-two bytes at a time.
+ * With AVX2, blocks holding multi-byte characters are checked as a whole
+ * too, by `utf8_check_block'; with SSE2 alone, such a block is stepped
+ * through a character at a time and the block scan picks up after it.
+ * Either way a block that needs a closer look -- a quote, a control
+ * character or a bad sequence -- is left to `plain_chars', which finds the
+ * exact byte.
+ */
+static
+size_t
+plain_run(const unsigned char *s, size_t n)
+{
+  size_t run = 0;
+
+#if defined(__AVX2__)
+  const __m256i quote32  = _mm256_set1_epi8('"');
+  const __m256i bslash32 = _mm256_set1_epi8('\\');
+  const __m256i space32  = _mm256_set1_epi8(0x20);
+
+  for (;;) {
+    __m256i  v;
+    __m256i  error;
+    unsigned mask = 0;
+    size_t   stop = 0;
+
+    while (n - run >= 32) {
+      v    = _mm256_loadu_si256((const __m256i *)(s + run));
+      mask = (unsigned)_mm256_movemask_epi8(
+               _mm256_or_si256(
+                 _mm256_or_si256(_mm256_cmpeq_epi8(v, quote32),
+                                 _mm256_cmpeq_epi8(v, bslash32)),
+                 _mm256_cmpgt_epi8(space32, v)));
+
+      if (mask != 0) {
+        break;
+      }
+
+      run += 32;
+    }
+
+    if (n - run < 32) {
+      break;
+    }
+
+    /* The signed compare caught bytes >= 0x80 along with the controls. */
+    if ((mask & ~(unsigned)_mm256_movemask_epi8(v)) == 0) {
+      error = utf8_check_block(v);
+
+      if (_mm256_testz_si256(error, error)) {
+        /* A character cut off at the end is left for the next block. */
+        run += 32;
+
+        if (utf8_incomplete(v)) {
+          CHAR_START(s, run);
+        }
+
+        continue;
+      }
+    }
+
+    /* Somewhere in this block is a stop; find it a character at a time. */
+    stop  = run + 32;
+    run  += plain_chars(s + run, stop - run);
+
+    if (run < stop) {
+      return run;
+    }
+  }
+#endif
+
+#if defined(__SSE2__)
+  {
+    const __m128i quote  = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i space  = _mm_set1_epi8(0x20);
+
+    while (n - run >= 16) {
+      __m128i  v    = _mm_loadu_si128((const __m128i *)(s + run));
+      /* Signed compare: catches both C0 controls and bytes >= 0x80. */
+      __m128i  m    = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                     _mm_cmpeq_epi8(v, bslash)),
+                        _mm_cmplt_epi8(v, space));
+      unsigned mask = (unsigned)_mm_movemask_epi8(m);
+      size_t   stop = run + 16;
+
+      if (mask == 0) {
+        run = stop;
+        continue;
+      }
+
+      /*
+       * Step through the block a character at a time; the last may run
+       * on past its end.
+       */
+      run += __builtin_ctz(mask);
+      run += plain_chars(s + run, stop - run);
+
+      if (run < stop) {
+        return run;
+      }
+    }
+  }
+#endif
+
+  return run + plain_chars(s + run, n - run);
+}
+
+void
+emit_string(SB *out, const char *str)
+{
+  bool                 escape_unicode = false;
+  const unsigned char *s              = (const unsigned char *)str;
+  const unsigned char *end            = s + strlen(str);
+  size_t               run            = 0;
+  char                *b              = NULL;
+
+  /* Enough for the common case of a string with nothing to escape. */
+  sb_need(out, (end - s) + 2);
+  b = out->cur;
+
+  *b++ = '"';
+
+  for (;;) {
+    unsigned char c = 0;
+
+    run = plain_run(s, end - s);
+    memcpy(b, s, run);
+    b += run;
+    s += run;
+
+    if (s == end) {
+      break;
+    }
+
+    /*
+     * Escape point.  Reserve room for the worst case of this character
+     * plus the rest of the string verbatim and the closing quote.
+     */
+    out->cur = b;
+    sb_need(out, 12 + (end - s) + 1);
+    b = out->cur;
+
+    c = *s++;
+
+    switch (c) {
+      case '"':  *b++ = '\\'; *b++ = '"';  break;
+      case '\\': *b++ = '\\'; *b++ = '\\'; break;
+      case '\b': *b++ = '\\'; *b++ = 'b';  break;
+      case '\f': *b++ = '\\'; *b++ = 'f';  break;
+      case '\n': *b++ = '\\'; *b++ = 'n';  break;
+      case '\r': *b++ = '\\'; *b++ = 'r';  break;
+      case '\t': *b++ = '\\'; *b++ = 't';  break;
+
+      default: {
+        int len = 0;
+
+        s--;
+        len = utf8_validate_cz((const char *)s);
+
+        if (len == 0) {
+          /* Invalid UTF-8: substitute U+FFFD and resynchronise. */
+          if (escape_unicode) {
+            memcpy(b, "\\uFFFD", 6);
+            b += 6;
+          } else {
+            *b++ = (char)0xEF;
+            *b++ = (char)0xBF;
+            *b++ = (char)0xBD;
+          }
+          s++;
+        } else if (c < 0x20 || (c >= 0x80 && escape_unicode)) {
+          uint32_t unicode = 0;
+
+          s += utf8_read_char((const char *)s, &unicode);
+
+          if (unicode <= 0xFFFF) {
+            *b++ = '\\';
+            *b++ = 'u';
+            b += write_hex16(b, unicode);
+          } else {
+            uint16_t uc = 0;
+            uint16_t lc = 0;
+            assert(unicode <= 0x10FFFF);
+
+            to_surrogate_pair(unicode, &uc, &lc);
+            *b++ = '\\';
+            *b++ = 'u';
+            b += write_hex16(b, uc);
+            *b++ = '\\';
+            *b++ = 'u';
+            b += write_hex16(b, lc);
+          }
+        } else {
+          while (len--) {
+            *b++ = *s++;
+          }
+        }
+
+        break;
+      }
+    }
+  }
+
+  *b++ = '"';
+
+  out->cur = b;
+}
+
+static
+void
+emit_number(SB *out, double num)
+{
+  sb_need(out, 32);
+  out->cur += format_double(num, out->cur);
+}
+
+static
+void
+emit_int64(SB *out, int64_t num)
+{
+  sb_need(out, 21);
+  out->cur += format_int64(num, out->cur);
+}
+
+static
+void
+emit_uint64(SB *out, uint64_t num)
+{
+  sb_need(out, 21);
+  out->cur += format_uint64(num, out->cur);
+}
+
+/* {{{ Binary encodings: */
+
+/*
+ * CBOR (RFC 7049) and MessagePack.  Both carry the same node types as the
+ * JSON text, so a client sees the same document whichever it asks for.
+ * Integral numbers become integers, and other numbers use the narrowest
+ * float that holds them exactly.
+ */
+
+static
+void
+sb_put_be(SB *sb, uint64_t v, int nbytes)
+{
+  sb_need(sb, nbytes);
+
+  while (nbytes-- > 0) {
+    *sb->cur++ = (char)((v >> (nbytes * 8)) & 0xFF);
+  }
+}
+
+/*
+ * Same test `format_double' uses to print a number without a fraction.
+ */
+static
+bool
+double_is_int(double num)
+{
+  return (num > -DOUBLE_EXACT_INT && num < DOUBLE_EXACT_INT &&
+          (double)(int64_t)num == num);
+}
+
+static
+bool
+fits_float(double num)
+{
+  return (num != num) || ((double)(float)num == num);
+}
+
+static
+uint32_t
+float_bits(float f)
+{
+  uint32_t bits = 0;
+
+  memcpy(&bits, &f, sizeof(bits));
+
+  return bits;
+}
+
+static
+uint64_t
+double_bits(double d)
+{
+  uint64_t bits = 0;
+
+  memcpy(&bits, &d, sizeof(bits));
+
+  return bits;
+}
+
+/*
+ * Write a CBOR initial byte for `major' with argument `arg'.
+ */
+static
+void
+cbor_head(SB *out, int major, uint64_t arg)
+{
+  int mt = major << 5;
+
+  if (arg < 24) {
+    sb_putc(out, (char)(mt | (int)arg));
+  } else if (arg <= 0xFF) {
+    sb_putc(out, (char)(mt | 24));
+    sb_put_be(out, arg, 1);
+  } else if (arg <= 0xFFFF) {
+    sb_putc(out, (char)(mt | 25));
+    sb_put_be(out, arg, 2);
+  } else if (arg <= 0xFFFFFFFF) {
+    sb_putc(out, (char)(mt | 26));
+    sb_put_be(out, arg, 4);
+  } else {
+    sb_putc(out, (char)(mt | 27));
+    sb_put_be(out, arg, 8);
+  }
+}
+
+static
+void
+cbor_int64(SB *out, int64_t num)
+{
+  if (num >= 0) {
+    cbor_head(out, 0, (uint64_t)num);
+  } else {
+    cbor_head(out, 1, (uint64_t)(-(num + 1)));
+  }
+}
+
+static
+void
+cbor_number(SB *out, double num)
+{
+  if (double_is_int(num)) {
+    cbor_int64(out, (int64_t)num);
+  } else if (fits_float(num)) {
+    sb_putc(out, (char)0xFA);
+    sb_put_be(out, float_bits((float)num), 4);
+  } else {
+    sb_putc(out, (char)0xFB);
+    sb_put_be(out, double_bits(num), 8);
+  }
+}
+
+static
+void
+cbor_string(SB *out, const char *str)
+{
+  size_t len = strlen(str);
+
+  cbor_head(out, 3, len);
+  sb_put(out, str, (int)len);
+}
+
+/*
+ * Write a MessagePack length-prefixed header.  `fix' and `fixmax' describe
+ * the compact form; `wide' is the first of the 8/16/32-bit tags, which
+ * follow one another.  Strings have an 8-bit form, arrays and maps do not.
+ */
+static
+void
+msgpack_head(SB *out, int fix, size_t fixmax, int wide, size_t len)
+{
+  if (len <= fixmax) {
+    sb_putc(out, (char)(fix | (int)len));
+  } else if (wide == 0xD9 && len <= 0xFF) {
+    sb_putc(out, (char)wide);
+    sb_put_be(out, len, 1);
+  } else if (len <= 0xFFFF) {
+    sb_putc(out, (char)(wide == 0xD9 ? 0xDA : wide));
+    sb_put_be(out, len, 2);
+  } else {
+    sb_putc(out, (char)(wide == 0xD9 ? 0xDB : wide + 1));
+    sb_put_be(out, len, 4);
+  }
+}
+
+static
+void
+msgpack_uint64(SB *out, uint64_t num)
+{
+  if (num < 0x80) {
+    sb_putc(out, (char)num);
+  } else if (num <= 0xFF) {
+    sb_putc(out, (char)0xCC);
+    sb_put_be(out, num, 1);
+  } else if (num <= 0xFFFF) {
+    sb_putc(out, (char)0xCD);
+    sb_put_be(out, num, 2);
+  } else if (num <= 0xFFFFFFFF) {
+    sb_putc(out, (char)0xCE);
+    sb_put_be(out, num, 4);
+  } else {
+    sb_putc(out, (char)0xCF);
+    sb_put_be(out, num, 8);
+  }
+}
+
+static
+void
+msgpack_int64(SB *out, int64_t num)
+{
+  if (num >= 0) {
+    msgpack_uint64(out, (uint64_t)num);
+  } else if (num >= -32) {
+    sb_putc(out, (char)(0xE0 | (int)(num + 32)));
+  } else if (num >= INT8_MIN) {
+    sb_putc(out, (char)0xD0);
+    sb_put_be(out, (uint64_t)num, 1);
+  } else if (num >= INT16_MIN) {
+    sb_putc(out, (char)0xD1);
+    sb_put_be(out, (uint64_t)num, 2);
+  } else if (num >= INT32_MIN) {
+    sb_putc(out, (char)0xD2);
+    sb_put_be(out, (uint64_t)num, 4);
+  } else {
+    sb_putc(out, (char)0xD3);
+    sb_put_be(out, (uint64_t)num, 8);
+  }
+}
+
+static
+void
+msgpack_number(SB *out, double num)
+{
+  if (double_is_int(num)) {
+    msgpack_int64(out, (int64_t)num);
+  } else if (fits_float(num)) {
+    sb_putc(out, (char)0xCA);
+    sb_put_be(out, float_bits((float)num), 4);
+  } else {
+    sb_putc(out, (char)0xCB);
+    sb_put_be(out, double_bits(num), 8);
+  }
+}
+
+static
+void
+msgpack_string(SB *out, const char *str)
+{
+  size_t len = strlen(str);
+
+  msgpack_head(out, 0xA0, 31, 0xD9, len);
+  sb_put(out, str, (int)len);
+}
+
+/* }}} */
+/* {{{ Streaming writer: */
+
+#define WRITER_MAX_DEPTH  ((int)(sizeof(unsigned long) * 8))
+
+/*
+ * The length of a binary container is not known until it ends, so room is
+ * left for the longest header and the contents are moved up over whatever
+ * the real header does not need.
+ */
+#define FRAME_HEAD_MAX    5
+
+struct json_frame_s {
+  size_t   offset;                      /* Of the header's reserved room. */
+  uint32_t count;                       /* Elements, or members. */
+  bool     object;
+};
+
+/*
+ * What a template was built from: the calls made on its writer, with keys
+ * and strings kept alongside.
+ */
+typedef enum {
+  TAPE_BEGIN_OBJECT,
+  TAPE_END_OBJECT,
+  TAPE_BEGIN_ARRAY,
+  TAPE_END_ARRAY,
+  TAPE_KEY,
+  TAPE_VALUE,
+  TAPE_RAW,
+  TAPE_HOLE
+} tape_op_t;
+
+typedef struct {
+  tape_op_t         op;
+  json_tag_t        tag;                /* Of a TAPE_VALUE. */
+  json_hole_kind_t  hole;               /* Of a TAPE_HOLE. */
+  size_t            text;               /* Offset into `strings'. */
+  size_t            length;             /* Of a TAPE_RAW. */
+  bool              b;
+  json_hole_value_t value;
+} tape_step_t;
+
+struct json_tape_s {
+  tape_step_t *steps;
+  int          count;
+  int          size;
+  SB           strings;
+};
+
+static
+tape_step_t *
+tape_push(json_tape_t *tape, tape_op_t op)
+{
+  tape_step_t *step = NULL;
+
+  if (tape->count == tape->size) {
+    tape->size  = tape->size ? tape->size * 2 : 32;
+    tape->steps = xrealloc(tape->steps, tape->size * sizeof(tape_step_t));
+  }
+
+  step       = &tape->steps[tape->count++];
+  step->op   = op;
+  step->text = 0;
+
+  return step;
+}
+
+static
+size_t
+tape_text(json_tape_t *tape, const char *text, size_t len)
+{
+  size_t offset = tape->strings.cur - tape->strings.start;
+
+  sb_put(&tape->strings, text, (int)len);
+  sb_putc(&tape->strings, '\0');
+
+  return offset;
+}
+
+/*
+ * Record a call on a writer whose template is being built.
+ */
+static
+void
+tape_event(json_tape_t *tape, const json_event_t *event, const char *key)
+{
+  static const tape_op_t ops[] = {
+    TAPE_BEGIN_OBJECT,
+    TAPE_END_OBJECT,
+    TAPE_BEGIN_ARRAY,
+    TAPE_END_ARRAY,
+    TAPE_VALUE
+  };
+  tape_step_t *step = NULL;
+
+  if (key != NULL) {
+    step       = tape_push(tape, TAPE_KEY);
+    step->text = tape_text(tape, key, strlen(key));
+    return;
+  }
+
+  step = tape_push(tape, ops[event->kind]);
+
+  if (event->kind != JSON_EVENT_VALUE) {
+    return;
+  }
+
+  step->tag = event->tag;
+
+  switch (event->tag) {
+    case JSON_BOOL:
+      step->b = event->_u._bool;
+      break;
+
+    case JSON_STRING:
+      step->text = tape_text(tape,
+                             event->_u._string,
+                             strlen(event->_u._string));
+      break;
+
+    case JSON_NUMBER:
+      step->value._number = event->_u._number;
+      break;
+
+    case JSON_INT64:
+      step->value._int64 = event->_u._int64;
+      break;
+
+    case JSON_UINT64:
+      step->value._uint64 = event->_u._uint64;
+      break;
+
+    default:
+      break;
+  }
+}
+
+void
+json_writer_init(json_writer_t *writer)
+{
+  sb_init(&writer->buf);
+
+  writer->comma     = 0;
+  writer->depth     = 0;
+  writer->after_key = false;
+  writer->format    = JSON_FORMAT_TEXT;
+  writer->frames    = NULL;
+  writer->key       = NULL;
+  writer->sink      = NULL;
+  writer->sink_data = NULL;
+  writer->tape      = NULL;
+}
+
+void
+json_writer_set_format(json_writer_t *writer, json_format_t format)
+{
+  assert(writer->depth == 0 && format != JSON_FORMAT_EVENTS);
+
+  writer->format = format;
+}
+
+/*
+ * Hand everything written from now on to @sink instead.
+ */
+void
+json_writer_set_sink(json_writer_t *writer, json_sink_t sink, void *data)
+{
+  assert(writer->depth == 0);
+
+  writer->format    = JSON_FORMAT_EVENTS;
+  writer->sink      = sink;
+  writer->sink_data = data;
+}
+
+void
+json_writer_reset(json_writer_t *writer)
+{
+  writer->buf.cur   = writer->buf.start;
+  writer->comma     = 0;
+  writer->depth     = 0;
+  writer->after_key = false;
+  writer->key       = NULL;
+}
+
+/*
+ * The result is NUL-terminated for convenience; a binary document may also
+ * contain NULs, so take its length from `json_writer_length'.
+ */
+char *
+json_writer_finish(json_writer_t *writer)
+{
+  assert(writer->depth == 0 && !writer->after_key);
+
+  if (writer->format != JSON_FORMAT_TEXT) {
+    *writer->buf.cur = '\0';
+    return writer->buf.start;
+  }
+
+  return sb_finish(&writer->buf);
+}
+
+size_t
+json_writer_length(const json_writer_t *writer)
+{
+  return writer->buf.cur - writer->buf.start;
+}
+
+void
+json_writer_free(json_writer_t *writer)
+{
+  sb_free(&writer->buf);
+  MAYBE_FREE(writer->frames);
+}
+
+/*
+ * Whether the writer needs more than JSON text written into its buffer.
+ */
+#define WRITER_SPECIAL(w)  ((w)->format != JSON_FORMAT_TEXT || (w)->tape != NULL)
+
+/*
+ * Account for a value about to be written into a binary container.
+ */
+static
+void
+binary_value(json_writer_t *writer)
+{
+  json_frame_t *frame = NULL;
+
+  if (writer->depth == 0) {
+    return;
+  }
+
+  frame = &writer->frames[writer->depth - 1];
+
+  /* A member was counted with its key. */
+  if (!frame->object) {
+    frame->count++;
+  }
+}
+
+static
+void
+binary_begin(json_writer_t *writer, bool object)
+{
+  json_frame_t *frame = NULL;
+  SB           *sb    = &writer->buf;
+
+  binary_value(writer);
+
+  if (writer->frames == NULL) {
+    writer->frames = xmalloc(WRITER_MAX_DEPTH * sizeof(json_frame_t));
+  }
+
+  assert(writer->depth + 1 < WRITER_MAX_DEPTH);
+
+  frame         = &writer->frames[writer->depth++];
+  frame->offset = sb->cur - sb->start;
+  frame->count  = 0;
+  frame->object = object;
+
+  sb_need(sb, FRAME_HEAD_MAX);
+  sb->cur += FRAME_HEAD_MAX;
+}
+
+static
+void
+binary_end(json_writer_t *writer)
+{
+  SB           *sb    = &writer->buf;
+  json_frame_t *frame = NULL;
+  char         *at    = NULL;
+  char         *body  = NULL;
+  size_t        len   = 0;
+  size_t        head  = 0;
+
+  assert(writer->depth > 0);
+
+  frame = &writer->frames[--writer->depth];
+  at    = sb->start + frame->offset;
+  body  = at + FRAME_HEAD_MAX;
+  len   = sb->cur - body;
+
+  /* Write the real header after the contents, then move both into place. */
+  if (writer->format == JSON_FORMAT_CBOR) {
+    cbor_head(sb, frame->object ? 5 : 4, frame->count);
+  } else {
+    msgpack_head(sb,
+                 frame->object ? 0x80 : 0x90,
+                 15,
+                 frame->object ? 0xDE : 0xDC,
+                 frame->count);
+  }
+
+  /* The buffer may have moved. */
+  at   = sb->start + frame->offset;
+  body = at + FRAME_HEAD_MAX;
+  head = sb->cur - (body + len);
+
+  memcpy(at, body + len, head);
+  memmove(at + head, body, len);
+
+  sb->cur = at + head + len;
+}
+
+static
+void
+binary_string(json_writer_t *writer, const char *str)
+{
+  if (writer->format == JSON_FORMAT_CBOR) {
+    cbor_string(&writer->buf, str);
+  } else {
+    msgpack_string(&writer->buf, str);
+  }
+}
+
+/*
+ * Write @event in the writer's format, if that is not JSON text.  Returns
+ * false if it is, and the caller is to write the text itself; a template
+ * being recorded is always written as text.
+ */
+static
+bool
+writer_other(json_writer_t *writer, json_event_t *event)
+{
+  SB *sb = &writer->buf;
+
+  if (writer->tape != NULL) {
+    tape_event(writer->tape, event, NULL);
+  }
+
+  switch (writer->format) {
+    case JSON_FORMAT_TEXT:
+      return false;
+
+    case JSON_FORMAT_EVENTS:
+      event->key  = writer->key;
+      writer->key = NULL;
+      writer->sink(writer->sink_data, event);
+      return true;
+
+    default:
+      break;
+  }
+
+  switch (event->kind) {
+    case JSON_EVENT_BEGIN_OBJECT:
+    case JSON_EVENT_BEGIN_ARRAY:
+      binary_begin(writer, event->kind == JSON_EVENT_BEGIN_OBJECT);
+      return true;
+
+    case JSON_EVENT_END_OBJECT:
+    case JSON_EVENT_END_ARRAY:
+      binary_end(writer);
+      return true;
+
+    default:
+      break;
+  }
+
+  binary_value(writer);
+
+  switch (event->tag) {
+    case JSON_NULL:
+      sb_putc(sb, (char)(writer->format == JSON_FORMAT_CBOR ? 0xF6 : 0xC0));
+      break;
+
+    case JSON_BOOL:
+      if (writer->format == JSON_FORMAT_CBOR) {
+        sb_putc(sb, (char)(event->_u._bool ? 0xF5 : 0xF4));
+      } else {
+        sb_putc(sb, (char)(event->_u._bool ? 0xC3 : 0xC2));
+      }
+      break;
+
+    case JSON_STRING:
+      binary_string(writer, event->_u._string);
+      break;
+
+    case JSON_NUMBER:
+      if (writer->format == JSON_FORMAT_CBOR) {
+        cbor_number(sb, event->_u._number);
+      } else {
+        msgpack_number(sb, event->_u._number);
+      }
+      break;
+
+    case JSON_INT64:
+      if (writer->format == JSON_FORMAT_CBOR) {
+        cbor_int64(sb, event->_u._int64);
+      } else {
+        msgpack_int64(sb, event->_u._int64);
+      }
+      break;
+
+    case JSON_UINT64:
+      if (writer->format == JSON_FORMAT_CBOR) {
+        cbor_head(sb, 0, event->_u._uint64);
+      } else {
+        msgpack_uint64(sb, event->_u._uint64);
+      }
+      break;
+
+    default:
+      assert(false);
+  }
+
+  return true;
+}
+
+/*
+ * Build an event of @kind, or a value of type @tag.
+ */
+#define WRITER_EVENT(ev, k, t) do {             \
+    (ev).kind = (k);                            \
+    (ev).key  = NULL;                           \
+    (ev).tag  = (t);                            \
+  } while (0)
+
+/*
+ * Account for a value about to be written at the current depth, emitting a
+ * separating comma if a sibling precedes it.
+ */
+static
+void
+writer_value(json_writer_t *writer)
+{
+  unsigned long bit = 1UL << writer->depth;
+
+  if (writer->after_key) {
+    writer->after_key = false;
+    return;
+  }
+
+  if (writer->comma & bit) {
+    sb_putc(&writer->buf, ',');
+  }
+
+  writer->comma |= bit;
+}
+
+static
+void
+writer_begin(json_writer_t *writer, char c)
+{
+  json_event_t event;
+
+  if (WRITER_SPECIAL(writer)) {
+    WRITER_EVENT(event,
+                 c == '{' ? JSON_EVENT_BEGIN_OBJECT : JSON_EVENT_BEGIN_ARRAY,
+                 c == '{' ? JSON_OBJECT : JSON_ARRAY);
+
+    if (writer_other(writer, &event)) {
+      return;
+    }
+  }
+
+  writer_value(writer);
+  sb_putc(&writer->buf, c);
+
+  writer->depth++;
+  assert(writer->depth < WRITER_MAX_DEPTH);
+
+  writer->comma &= ~(1UL << writer->depth);
+}
+
+static
+void
+writer_end(json_writer_t *writer, char c)
+{
+  json_event_t event;
+
+  if (WRITER_SPECIAL(writer)) {
+    WRITER_EVENT(event,
+                 c == '}' ? JSON_EVENT_END_OBJECT : JSON_EVENT_END_ARRAY,
+                 c == '}' ? JSON_OBJECT : JSON_ARRAY);
+
+    if (writer_other(writer, &event)) {
+      return;
+    }
+  }
+
+  assert(writer->depth > 0 && !writer->after_key);
+
+  writer->depth--;
+  sb_putc(&writer->buf, c);
+}
+
+void
+json_write_begin_object(json_writer_t *writer)
+{
+  writer_begin(writer, '{');
+}
+
+void
+json_write_end_object(json_writer_t *writer)
+{
+  writer_end(writer, '}');
+}
+
+void
+json_write_begin_array(json_writer_t *writer)
+{
+  writer_begin(writer, '[');
+}
+
+void
+json_write_end_array(json_writer_t *writer)
+{
+  writer_end(writer, ']');
+}
+
+void
+json_write_key(json_writer_t *writer, const char *key)
+{
+  if (writer->tape != NULL) {
+    tape_event(writer->tape, NULL, key);
+  }
+
+  switch (writer->format) {
+    case JSON_FORMAT_TEXT:
+      break;
+
+    case JSON_FORMAT_EVENTS:
+      writer->key = key;
+      return;
+
+    default:
+      assert(writer->depth > 0 && writer->frames[writer->depth - 1].object);
+      writer->frames[writer->depth - 1].count++;
+      binary_string(writer, key);
+      return;
+  }
+
+  assert(writer->depth > 0 && !writer->after_key);
+
+  writer_value(writer);
+  emit_string(&writer->buf, key);
+  sb_putc(&writer->buf, ':');
+
+  writer->after_key = true;
+}
+
+void
+json_write_string(json_writer_t *writer, const char *str)
+{
+  json_event_t event;
+
+  if (WRITER_SPECIAL(writer)) {
+    WRITER_EVENT(event, JSON_EVENT_VALUE, JSON_STRING);
+    event._u._string = str;
+
+    if (writer_other(writer, &event)) {
+      return;
+    }
+  }
+
+  writer_value(writer);
+  emit_string(&writer->buf, str);
+}
+
+void
+json_write_number(json_writer_t *writer, double num)
+{
+  json_event_t event;
+
+  if (WRITER_SPECIAL(writer)) {
+    WRITER_EVENT(event, JSON_EVENT_VALUE, JSON_NUMBER);
+    event._u._number = num;
+
+    if (writer_other(writer, &event)) {
+      return;
+    }
+  }
+
+  writer_value(writer);
+  emit_number(&writer->buf, num);
+}
+
+void
+json_write_int64(json_writer_t *writer, int64_t num)
+{
+  json_event_t event;
+
+  if (WRITER_SPECIAL(writer)) {
+    WRITER_EVENT(event, JSON_EVENT_VALUE, JSON_INT64);
+    event._u._int64 = num;
+
+    if (writer_other(writer, &event)) {
+      return;
+    }
+  }
+
+  writer_value(writer);
+  emit_int64(&writer->buf, num);
+}
+
+void
+json_write_uint64(json_writer_t *writer, uint64_t num)
+{
+  json_event_t event;
+
+  if (WRITER_SPECIAL(writer)) {
+    WRITER_EVENT(event, JSON_EVENT_VALUE, JSON_UINT64);
+    event._u._uint64 = num;
+
+    if (writer_other(writer, &event)) {
+      return;
+    }
+  }
+
+  writer_value(writer);
+  emit_uint64(&writer->buf, num);
+}
+
+void
+json_write_bool(json_writer_t *writer, bool b)
+{
+  json_event_t event;
+
+  if (WRITER_SPECIAL(writer)) {
+    WRITER_EVENT(event, JSON_EVENT_VALUE, JSON_BOOL);
+    event._u._bool = b;
+
+    if (writer_other(writer, &event)) {
+      return;
+    }
+  }
+
+  writer_value(writer);
+  sb_puts(&writer->buf, b ? "true" : "false");
+}
+
+void
+json_write_null(json_writer_t *writer)
+{
+  json_event_t event;
+
+  if (WRITER_SPECIAL(writer)) {
+    WRITER_EVENT(event, JSON_EVENT_VALUE, JSON_NULL);
+
+    if (writer_other(writer, &event)) {
+      return;
+    }
+  }
+
+  writer_value(writer);
+  sb_puts(&writer->buf, "null");
+}
+
+/*
+ * Write @len bytes of an already serialised value, in the writer's format,
+ * as the next value.  There is nothing to hand a sink, so a writer in
+ * JSON_FORMAT_EVENTS drops it.
+ */
+void
+json_write_raw(json_writer_t *writer, const char *json, size_t len)
+{
+  tape_step_t *step = NULL;
+
+  if (writer->tape != NULL) {
+    step         = tape_push(writer->tape, TAPE_RAW);
+    step->text   = tape_text(writer->tape, json, len);
+    step->length = len;
+  }
+
+  switch (writer->format) {
+    case JSON_FORMAT_TEXT:
+      writer_value(writer);
+      break;
+
+    case JSON_FORMAT_EVENTS:
+      writer->key = NULL;
+      return;
+
+    default:
+      binary_value(writer);
+      break;
+  }
+
+  sb_put(&writer->buf, json, len);
+}
+
+/*
+ * Replace the @old_len bytes at @offset in the writer's output with @len
+ * bytes of @data, shifting whatever follows.  Used to patch one value of a
+ * finished document in place.
+ */
+void
+json_writer_splice(json_writer_t *writer,
+                   size_t         offset,
+                   size_t         old_len,
+                   const char    *data,
+                   size_t         len)
+{
+  SB     *sb   = &writer->buf;
+  size_t  tail = 0;
+
+  assert(offset + old_len <= (size_t)(sb->cur - sb->start));
+
+  tail = (sb->cur - sb->start) - offset - old_len;
+
+  if (len > old_len) {
+    sb_need(sb, (int)(len - old_len));
+  }
+
+  memmove(sb->start + offset + len, sb->start + offset + old_len, tail);
+  memcpy(sb->start + offset, data, len);
+
+  sb->cur = sb->start + offset + len + tail;
+}
+
+/*
+ * Write a tree.
+ */
+static
+void
+write_node(json_writer_t *writer, const json_node_t *node)
+{
+  const json_node_t *child = NULL;
+
+  assert(tag_is_valid(node->tag));
+
+  switch (node->tag) {
+    case JSON_NULL:
+      json_write_null(writer);
+      break;
+
+    case JSON_BOOL:
+      json_write_bool(writer, node->_u._bool);
+      break;
+
+    case JSON_STRING:
+      json_write_string(writer, node->_u._string);
+      break;
+
+    case JSON_NUMBER:
+      json_write_number(writer, node->_u._number);
+      break;
+
+    case JSON_INT64:
+      json_write_int64(writer, node->_u._int64);
+      break;
+
+    case JSON_UINT64:
+      json_write_uint64(writer, node->_u._uint64);
+      break;
+
+    case JSON_ARRAY:
+      json_write_begin_array(writer);
+      json_foreach(child, node) {
+        write_node(writer, child);
+      }
+      json_write_end_array(writer);
+      break;
+
+    case JSON_OBJECT:
+      json_write_begin_object(writer);
+      json_foreach(child, node) {
+        json_write_key(writer, child->key);
+        write_node(writer, child);
+      }
+      json_write_end_object(writer);
+      break;
+
+    default:
+      assert(false);
+  }
+}
+
+static
+char *
+encode_binary(const json_node_t *node, json_format_t format, size_t *len)
+{
+  json_writer_t writer;
+
+  json_writer_init(&writer);
+  json_writer_set_format(&writer, format);
+  write_node(&writer, node);
+
+  *len = json_writer_length(&writer);
+  json_writer_finish(&writer);
+  MAYBE_FREE(writer.frames);
+
+  return writer.buf.start;
+}
+
+/*
+ * The result is NUL-terminated for convenience, but may contain NULs; its
+ * length is stored in `*len'.
+ */
+char *
+json_encode_cbor(const json_node_t *node, size_t *len)
+{
+  return encode_binary(node, JSON_FORMAT_CBOR, len);
+}
+
+char *
+json_encode_msgpack(const json_node_t *node, size_t *len)
+{
+  return encode_binary(node, JSON_FORMAT_MSGPACK, len);
+}
+
+/* }}} */
+/* {{{ Templates: */
+
+void
+json_template_init(json_template_t *tpl)
+{
+  json_writer_init(&tpl->writer);
+
+  tpl->holes     = NULL;
+  tpl->nholes    = 0;
+  tpl->max_holes = 0;
+  tpl->tape      = xcalloc(1, sizeof(json_tape_t));
+  tpl->finished  = false;
+
+  sb_init(&tpl->tape->strings);
+  tpl->writer.tape = tpl->tape;
+}
+
+void
+json_template_hole(json_template_t *tpl, json_hole_kind_t kind)
+{
+  assert(!tpl->finished);
+
+  if (tpl->nholes == tpl->max_holes) {
+    tpl->max_holes = tpl->max_holes ? tpl->max_holes * 2 : 8;
+    tpl->holes     = xrealloc(tpl->holes,
+                              sizeof(json_hole_t) * tpl->max_holes);
+  }
+
+  tape_push(tpl->tape, TAPE_HOLE)->hole = kind;
+  writer_value(&tpl->writer);
+
+  tpl->holes[tpl->nholes].offset = json_writer_length(&tpl->writer);
+  tpl->holes[tpl->nholes].kind   = kind;
+  tpl->nholes++;
+}
+
+void
+json_template_finish(json_template_t *tpl)
+{
+  json_writer_finish(&tpl->writer);
+
+  tpl->writer.tape = NULL;
+  tpl->finished    = true;
+}
+
+/*
+ * Make the calls that built @tpl again on @out, with @values in the holes.
+ */
+static
+void
+template_replay(const json_template_t   *tpl,
+                json_writer_t           *out,
+                const json_hole_value_t *values)
+{
+  const json_tape_t *tape  = tpl->tape;
+  const tape_step_t *step  = NULL;
+  const char        *text  = NULL;
+  int                i     = 0;
+
+  for (i = 0; i < tape->count; i++) {
+    step = &tape->steps[i];
+    text = tape->strings.start + step->text;
+
+    switch (step->op) {
+      case TAPE_BEGIN_OBJECT:
+        json_write_begin_object(out);
+        break;
+
+      case TAPE_END_OBJECT:
+        json_write_end_object(out);
+        break;
+
+      case TAPE_BEGIN_ARRAY:
+        json_write_begin_array(out);
+        break;
+
+      case TAPE_END_ARRAY:
+        json_write_end_array(out);
+        break;
+
+      case TAPE_KEY:
+        json_write_key(out, text);
+        break;
+
+      case TAPE_RAW:
+        json_write_raw(out, text, step->length);
+        break;
+
+      case TAPE_HOLE:
+        switch (step->hole) {
+          case JSON_HOLE_NUMBER:
+            json_write_number(out, values->_number);
+            break;
+
+          case JSON_HOLE_INT64:
+            json_write_int64(out, values->_int64);
+            break;
+
+          case JSON_HOLE_UINT64:
+            json_write_uint64(out, values->_uint64);
+            break;
+        }
+
+        values++;
+        break;
+
+      case TAPE_VALUE:
+        switch (step->tag) {
+          case JSON_NULL:
+            json_write_null(out);
+            break;
+
+          case JSON_BOOL:
+            json_write_bool(out, step->b);
+            break;
 
-  sb_putc(out, '[');
+          case JSON_STRING:
+            json_write_string(out, text);
+            break;
 
-  json_foreach(element, array) {
-    emit_value(out, element);
+          case JSON_NUMBER:
+            json_write_number(out, step->value._number);
+            break;
 
-    if (element->next != NULL) {
-      sb_putc(out, ',');
+          case JSON_INT64:
+            json_write_int64(out, step->value._int64);
+            break;
+
+          case JSON_UINT64:
+            json_write_uint64(out, step->value._uint64);
+            break;
+
+          default:
+            assert(false);
+        }
+        break;
     }
   }
-
-  sb_putc(out, ']');
 }
 
-static
 void
-emit_array_indented(SB                *out,
-                    const json_node_t *array,
-                    const char        *space,
-                    int                ilevel)
+json_template_render(const json_template_t   *tpl,
+                     json_writer_t           *out,
+                     const json_hole_value_t *values)
 {
-  const json_node_t *element = array->_u.children.head;
-  int                i       = 0;
+  const char *skel = tpl->writer.buf.start;
+  size_t      len  = json_writer_length(&tpl->writer);
+  size_t      pos  = 0;
+  char       *b    = NULL;
+  int         i    = 0;
 
-  if (element == NULL) {
-    sb_puts(out, "[]");
+  assert(tpl->finished);
+
+  if (WRITER_SPECIAL(out)) {
+    template_replay(tpl, out, values);
     return;
   }
 
-  sb_puts(out, "[\n");
-  while (element != NULL) {
-    for (i = 0; i < ilevel + 1; i++) {
-      sb_puts(out, space);
-    }
-    emit_value_indented(out, element, space, ilevel + 1);
-
-    element = element->next;
-    sb_puts(out, element != NULL ? ",\n" : "\n");
-  }
+  writer_value(out);
 
-  for (i = 0; i < ilevel; i++) {
-    sb_puts(out, space);
-  }
+  /* Every hole formats into at most 32 bytes. */
+  sb_need(&out->buf, len + (size_t)tpl->nholes * 32);
+  b = out->buf.cur;
 
-  sb_putc(out, ']');
-}
+  for (i = 0; i < tpl->nholes; i++) {
+    size_t run = tpl->holes[i].offset - pos;
 
-static
-void
-emit_object(SB *out, const json_node_t *object)
-{
-  const json_node_t *member = NULL;
+    memcpy(b, skel + pos, run);
+    b   += run;
+    pos += run;
 
-  sb_putc(out, '{');
+    switch (tpl->holes[i].kind) {
+      case JSON_HOLE_NUMBER:
+        b += format_double(values[i]._number, b);
+        break;
 
-  json_foreach(member, object) {
-    emit_string(out, member->key);
-    sb_putc(out, ':');
-    emit_value(out, member);
+      case JSON_HOLE_INT64:
+        b += format_int64(values[i]._int64, b);
+        break;
 
-    if (member->next != NULL) {
-      sb_putc(out, ',');
+      case JSON_HOLE_UINT64:
+        b += format_uint64(values[i]._uint64, b);
+        break;
     }
   }
 
-  sb_putc(out, '}');
+  memcpy(b, skel + pos, len - pos);
+  out->buf.cur = b + (len - pos);
 }
 
-static
 void
-emit_object_indented(SB                *out,
-                     const json_node_t *object,
-                     const char        *space,
-                     int                ilevel)
+json_template_free(json_template_t *tpl)
 {
-  const json_node_t *member = object->_u.children.head;
-  int                i      = 0;
-
-  if (member == NULL) {
-    sb_puts(out, "{}");
-    return;
+  json_writer_free(&tpl->writer);
+  MAYBE_FREE(tpl->holes);
+
+  if (tpl->tape != NULL) {
+    MAYBE_FREE(tpl->tape->steps);
+    sb_free(&tpl->tape->strings);
+    free(tpl->tape);
+    tpl->tape = NULL;
   }
 
-  sb_puts(out, "{\n");
+  tpl->nholes    = 0;
+  tpl->max_holes = 0;
+  tpl->finished  = false;
+}
 
-  while (member != NULL) {
-    for (i = 0; i < ilevel + 1; i++) {
-      sb_puts(out, space);
-    }
+/* }}} */
+/* {{{ Member index: */
 
-    emit_string(out, member->key);
-    sb_puts(out, ": ");
-    emit_value_indented(out, member, space, ilevel + 1);
+#define INDEX_MAX_DEPTH  WRITER_MAX_DEPTH
 
-    member = member->next;
-    sb_puts(out, member != NULL ? ",\n" : "\n");
-  }
+void
+json_index_init(json_index_t *index)
+{
+  index->json    = NULL;
+  index->members = NULL;
+  index->count   = 0;
+  index->size    = 0;
+}
 
-  for (i = 0; i < ilevel; i++) {
-    sb_puts(out, space);
-  }
+void
+json_index_free(json_index_t *index)
+{
+  MAYBE_FREE(index->members);
 
-  sb_putc(out, '}');
+  index->json  = NULL;
+  index->count = 0;
+  index->size  = 0;
 }
 
-void
-emit_string(SB *out, const char *str)
+/*
+ * Offset just past the string whose opening quote is at @pos.
+ */
+static
+size_t
+index_skip_string(const char *json, size_t len, size_t pos)
 {
-  bool        escape_unicode = false;
-  const char *s              = str;
-  char       *b              = NULL;
+  for (pos++; pos < len; pos++) {
+    if (json[pos] == '\\') {
+      pos++;
+    } else if (json[pos] == '"') {
+      return pos + 1;
+    }
+  }
 
-  assert(utf8_validate(str));
+  return len;
+}
 
-  sb_need(out, 14);
-  b = out->cur;
+/*
+ * Record the members of the serialised document @json.  The document is
+ * trusted to be valid JSON, as it is something we wrote ourselves; the scan
+ * only tracks strings and nesting.  Returns false if nesting is too deep.
+ */
+bool
+json_index_build(json_index_t *index, const char *json, size_t len)
+{
+  struct {
+    bool object;                        /* Otherwise an array. */
+    bool indexed;                       /* Members here get recorded. */
+    int  member;                        /* Member holding it, or -1. */
+  }              stack[INDEX_MAX_DEPTH];
+  json_member_t *m         = NULL;
+  size_t         pos       = 0;
+  size_t         next      = 0;
+  int            depth     = -1;
+  int            pending   = -1;        /* Member whose value is next. */
+  bool           want_key  = false;
+
+  index->json  = json;
+  index->count = 0;
+
+  while (pos < len) {
+    switch (json[pos]) {
+      case ' ': case '\t': case '\r': case '\n': case ':':
+        pos++;
+        continue;
+
+      case ',':
+        want_key = (depth >= 0 && stack[depth].object);
+        pos++;
+        continue;
+
+      case '{':
+      case '[':
+        if (++depth >= INDEX_MAX_DEPTH) {
+          return false;
+        }
 
-  *b++ = '"';
+        stack[depth].object  = (json[pos] == '{');
+        stack[depth].member  = pending;
+        stack[depth].indexed = stack[depth].object &&
+                               (depth == 0 || pending >= 0);
 
-  while (*s != 0) {
-    unsigned char c = *s++;
+        want_key = stack[depth].object;
+        pending  = -1;
+        pos++;
+        continue;
 
-    switch (c) {
-      case '"':  *b++ = '\\'; *b++ = '"';  break;
-      case '\\': *b++ = '\\'; *b++ = '\\'; break;
-      case '\b': *b++ = '\\'; *b++ = 'b';  break;
-      case '\f': *b++ = '\\'; *b++ = 'f';  break;
-      case '\n': *b++ = '\\'; *b++ = 'n';  break;
-      case '\r': *b++ = '\\'; *b++ = 'r';  break;
-      case '\t': *b++ = '\\'; *b++ = 't';  break;
+      case '}':
+      case ']':
+        if (depth < 0) {
+          return false;
+        }
 
-      default: {
-        int len = 0;
+        if (stack[depth].member >= 0) {
+          index->members[stack[depth].member].end = pos + 1;
+        }
 
-        s--;
-        len = utf8_validate_cz(s);
+        depth--;
+        want_key = false;
+        pos++;
+        continue;
 
-        if (len == 0) {
-          assert(false);
-          if (escape_unicode) {
-            strcpy(b, "\\uFFD");
-            b += 6;
-          } else {
-            *b++ = (char)0xEF;
-            *b++ = (char)0xBF;
-            *b++ = (char)0xBD;
-          }
-          s++;
-        } else if (c < 0x1F || (c >= 0x80 && escape_unicode)) {
-          uint32_t unicode = 0;
+      case '"':
+        next = index_skip_string(json, len, pos);
 
-          s += utf8_read_char(s, &unicode);
+        if (!want_key) {
+          break;
+        }
 
-          if (unicode <= 0xFFFF) {
-            *b++ = '\\';
-            *b++ = 'u';
-            b += write_hex16(b, unicode);
-          } else {
-            uint16_t uc = 0;
-            uint16_t lc = 0;
-            assert(unicode <= 0x10FFFF);
+        want_key = false;
 
-            to_surrogate_pair(unicode, &uc, &lc);
-            *b++ = '\\';
-            *b++ = 'u';
-            b += write_hex16(b, uc);
-            *b++ = '\\';
-            *b++ = 'u';
-            b += write_hex16(b, lc);
-          }
-        } else {
-          while (len--) {
-            *b++ = *s++;
-          }
+        if (!stack[depth].indexed) {
+          pos = next;
+          continue;
+        }
+
+        if (index->count == index->size) {
+          index->size    = index->size ? index->size * 2 : 32;
+          index->members = xrealloc(index->members,
+                                    index->size * sizeof(json_member_t));
         }
 
+        m             = &index->members[index->count];
+        m->key        = pos;
+        m->key_length = next - pos - 2;
+        m->parent     = stack[depth].member;
+        m->value      = next + strspn(json + next, " \t\r\n:");
+        m->end        = m->value;
+        pending       = index->count++;
+
+        pos = m->value;
+        continue;
+
+      default:
+        next = pos + strcspn(json + pos, ",}] \t\r\n");
         break;
-      }
     }
 
-    out->cur = b;
-    sb_need(out, 14);
-    b        = out->cur;
+    /* A scalar value ends at `next'. */
+    if (pending >= 0) {
+      index->members[pending].end = next;
+      pending                     = -1;
+    }
+
+    pos = next;
   }
 
-  *b++ = '"';
+  return (depth == -1);
+}
 
-  out->cur = b;
+/*
+ * The member named by the first @len bytes of @key whose parent is
+ * @parent, or -1.  Keys are compared as they appear in the document, so a
+ * key containing escapes must be asked for escaped.
+ */
+int
+json_index_find(const json_index_t *index,
+                int                 parent,
+                const char         *key,
+                size_t              len)
+{
+  const json_member_t *m = NULL;
+  int                  i = 0;
+
+  for (i = (parent < 0) ? 0 : parent + 1; i < index->count; i++) {
+    m = &index->members[i];
+
+    if (m->parent == parent       &&
+        m->key_length == len      &&
+        memcmp(index->json + m->key + 1, key, len) == 0)
+    {
+      return i;
+    }
+
+    /* Members of `parent' all come before its end. */
+    if (parent >= 0 && m->key >= index->members[parent].end) {
+      break;
+    }
+  }
+
+  return -1;
 }
 
-static
-void
-emit_number(SB *out, double num)
+/*
+ * Follow @path, whose components are separated by @sep, down from
+ * @parent.  Returns the member reached, or -1.
+ */
+int
+json_index_lookup(const json_index_t *index,
+                  int                 parent,
+                  const char         *path,
+                  char                sep)
 {
-  char buf[64] = { 0 };
-  sprintf(buf, "%.16g", num);
+  const char *end = NULL;
 
-  if (number_is_valid(buf)) {
-    sb_puts(out, buf);
-  } else {
-    sb_puts(out, "null");
+  while (*path != '\0') {
+    end = strchr(path, sep);
+    if (end == NULL) {
+      end = path + strlen(path);
+    }
+
+    if (end > path) {
+      parent = json_index_find(index, parent, path, end - path);
+      if (parent < 0) {
+        return -1;
+      }
+    }
+
+    path = (*end == '\0') ? end : end + 1;
   }
+
+  return parent;
 }
 
+/* }}} */
+
 static
 bool
 tag_is_valid(unsigned int tag)
@@ -1014,10 +3536,10 @@ parse_hex16(const char **sp, uint16_t *out)
 
 static
 bool
-parse_array(const char **sp, json_node_t **out)
+parse_array(const char **sp, json_node_t **out, json_arena_t *arena)
 {
   const char  *s   = *sp;
-  json_node_t *ret = out ? json_mkarray() : NULL;
+  json_node_t *ret = out ? mknode(arena, JSON_ARRAY) : NULL;
   json_node_t *elt = NULL;
 
   if (*s++ != '[') {
@@ -1031,7 +3553,7 @@ parse_array(const char **sp, json_node_t **out)
   }
 
   for (;;) {
-    if (!parse_value(&s, out ? &elt : NULL)) {
+    if (!parse_value(&s, out ? &elt : NULL, arena)) {
       goto failure;
     }
 
@@ -1061,16 +3583,16 @@ success:
   return true;
 
 failure:
-  json_delete(ret);
+  /* Partial trees are reclaimed along with the arena. */
   return false;
 }
 
 static
 bool
-parse_object(const char **sp, json_node_t **out)
+parse_object(const char **sp, json_node_t **out, json_arena_t *arena)
 {
   const char  *s   = *sp;
-  json_node_t *ret = out ? json_mkobject() : NULL;
+  json_node_t *ret = out ? mknode(arena, JSON_OBJECT) : NULL;
   char        *key = NULL;
   json_node_t *val;
 
@@ -1086,20 +3608,20 @@ parse_object(const char **sp, json_node_t **out)
   }
 
   for (;;) {
-    if (!parse_string(&s, out ? &key : NULL)) {
+    if (!parse_string(&s, out ? &key : NULL, arena)) {
       goto failure;
     }
 
     skip_space(&s);
 
     if (*s++ != ':') {
-      goto failure_free_key;
+      goto failure;
     }
 
     skip_space(&s);
 
-    if (!parse_value(&s, out ? &val : NULL)) {
-      goto failure_free_key;
+    if (!parse_value(&s, out ? &val : NULL, arena)) {
+      goto failure;
     }
 
     skip_space(&s);
@@ -1127,19 +3649,62 @@ success:
   }
   return true;
 
-failure_free_key:
-  if (out) {
-    free(key);
-  }
-
 failure:
-  json_delete(ret);
+  /* Partial trees are reclaimed along with the arena. */
   return false;
 }
 
+/*
+ * Make an exact integer node for the validated number literal [@s, @end)
+ * if it has neither fraction nor exponent and fits in 64 bits.  Returns
+ * NULL otherwise, leaving the caller to fall back to a double.
+ */
+static
+json_node_t *
+mkinteger(json_arena_t *arena, const char *s, const char *end)
+{
+  const uint64_t max = ~(uint64_t)0;
+  const uint64_t pos = ((uint64_t)1 << 63) - 1;
+  bool           neg = false;
+  uint64_t       v   = 0;
+  unsigned       d   = 0;
+
+  if (*s == '-') {
+    neg = true;
+    s++;
+  }
+
+  for (; s < end; s++) {
+    if (!isdigit((unsigned char)*s)) {
+      return NULL;
+    }
+
+    d = *s - '0';
+    if (v > (max - d) / 10) {
+      return NULL;
+    }
+
+    v = v * 10 + d;
+  }
+
+  if (neg) {
+    if (v > pos + 1) {
+      return NULL;
+    }
+
+    return mkint64(arena, (int64_t)((uint64_t)0 - v));
+  }
+
+  if (v > pos) {
+    return mkuint64(arena, v);
+  }
+
+  return mkint64(arena, (int64_t)v);
+}
+
 static
 bool
-parse_value(const char **sp, json_node_t **out)
+parse_value(const char **sp, json_node_t **out, json_arena_t *arena)
 {
   const char *s = *sp;
 
@@ -1147,7 +3712,7 @@ parse_value(const char **sp, json_node_t **out)
     case 'n':
       if (expect_literal(&s, "null")) {
         if (out) {
-          *out = json_mknull();
+          *out = mknode(arena, JSON_NULL);
         }
 
         *sp = s;
@@ -1159,7 +3724,7 @@ parse_value(const char **sp, json_node_t **out)
     case 'f':
       if (expect_literal(&s, "false")) {
         if (out) {
-          *out = json_mkbool(false);
+          *out = mkbool(arena, false);
         }
 
         *sp = s;
@@ -1171,7 +3736,7 @@ parse_value(const char **sp, json_node_t **out)
     case 't':
       if (expect_literal(&s, "true")) {
         if (out) {
-          *out = json_mkbool(true);
+          *out = mkbool(arena, true);
         }
 
         *sp = s;
@@ -1183,9 +3748,9 @@ parse_value(const char **sp, json_node_t **out)
     case '"': {
       char *str = NULL;
 
-      if (parse_string(&s, out ? &str : NULL)) {
+      if (parse_string(&s, out ? &str : NULL, arena)) {
         if (out) {
-          *out = mkstring(str);
+          *out = mkstring(arena, str);
         }
 
         *sp = s;
@@ -1196,14 +3761,14 @@ parse_value(const char **sp, json_node_t **out)
     }
 
     case '[':
-      if (parse_array(&s, out)) {
+      if (parse_array(&s, out, arena)) {
         *sp = s;
         return true;
       }
       return false;
 
     case '{':
-      if (parse_object(&s, out)) {
+      if (parse_object(&s, out, arena)) {
         *sp = s;
         return true;
       }
@@ -1211,11 +3776,13 @@ parse_value(const char **sp, json_node_t **out)
       return false;
 
     default: {
-      double num = 0.0;
-
-      if (parse_number(&s, out ? &num : NULL)) {
+      if (parse_number(&s, NULL)) {
         if (out) {
-          *out = json_mknumber(num);
+          *out = mkinteger(arena, *sp, s);
+
+          if (*out == NULL) {
+            *out = mknumber(arena, strtod(*sp, NULL));
+          }
         }
 
         *sp = s;
@@ -1227,22 +3794,52 @@ parse_value(const char **sp, json_node_t **out)
   }
 }
 
+/*
+ * Find the length of the encoded string body starting at @s, just past the
+ * opening quote.  The decoded string is never longer than this.
+ */
+static
+bool
+string_extent(const char *s, size_t *len)
+{
+  const char *p = s;
+
+  while (*p != '"') {
+    if (*p == '\0') {
+      return false;
+    }
+
+    if (*p++ == '\\' && *p++ == '\0') {
+      return false;
+    }
+  }
+
+  *len = p - s;
+
+  return true;
+}
+
+static
 bool
-parse_string(const char **sp, char **out)
+parse_string(const char **sp, char **out, json_arena_t *arena)
 {
   const char *s      = *sp;
-  SB          sb     = { 0 };
   char        tmp[4] = { 0 };
+  char       *str    = NULL;
   char       *b      = NULL;
-  
+  size_t      len    = 0;
+
   if (*s++ != '"') {
     return false;
   }
 
   if (out) {
-    sb_init(&sb);
-    sb_need(&sb, 4);
-    b = sb.cur;
+    if (!string_extent(s, &len)) {
+      return false;
+    }
+
+    str = arena_alloc(arena, len + 1);
+    b   = str;
   } else {
     b = tmp;
   }
@@ -1279,19 +3876,19 @@ parse_string(const char **sp, char **out)
           uchar_t  unicode = 0;
 
           if (!parse_hex16(&s, &uc)) {
-            goto failed;
+            return false;
           }
 
           if (uc >= 0xD800 && uc <= 0xDFFF) {
             if (*s++ != '\\' || *s++ != 'u' || !parse_hex16(&s, &lc)) {
-              goto failed;
+              return false;
             }
 
             if (!from_surrogate_pair(uc, lc, &unicode)) {
-              goto failed;
+              return false;
             }
           } else if (uc == 0) {
-            goto failed;
+            return false;
           } else {
             unicode = uc;
           }
@@ -1300,17 +3897,17 @@ parse_string(const char **sp, char **out)
           break;
         }
         default:
-          goto failed;
+          return false;
       }
     } else if (c <= 0x1F) {
-      goto failed;
+      return false;
     } else {
       int len = 0;
       
       s--;
       len = utf8_validate_cz(s);
       if (len == 0) {
-        goto failed;
+        return false;
       }
 
       while (len--) {
@@ -1319,29 +3916,19 @@ parse_string(const char **sp, char **out)
 
     }
 
-    if (out) {
-      sb.cur = b;
-      sb_need(&sb, 4);
-      b = sb.cur;
-    } else {
+    if (!out) {
       b = tmp;
     }
   }
   s++;
 
   if (out) {
-    *out = sb_finish(&sb);
+    *b   = '\0';
+    *out = str;
   }
 
   *sp = s;
   return true;
-
-failed:
-  if (out) {
-    sb_free(&sb);
-  }
-
-  return false;
 }
 
 bool
@@ -1401,13 +3988,6 @@ parse_number(const char **sp, double *out)
   return true;  
 }
 
-static
-bool
-number_is_valid(const char *num)
-{
-  return (parse_number(&num, NULL) && *num == '\0');
-}
-
 static
 int
 write_hex16(char *out, uint16_t val)
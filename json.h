@@ -49,12 +49,20 @@
 #ifndef _json_h_
 #define _json_h_
 
+#include "config.h"
+
 #ifdef HAVE_STDBOOL_H
 # include <stdbool.h>
 #else
 # include "posix/stdbool.h"
 #endif
 
+#if PLATFORM_LT(PLATFORM_BSD, PLATFORM_BSDOS)
+# include "posix/stdint.h"
+#else
+# include <stdint.h>
+#endif
+
 #include <stddef.h>
 
 typedef enum {
@@ -64,22 +72,28 @@ typedef enum {
   JSON_NUMBER,
   JSON_ARRAY,
   JSON_OBJECT,
+  JSON_INT64,                           /* Exact signed integer. */
+  JSON_UINT64,                          /* Exact unsigned integer. */
   VALID_JSON_TAG
 } json_tag_t;
 
-typedef struct json_node_s json_node_t;
+typedef struct json_node_s  json_node_t;
+typedef struct json_arena_s json_arena_t;
 
 struct json_node_s {
-  json_tag_t   tag;
-  char        *key;
-  json_node_t *parent;
-  json_node_t *prev;
-  json_node_t *next;
+  json_tag_t    tag;
+  char         *key;
+  json_node_t  *parent;
+  json_node_t  *prev;
+  json_node_t  *next;
+  json_arena_t *arena;                  /* Owning arena, or NULL if malloced. */
 
   union {
-    bool    _bool;
-    char   *_string;
-    double  _number;
+    bool      _bool;
+    char     *_string;
+    double    _number;
+    int64_t   _int64;
+    uint64_t  _uint64;
 
     struct {
       json_node_t *head;
@@ -88,15 +102,150 @@ struct json_node_s {
   } _u;
 };
 
+/*
+ * Growable output buffer.
+ */
+typedef struct {
+  char *cur;
+  char *end;
+  char *start;
+} json_buf_t;
+
+/*
+ * Writer output formats.  CBOR and MessagePack carry the same document as
+ * the JSON text, encoded as they are written rather than converted later.
+ * A writer in JSON_FORMAT_EVENTS writes nothing; it hands each value to a
+ * sink as it arrives.
+ */
+typedef enum {
+  JSON_FORMAT_TEXT,
+  JSON_FORMAT_CBOR,
+  JSON_FORMAT_MSGPACK,
+  JSON_FORMAT_EVENTS
+} json_format_t;
+
+typedef enum {
+  JSON_EVENT_BEGIN_OBJECT,
+  JSON_EVENT_END_OBJECT,
+  JSON_EVENT_BEGIN_ARRAY,
+  JSON_EVENT_END_ARRAY,
+  JSON_EVENT_VALUE
+} json_event_kind_t;
+
+typedef struct {
+  json_event_kind_t  kind;
+  const char        *key;               /* Member name; NULL in an array. */
+  json_tag_t         tag;               /* Type of a JSON_EVENT_VALUE. */
+
+  union {
+    bool        _bool;
+    const char *_string;
+    double      _number;
+    int64_t     _int64;
+    uint64_t    _uint64;
+  } _u;
+} json_event_t;
+
+typedef void (*json_sink_t)(void *, const json_event_t *);
+
+typedef struct json_frame_s json_frame_t;
+typedef struct json_tape_s  json_tape_t;
+
+/*
+ * Streaming writer.
+ *
+ * Emits a document directly into a buffer without building a tree of
+ * `json_node_t'.  The buffer survives `json_writer_reset', so an owner that
+ * regenerates the same document repeatedly only allocates when the document
+ * outgrows the buffer.
+ */
+typedef struct {
+  json_buf_t     buf;
+  unsigned long  comma;                 /* One bit per level: need a comma. */
+  int            depth;                 /* Current nesting depth. */
+  bool           after_key;             /* Next value completes a member. */
+  json_format_t  format;
+  json_frame_t  *frames;                /* Open binary containers. */
+  const char    *key;                   /* Member name for the next event. */
+  json_sink_t    sink;
+  void          *sink_data;
+  json_tape_t   *tape;                  /* Template being recorded, if any. */
+} json_writer_t;
+
+/*
+ * Precompiled document.
+ *
+ * A template holds the constant text of a fixed-shape document -- keys,
+ * punctuation and static strings -- with holes where numbers go.  Build it
+ * once through `writer', calling `json_template_hole' wherever a dynamic
+ * number belongs, then `json_template_finish'.  Rendering copies the
+ * skeleton and formats one value into each hole, in order.  When the
+ * shape changes -- a disk or interface coming or going, say -- the owner
+ * frees the template and builds another.
+ *
+ * The calls made while building are recorded too, so that a template can
+ * be played into a writer of any format.
+ */
+typedef enum {
+  JSON_HOLE_NUMBER,
+  JSON_HOLE_INT64,
+  JSON_HOLE_UINT64
+} json_hole_kind_t;
+
+typedef union {
+  double   _number;
+  int64_t  _int64;
+  uint64_t _uint64;
+} json_hole_value_t;
+
+typedef struct {
+  size_t           offset;              /* Position in the skeleton. */
+  json_hole_kind_t kind;
+} json_hole_t;
+
+typedef struct {
+  json_writer_t  writer;                /* Skeleton, once finished. */
+  json_hole_t   *holes;
+  int            nholes;
+  int            max_holes;
+  json_tape_t   *tape;                  /* The calls that built it. */
+  bool           finished;
+} json_template_t;
+
+/*
+ * Member index.
+ *
+ * Byte ranges of the members of a serialised document, so that parts of it
+ * can be served without parsing it again.  Only members reachable through
+ * objects alone are recorded; anything inside an array is not.
+ */
+typedef struct {
+  size_t key;                           /* Offset of the key's opening quote. */
+  size_t key_length;                    /* Bytes between the key's quotes. */
+  size_t value;                         /* Offset of the value. */
+  size_t end;                           /* Offset just past the value. */
+  int    parent;                        /* Enclosing member, or -1. */
+} json_member_t;
+
+typedef struct {
+  const char    *json;                  /* Document indexed. */
+  json_member_t *members;               /* In document order. */
+  int            count;
+  int            size;
+} json_index_t;
+
 char        *json_encode(const json_node_t *node);
 json_node_t *json_decode(const char *json);
 char        *json_encode_string(const char *str);
 char        *json_stringify(const json_node_t *node, const char *space);
+char        *json_encode_cbor(const json_node_t *node, size_t *len);
+char        *json_encode_msgpack(const json_node_t *node, size_t *len);
 void         json_delete(json_node_t *node);
 
 json_node_t *json_find_element(json_node_t *array, size_t index);
 json_node_t *json_find_member(json_node_t *object, const char *key);
 json_node_t *json_first_child(const json_node_t *node);
+double       json_get_number(const json_node_t *node);
 
 #define json_foreach(i, object_or_array)         \
   for ((i) = json_first_child(object_or_array);  \
@@ -107,6 +256,8 @@ json_node_t *json_mknull(void);
 json_node_t *json_mkbool(bool b);
 json_node_t *json_mkstring(const char *str);
 json_node_t *json_mknumber(double num);
+json_node_t *json_mkint64(int64_t num);
+json_node_t *json_mkuint64(uint64_t num);
 json_node_t *json_mkarray(void);
 json_node_t *json_mkobject(void);
 
@@ -116,6 +267,73 @@ void json_append_member(json_node_t *object, const char *key, json_node_t *val);
 void json_prepend_member(json_node_t *object, const char *key, json_node_t *val);
 void json_remove_from_parent(json_node_t *node);
 
+/*
+ * Arena-backed trees.
+ *
+ * Nodes, keys and strings of an arena tree are carved out of chunked blocks
+ * owned by the tree's root.  Deleting the root releases the whole tree at
+ * once; deleting any other node merely detaches it.  `json_decode' always
+ * returns an arena tree.  Nodes from different arenas, or from an arena and
+ * the heap, must not be mixed within one tree.
+ */
+json_node_t *json_arena_mkroot(json_tag_t tag);
+json_node_t *json_arena_mknull(const json_node_t *tree);
+json_node_t *json_arena_mkbool(const json_node_t *tree, bool b);
+json_node_t *json_arena_mkstring(const json_node_t *tree, const char *str);
+json_node_t *json_arena_mknumber(const json_node_t *tree, double num);
+json_node_t *json_arena_mkint64(const json_node_t *tree, int64_t num);
+json_node_t *json_arena_mkuint64(const json_node_t *tree, uint64_t num);
+json_node_t *json_arena_mkarray(const json_node_t *tree);
+json_node_t *json_arena_mkobject(const json_node_t *tree);
+
+void    json_writer_init(json_writer_t *writer);
+void    json_writer_set_format(json_writer_t *writer, json_format_t format);
+void    json_writer_set_sink(json_writer_t *writer,
+                             json_sink_t    sink,
+                             void          *data);
+void    json_writer_reset(json_writer_t *writer);
+char   *json_writer_finish(json_writer_t *writer);
+size_t  json_writer_length(const json_writer_t *writer);
+void    json_writer_free(json_writer_t *writer);
+
+void json_write_begin_object(json_writer_t *writer);
+void json_write_end_object(json_writer_t *writer);
+void json_write_begin_array(json_writer_t *writer);
+void json_write_end_array(json_writer_t *writer);
+void json_write_key(json_writer_t *writer, const char *key);
+void json_write_string(json_writer_t *writer, const char *str);
+void json_write_number(json_writer_t *writer, double num);
+void json_write_int64(json_writer_t *writer, int64_t num);
+void json_write_uint64(json_writer_t *writer, uint64_t num);
+void json_write_bool(json_writer_t *writer, bool b);
+void json_write_null(json_writer_t *writer);
+void json_write_raw(json_writer_t *writer, const char *json, size_t len);
+void json_writer_splice(json_writer_t *writer,
+                        size_t         offset,
+                        size_t         old_len,
+                        const char    *data,
+                        size_t         len);
+
+void json_template_init(json_template_t *tpl);
+void json_template_hole(json_template_t *tpl, json_hole_kind_t kind);
+void json_template_finish(json_template_t *tpl);
+void json_template_render(const json_template_t   *tpl,
+                          json_writer_t           *out,
+                          const json_hole_value_t *values);
+void json_template_free(json_template_t *tpl);
+
+void json_index_init(json_index_t *index);
+bool json_index_build(json_index_t *index, const char *json, size_t len);
+int  json_index_find(const json_index_t *index,
+                     int                 parent,
+                     const char         *key,
+                     size_t              len);
+int  json_index_lookup(const json_index_t *index,
+                       int                 parent,
+                       const char         *path,
+                       char                sep);
+void json_index_free(json_index_t *index);
+
 #endif /* !_json_h_ */
 
 /* json.h ends here. */
@@ -52,6 +52,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 #include <syslog.h>
 #include <time.h>
 
@@ -68,11 +69,8 @@
 #include "httpd.h"
 #include "utils.h"
 
-#include "sm_uname.h"
-#include "sm_smver.h"
-#include "sm_info.h"
-#include "sm_cpu.h"
-#include "sm_all.h"
+#define SM_MODULE(__name, __init) void __init(void);
+#include "modules.def"
 
 #if PLATFORM_EQ(PLATFORM_BSD)
 # if PLATFORM_LT(PLATFORM_BSD, PLATFORM_BSDOS)
@@ -442,6 +440,52 @@ handle_read(connect_t *conn, struct timeval *tv)
   fdwatch_add_fd(hconn->conn_fd, conn, FDW_WRITE);
 }
 
+#if defined(IOV_MAX) && IOV_MAX < 64
+# define GATHER_MAX IOV_MAX
+#else
+# define GATHER_MAX 64
+#endif
+
+/*
+ * Write whatever is left of the header along with the gathered body, from
+ * `next_byte_idx' onwards, in one writev().
+ */
+static
+ssize_t
+send_gathered(connect_t *conn, ssize_t max_bytes)
+{
+  struct iovec  iv[GATHER_MAX];
+  http_conn_t  *hconn = conn->conn;
+  off_t         skip  = conn->next_byte_idx;
+  size_t        left  = (size_t)max_bytes;
+  size_t        len   = 0;
+  int           n     = 0;
+  int           i     = 0;
+
+  if (hconn->response_len > 0) {
+    iv[n].iov_base = hconn->response;
+    iv[n].iov_len  = hconn->response_len;
+    n++;
+  }
+
+  for (i = 0; i < hconn->data_iovcnt && n < GATHER_MAX && left > 0; i++) {
+    len = hconn->data_iov[i].iov_len;
+
+    if ((off_t)len <= skip) {
+      skip -= len;
+      continue;
+    }
+
+    iv[n].iov_base = (char *)hconn->data_iov[i].iov_base + skip;
+    iv[n].iov_len  = MIN(len - (size_t)skip, left);
+    left          -= iv[n].iov_len;
+    skip           = 0;
+    n++;
+  }
+
+  return writev(hconn->conn_fd, iv, n);
+}
+
 static
 void
 handle_send(connect_t *conn, struct timeval *tv)
@@ -451,7 +495,9 @@ handle_send(connect_t *conn, struct timeval *tv)
   timer_clientdata_t  cd        = JunkClientData;
   http_conn_t        *hconn     = conn->conn;
   
-  if (hconn->response_len == 0) {
+  if (hconn->data_iovcnt > 0) {
+    sz = send_gathered(conn, max_bytes);
+  } else if (hconn->response_len == 0) {
     sz = write(hconn->conn_fd,
                &(hconn->data_address[conn->next_byte_idx]),
                MIN(conn->end_byte_idx - conn->next_byte_idx, max_bytes));
@@ -596,11 +642,8 @@ main(void)
   tmr_init();
   endpoint_init();
 
-  sm_uname_init();
-  sm_smver_init();
-  sm_info_init();
-  sm_cpu_init();
-  sm_all_init();
+#define SM_MODULE(__name, __init) __init();
+#include "modules.def"
 
   addr.sa_in.sin_family      = AF_INET;
   addr.sa_in.sin_addr.s_addr = htonl(INADDR_ANY);
@@ -0,0 +1,142 @@
+/*
+ * mkroutes.c --- Generate the built-in route table.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 15:06:40
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ * Build-time helper, not part of the daemon.  Reads the names listed in
+ * modules.def and writes routes.h on standard output: a table indexed by
+ * `str_hash_seeded(name, ROUTE_SEED) & ROUTE_MASK' in which every name
+ * has a slot of its own.  The seed is found by trying them in turn.
+ */
+/* }}} */
+
+/**
+ * @file mkroutes.c
+ * @author Paul Ward
+ * @brief Generate the built-in route table.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "utils.h"
+
+#define MAX_SEEDS  1000000UL
+
+static const char *names[] = {
+#define SM_MODULE(__name, __init) #__name,
+#define SM_ROUTE(__name)          #__name,
+#include "modules.def"
+  NULL
+};
+
+int
+main(void)
+{
+  unsigned long  seed  = 0;
+  size_t         count = 0;
+  size_t         size  = 1;
+  size_t         i     = 0;
+  int           *slots = NULL;
+  int            ok    = 0;
+
+  while (names[count] != NULL) {
+    count++;
+  }
+
+  /* At most half full keeps the search short. */
+  while (size < count * 2) {
+    size *= 2;
+  }
+
+  slots = xmalloc(size * sizeof(int));
+
+  for (seed = 1; seed < MAX_SEEDS && !ok; seed++) {
+    for (i = 0; i < size; i++) {
+      slots[i] = -1;
+    }
+
+    for (ok = 1, i = 0; i < count && ok; i++) {
+      size_t slot = str_hash_seeded(names[i], seed) & (size - 1);
+
+      if (slots[slot] != -1) {
+        ok = 0;
+      } else {
+        slots[slot] = (int)i;
+      }
+    }
+  }
+
+  if (!ok) {
+    fprintf(stderr, "mkroutes: no perfect hash for %lu names\n",
+            (unsigned long)count);
+    return EXIT_FAILURE;
+  }
+
+  printf("/*\n"
+         " * routes.h --- Built-in route table.\n"
+         " *\n"
+         " * Generated by mkroutes from modules.def.  Do not edit.\n"
+         " */\n\n"
+         "#ifndef _routes_h_\n"
+         "#define _routes_h_\n\n"
+         "#define ROUTE_SEED  %luUL\n"
+         "#define ROUTE_MASK  %luUL\n\n"
+         "static const route_entry_t route_table[%lu] = {\n",
+         seed - 1,
+         (unsigned long)(size - 1),
+         (unsigned long)size);
+
+  for (i = 0; i < size; i++) {
+    if (slots[i] == -1) {
+      printf("  { NULL, ROUTE_NONE },\n");
+    } else {
+      printf("  { \"%s\", ROUTE_%s },\n", names[slots[i]], names[slots[i]]);
+    }
+  }
+
+  printf("};\n\n"
+         "#endif /* !_routes_h_ */\n\n"
+         "/* routes.h ends here. */\n");
+
+  free(slots);
+
+  return EXIT_SUCCESS;
+}
+
+/* mkroutes.c ends here. */
@@ -0,0 +1,380 @@
+/*
+ * procfs.c --- Cheap re-reads of procfs and sysfs files.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 15:40:31
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ * Collectors sample the same handful of files every tick.  Opening,
+ * reading and closing each one, then picking it apart with `sscanf', costs
+ * far more than the kernel spends producing the text, so files are kept
+ * open and re-read with `pread', and parsed in place.
+ */
+/* }}} */
+
+/**
+ * @file procfs.c
+ * @author Paul Ward
+ * @brief Cheap re-reads of procfs and sysfs files.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <syslog.h>
+
+#include "procfs.h"
+#include "utils.h"
+
+#define IS_SPACE(__c) ((__c) == ' ' || (__c) == '\t')
+
+/* {{{ Files: */
+
+/*
+ * Open `path' for sampling, with room for `size' bytes to begin with.
+ * Failing to open is not logged; plenty of files are optional.
+ */
+bool
+procfs_open(procfs_file_t *file, const char *path, size_t size)
+{
+  file->path   = NULL;
+  file->buf    = NULL;
+  file->size   = size < 64 ? 64 : size;
+  file->length = 0;
+  file->fd     = open(path, O_RDONLY);
+
+  if (file->fd < 0) {
+    return false;
+  }
+
+  file->path   = xmalloc(strlen(path) + 1);
+  file->buf    = xmalloc(file->size);
+  file->buf[0] = '\0';
+
+  strcpy(file->path, path);
+
+  return true;
+}
+
+/*
+ * Read the whole file again.  Returns its length, or -1.
+ */
+ssize_t
+procfs_read(procfs_file_t *file)
+{
+  ssize_t len = 0;
+
+  if (file->fd < 0) {
+    return -1;
+  }
+
+  for (;;) {
+    len = pread(file->fd, file->buf, file->size - 1, 0);
+
+    if (len < 0) {
+      syslog(LOG_ERR, "Could not read %s: %s", file->path, strerror(errno));
+      return -1;
+    }
+
+    if ((size_t)len < file->size - 1) {
+      break;
+    }
+
+    /* It may not all have fitted; try again with more room. */
+    file->size *= 2;
+    file->buf   = xrealloc(file->buf, file->size);
+  }
+
+  file->buf[len] = '\0';
+  file->length   = len;
+
+  return len;
+}
+
+void
+procfs_close(procfs_file_t *file)
+{
+  if (file->fd >= 0) {
+    close(file->fd);
+    file->fd = -1;
+  }
+
+  MAYBE_FREE(file->buf);
+  MAYBE_FREE(file->path);
+
+  file->size   = 0;
+  file->length = 0;
+}
+
+/*
+ * Read a small file that is only wanted once, such as a sysfs attribute,
+ * into `buf'.  Trailing white space is dropped.  Returns the length, or -1.
+ */
+ssize_t
+procfs_read_once(const char *path, char *buf, size_t size)
+{
+  ssize_t len = 0;
+  int     fd  = open(path, O_RDONLY);
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  len = read(fd, buf, size - 1);
+  close(fd);
+
+  if (len < 0) {
+    return -1;
+  }
+
+  while (len > 0 && (IS_SPACE(buf[len - 1]) || buf[len - 1] == '\n')) {
+    len--;
+  }
+
+  buf[len] = '\0';
+
+  return len;
+}
+
+/* }}} */
+/* {{{ Scanning: */
+
+void
+procfs_scan_init(procfs_scan_t *scan, const char *buf, size_t len)
+{
+  scan->pos = buf;
+  scan->end = buf + len;
+}
+
+void
+procfs_scan_file(procfs_scan_t *scan, const procfs_file_t *file)
+{
+  procfs_scan_init(scan, file->buf, file->buf ? file->length : 0);
+}
+
+/*
+ * Take the next line, without its newline, off the front of `scan'.
+ */
+bool
+procfs_next_line(procfs_scan_t *scan, procfs_scan_t *line)
+{
+  const char *nl = NULL;
+
+  if (procfs_empty(scan)) {
+    return false;
+  }
+
+  nl = memchr(scan->pos, '\n', procfs_length(scan));
+
+  line->pos = scan->pos;
+  line->end = nl ? nl : scan->end;
+  scan->pos = nl ? nl + 1 : scan->end;
+
+  return true;
+}
+
+/*
+ * Take the next white-space delimited word off the front of `scan'.
+ */
+bool
+procfs_next_token(procfs_scan_t *scan, procfs_scan_t *token)
+{
+  procfs_skip_space(scan);
+
+  token->pos = scan->pos;
+
+  while (scan->pos < scan->end &&
+         !IS_SPACE(*scan->pos)  &&
+         *scan->pos != '\n')
+  {
+    scan->pos++;
+  }
+
+  token->end = scan->pos;
+
+  return !procfs_empty(token);
+}
+
+/*
+ * Split `scan' at the first `sep': `head' gets what comes before it, and
+ * `scan' keeps what follows.  If there is no `sep', nothing changes.
+ */
+bool
+procfs_split(procfs_scan_t *scan, char sep, procfs_scan_t *head)
+{
+  const char *at = NULL;
+
+  if (procfs_empty(scan)) {
+    return false;
+  }
+
+  at = memchr(scan->pos, sep, procfs_length(scan));
+
+  if (at == NULL) {
+    return false;
+  }
+
+  head->pos = scan->pos;
+  head->end = at;
+  scan->pos = at + 1;
+
+  return true;
+}
+
+void
+procfs_skip_space(procfs_scan_t *scan)
+{
+  while (scan->pos < scan->end && IS_SPACE(*scan->pos)) {
+    scan->pos++;
+  }
+}
+
+/*
+ * Drop white space from both ends.
+ */
+void
+procfs_trim(procfs_scan_t *scan)
+{
+  procfs_skip_space(scan);
+
+  while (scan->end > scan->pos &&
+         (IS_SPACE(scan->end[-1]) || scan->end[-1] == '\n'))
+  {
+    scan->end--;
+  }
+}
+
+/*
+ * If `scan' starts with `prefix', step over it.
+ */
+bool
+procfs_prefix(procfs_scan_t *scan, const char *prefix)
+{
+  size_t len = strlen(prefix);
+
+  if (procfs_length(scan) < len || memcmp(scan->pos, prefix, len) != 0) {
+    return false;
+  }
+
+  scan->pos += len;
+
+  return true;
+}
+
+bool
+procfs_equal(const procfs_scan_t *scan, const char *str)
+{
+  size_t len = strlen(str);
+
+  return procfs_length(scan) == len && memcmp(scan->pos, str, len) == 0;
+}
+
+/*
+ * Take an unsigned decimal number off the front of `scan', after any white
+ * space.  Stops at the first non-digit; no digits at all reads as zero.
+ */
+uint64_t
+procfs_u64(procfs_scan_t *scan)
+{
+  uint64_t val = 0;
+
+  procfs_skip_space(scan);
+
+  while (scan->pos < scan->end && *scan->pos >= '0' && *scan->pos <= '9') {
+    val = val * 10 + (*scan->pos++ - '0');
+  }
+
+  return val;
+}
+
+int64_t
+procfs_i64(procfs_scan_t *scan)
+{
+  procfs_skip_space(scan);
+
+  if (scan->pos < scan->end && *scan->pos == '-') {
+    scan->pos++;
+    return -(int64_t)procfs_u64(scan);
+  }
+
+  return (int64_t)procfs_u64(scan);
+}
+
+/*
+ * Take a fixed-point number such as `0.25' or `12' off the front of
+ * `scan'.  There is no exponent and no sign, which is all the kernel ever
+ * prints.
+ */
+double
+procfs_fixed(procfs_scan_t *scan)
+{
+  uint64_t whole = procfs_u64(scan);
+  uint64_t frac  = 0;
+  double   scale = 1.0;
+
+  if (scan->pos < scan->end && *scan->pos == '.') {
+    scan->pos++;
+
+    /* Dividing once, at the end, keeps `0.30' printing as 0.3. */
+    while (scan->pos < scan->end && *scan->pos >= '0' && *scan->pos <= '9') {
+      frac   = frac * 10 + (*scan->pos++ - '0');
+      scale *= 10.0;
+    }
+  }
+
+  return ((double)whole * scale + (double)frac) / scale;
+}
+
+/*
+ * Copy `scan' into `dst' as a string, truncating to fit.
+ */
+size_t
+procfs_copy(const procfs_scan_t *scan, char *dst, size_t size)
+{
+  size_t len = MIN(procfs_length(scan), size - 1);
+
+  memcpy(dst, scan->pos, len);
+  dst[len] = '\0';
+
+  return len;
+}
+
+/* }}} */
+
+/* procfs.c ends here. */
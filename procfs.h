@@ -0,0 +1,114 @@
+/*
+ * procfs.h --- Cheap re-reads of procfs and sysfs files.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 15:40:12
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file procfs.h
+ * @author Paul Ward
+ * @brief Cheap re-reads of procfs and sysfs files.
+ */
+
+#ifndef _procfs_h_
+#define _procfs_h_
+
+#include "config.h"
+
+#include <sys/types.h>
+
+#ifdef HAVE_STDBOOL_H
+# include <stdbool.h>
+#else
+# include "posix/stdbool.h"
+#endif
+
+#if PLATFORM_LT(PLATFORM_BSD, PLATFORM_BSDOS)
+# include "posix/stdint.h"
+#else
+# include <stdint.h>
+#endif
+
+/*
+ * A file that is sampled over and over.  It is opened once and kept open;
+ * each read is a single `pread' from offset 0 into a buffer that belongs to
+ * the file and only grows when the file outgrows it.  The contents are
+ * always NUL-terminated.
+ */
+typedef struct {
+  char       *path;                     /* Our own copy. */
+  int         fd;
+  char       *buf;
+  size_t      size;                     /* Bytes allocated to `buf'. */
+  size_t      length;                   /* Bytes read last time. */
+} procfs_file_t;
+
+/*
+ * A view of part of a buffer.  Scanning functions consume from the front;
+ * nothing is copied, and the buffer is never written to.
+ */
+typedef struct {
+  const char *pos;
+  const char *end;
+} procfs_scan_t;
+
+bool     procfs_open(procfs_file_t *file, const char *path, size_t size);
+ssize_t  procfs_read(procfs_file_t *file);
+void     procfs_close(procfs_file_t *file);
+ssize_t  procfs_read_once(const char *path, char *buf, size_t size);
+
+void     procfs_scan_init(procfs_scan_t *scan, const char *buf, size_t len);
+void     procfs_scan_file(procfs_scan_t *scan, const procfs_file_t *file);
+bool     procfs_next_line(procfs_scan_t *scan, procfs_scan_t *line);
+bool     procfs_next_token(procfs_scan_t *scan, procfs_scan_t *token);
+bool     procfs_split(procfs_scan_t *scan, char sep, procfs_scan_t *head);
+void     procfs_skip_space(procfs_scan_t *scan);
+void     procfs_trim(procfs_scan_t *scan);
+bool     procfs_prefix(procfs_scan_t *scan, const char *prefix);
+bool     procfs_equal(const procfs_scan_t *scan, const char *str);
+uint64_t procfs_u64(procfs_scan_t *scan);
+int64_t  procfs_i64(procfs_scan_t *scan);
+double   procfs_fixed(procfs_scan_t *scan);
+size_t   procfs_copy(const procfs_scan_t *scan, char *dst, size_t size);
+
+#define procfs_empty(__s)   ((__s)->pos >= (__s)->end)
+#define procfs_length(__s)  ((size_t)((__s)->end - (__s)->pos))
+
+#endif /* !_procfs_h_ */
+
+/* procfs.h ends here. */
@@ -0,0 +1,311 @@
+/*
+ * router.c --- Radix-tree path router.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 15:21:40
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file router.c
+ * @author Paul Ward
+ * @brief Radix-tree path router.
+ *
+ * Literal text is stored compressed: every edge carries as long a string
+ * as the patterns share, and no two children of a node start with the same
+ * byte.  Matching therefore looks at each byte of the path about once,
+ * only backing up when literal text leads somewhere with no route and a
+ * parameter has to be tried instead.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+
+#include "utils.h"
+#include "router.h"
+
+struct router_node_s {
+  char          *label;                 /* Literal text leading here. */
+  size_t         length;
+  router_node_t *children;              /* Literal children. */
+  router_node_t *sibling;
+  router_node_t *param;                 /* Child matching one segment. */
+  char          *param_name;            /* If this is such a child. */
+  char          *rest_name;             /* `*name' starting here, if any. */
+  const void    *rest_value;
+  const void    *value;                 /* Set if a route ends here. */
+};
+
+static
+char *
+strndup_x(const char *str, size_t len)
+{
+  char *ret = xmalloc(len + 1);
+
+  memcpy(ret, str, len);
+  ret[len] = '\0';
+
+  return ret;
+}
+
+static
+router_node_t *
+node_new(const char *label, size_t len)
+{
+  router_node_t *node = xcalloc(1, sizeof(router_node_t));
+
+  node->label  = strndup_x(label, len);
+  node->length = len;
+
+  return node;
+}
+
+/*
+ * Walk `len' bytes of literal `text' down from `node', splitting edges and
+ * adding nodes as needed.  Returns the node at the end of the text.
+ */
+static
+router_node_t *
+insert_literal(router_node_t *node, const char *text, size_t len)
+{
+  router_node_t *child  = NULL;
+  router_node_t *tail   = NULL;
+  size_t         common = 0;
+
+  while (len > 0) {
+    for (child = node->children; child != NULL; child = child->sibling) {
+      if (child->label[0] == text[0]) {
+        break;
+      }
+    }
+
+    if (child == NULL) {
+      child           = node_new(text, len);
+      child->sibling  = node->children;
+      node->children  = child;
+
+      return child;
+    }
+
+    for (common = 0;
+         common < child->length && common < len &&
+           child->label[common] == text[common];
+         common++)
+    {
+      ;
+    }
+
+    /* Split `child' so that its edge ends where the texts diverge. */
+    if (common < child->length) {
+      tail             = node_new(child->label + common,
+                                  child->length - common);
+      tail->children   = child->children;
+      tail->param      = child->param;
+      tail->rest_name  = child->rest_name;
+      tail->rest_value = child->rest_value;
+      tail->value      = child->value;
+
+      child->length     = common;
+      child->children   = tail;
+      child->param      = NULL;
+      child->rest_name  = NULL;
+      child->rest_value = NULL;
+      child->value      = NULL;
+    }
+
+    node  = child;
+    text += common;
+    len  -= common;
+  }
+
+  return node;
+}
+
+void
+router_init(router_t *router)
+{
+  router->root = node_new("", 0);
+}
+
+void
+router_add(router_t *router, const char *pattern, const void *value)
+{
+  router_node_t *node = NULL;
+  const char    *p    = pattern;
+  const char    *end  = NULL;
+  char          *name = NULL;
+
+  if (router->root == NULL) {
+    router_init(router);
+  }
+
+  node = router->root;
+
+  while (*p != '\0') {
+    if (*p == ':' && (p == pattern || p[-1] == '/')) {
+      end = p + strcspn(p, "/");
+
+      if (node->param == NULL) {
+        node->param             = node_new("", 0);
+        node->param->param_name = strndup_x(p + 1, end - p - 1);
+      } else if (strncmp(node->param->param_name, p + 1, end - p - 1) != 0) {
+        syslog(LOG_WARNING, "Route %s renames parameter :%s",
+               pattern,
+               node->param->param_name);
+      }
+
+      node = node->param;
+      p    = end;
+    } else if (*p == '*' && (p == pattern || p[-1] == '/')) {
+      name = strndup_x(p + 1, strlen(p + 1));
+
+      MAYBE_FREE(node->rest_name);
+      node->rest_name  = name;
+      node->rest_value = value;
+
+      return;
+    } else {
+      for (end = p + 1; *end != '\0'; end++) {
+        if ((*end == ':' || *end == '*') && end[-1] == '/') {
+          break;
+        }
+      }
+
+      node = insert_literal(node, p, end - p);
+      p    = end;
+    }
+  }
+
+  node->value = value;
+}
+
+static
+void
+push_param(route_match_t *match,
+           const char    *name,
+           const char    *value,
+           size_t         length)
+{
+  route_param_t *param = &match->params[match->nparams++];
+
+  param->name   = name;
+  param->value  = value;
+  param->length = length;
+}
+
+static
+const void *
+match_node(const router_node_t *node, const char *path, route_match_t *match)
+{
+  const router_node_t *child = NULL;
+  const void          *value = NULL;
+  int                  saved = match->nparams;
+  size_t               seg   = 0;
+
+  if (*path == '\0') {
+    return node->value;
+  }
+
+  for (child = node->children; child != NULL; child = child->sibling) {
+    if (child->label[0] == *path) {
+      if (strncmp(path, child->label, child->length) == 0) {
+        value = match_node(child, path + child->length, match);
+        if (value != NULL) {
+          return value;
+        }
+      }
+
+      break;
+    }
+  }
+
+  if (node->param != NULL && match->nparams < ROUTER_MAX_PARAMS) {
+    seg = strcspn(path, "/");
+
+    if (seg > 0) {
+      push_param(match, node->param->param_name, path, seg);
+
+      value = match_node(node->param, path + seg, match);
+      if (value != NULL) {
+        return value;
+      }
+
+      match->nparams = saved;
+    }
+  }
+
+  if (node->rest_value != NULL && match->nparams < ROUTER_MAX_PARAMS) {
+    push_param(match, node->rest_name, path, strlen(path));
+    return node->rest_value;
+  }
+
+  return NULL;
+}
+
+/*
+ * Find the route for `path', filling in `match' with its parameters.
+ * Returns the value the route was added with, or NULL.
+ */
+const void *
+router_match(const router_t *router, const char *path, route_match_t *match)
+{
+  match->nparams = 0;
+
+  if (router->root == NULL) {
+    return NULL;
+  }
+
+  return match_node(router->root, path, match);
+}
+
+const route_param_t *
+route_param(const route_match_t *match, const char *name)
+{
+  int i = 0;
+
+  for (i = 0; i < match->nparams; i++) {
+    if (strcmp(match->params[i].name, name) == 0) {
+      return &match->params[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* router.c ends here. */
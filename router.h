@@ -0,0 +1,91 @@
+/*
+ * router.h --- Radix-tree path router.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 15:21:05
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file router.h
+ * @author Paul Ward
+ * @brief Radix-tree path router.
+ */
+
+#ifndef _router_h_
+#define _router_h_
+
+#include <sys/types.h>
+
+#define ROUTER_MAX_PARAMS  8
+
+/*
+ * A value captured from the path.  `value' points into the path that was
+ * matched and is `length' bytes long; it is only NUL-terminated when it
+ * runs to the end of the path, as a `*' parameter always does.
+ */
+typedef struct {
+  const char *name;
+  const char *value;
+  size_t      length;
+} route_param_t;
+
+typedef struct {
+  route_param_t params[ROUTER_MAX_PARAMS];
+  int           nparams;
+} route_match_t;
+
+typedef struct router_node_s router_node_t;
+
+/*
+ * Patterns are `/'-separated.  A segment of the form `:name' matches any
+ * one non-empty segment; a final `*name' matches the non-empty remainder of
+ * the path.  Literal text beats `:name', which beats `*name'.
+ */
+typedef struct {
+  router_node_t *root;
+} router_t;
+
+void        router_init(router_t *router);
+void        router_add(router_t *router, const char *pattern, const void *value);
+const void *router_match(const router_t *router,
+                         const char     *path,
+                         route_match_t  *match);
+const route_param_t *route_param(const route_match_t *match, const char *name);
+
+#endif /* !_router_h_ */
+
+/* router.h ends here. */
@@ -55,39 +55,83 @@
 #include "version.h"
 #include "utils.h"
 
-static endpoint_t *all_endpoint = NULL;
-static sm_all_t   *all_instance = NULL;
+/*
+ * Where each module's document sits inside the `/all' buffer.  The buffer
+ * is composed once from the cached module buffers; afterwards an update to
+ * a module only patches that module's slot.
+ */
+typedef struct {
+  const sm_base_t *inst;
+  size_t           offset;
+  size_t           length;
+} all_slot_t;
+
+static endpoint_t *all_endpoint  = NULL;
+static sm_all_t   *all_instance  = NULL;
+static all_slot_t *all_slots     = NULL;
+static int         all_nslots    = 0;
+static int         all_max_slots = 0;
 
+/*
+ * Compose `/all' from scratch.  Modules are not asked to re-emit; their
+ * cached `json_buffer' is copied in verbatim.
+ */
 void
-emit_all(json_node_t **out)
+emit_all(json_writer_t *out)
 {
-  json_node_t       *ret  = out ? json_mkobject() : NULL;
   endpoint_t        *node = NULL;
+  const char        *buf  = NULL;
+  size_t             len  = 0;
   extern endpoint_t *endpoints;
 
+  if (out->format == JSON_FORMAT_TEXT) {
+    all_nslots = 0;
+  }
+
+  json_write_begin_object(out);
+
   endpoint_foreach(node) {
-    json_node_t *obj  = NULL;
-    sm_base_t   *inst = NULL;
+    sm_base_t  *inst = NULL;
+    all_slot_t *slot = NULL;
 
     /* Infinite loops are bad. */
-    if (node->hash == all_endpoint->hash) {
+    if (node == all_endpoint) {
       continue;
     }
 
-    if (node != NULL) {
-      inst = (sm_base_t *)node->instance;
+    inst = (sm_base_t *)node->instance;
 
-      (inst->vtab->emit_json)(&obj);
+    if (inst->vtab->json_buffer  == NULL ||
+        inst->vtab->content_type != NULL)
+    {
+      continue;
+    }
 
-      if (obj != NULL) {
-        json_append_member(ret, node->name, obj);
-      }
+    json_write_key(out, node->name);
+
+    /* Only the JSON text is patched in place. */
+    if (out->format != JSON_FORMAT_TEXT) {
+      buf = encode_json(inst, (sm_encoding_t)out->format, &len);
+      json_write_raw(out, buf, len);
+      continue;
     }
-  }
 
-  if (out) {
-    *out = ret;
+    if (all_nslots == all_max_slots) {
+      all_max_slots = all_max_slots ? all_max_slots * 2 : 8;
+      all_slots     = xrealloc(all_slots, all_max_slots * sizeof(all_slot_t));
+    }
+
+    slot         = &all_slots[all_nslots];
+    slot->inst   = inst;
+    slot->offset = json_writer_length(out);
+    slot->length = inst->vtab->json_length;
+
+    inst->vtab->all_slot = all_nslots++;
+
+    json_write_raw(out, inst->vtab->json_buffer, inst->vtab->json_length);
   }
+
+  json_write_end_object(out);
 }
 
 void
@@ -97,12 +141,7 @@ sm_all_init(void)
     all_instance       = xmalloc(sizeof(sm_all_t));
     all_instance->vtab = xmalloc(sizeof(sm_vtable_t));
 
-    all_instance->vtab->get_data  = NULL;
-    all_instance->vtab->emit_json = &emit_all;
-    all_instance->vtab->only_once = 0;
-
-    all_instance->vtab->json_buffer = NULL;
-    all_instance->vtab->json_length = 0;
+    MAKE_VTABLE(all_instance, NULL, &emit_all, 0);
   }
 
   if (all_endpoint == NULL) {
@@ -110,9 +149,18 @@ sm_all_init(void)
   }
 }
 
+/*
+ * Patch `endpoint's fresh document into `/all'.
+ */
 void
 sm_all_update(sm_base_t *endpoint)
 {
+  sm_vtable_t *vt   = NULL;
+  all_slot_t  *slot = NULL;
+  size_t       len  = 0;
+  int          idx  = 0;
+  int          i    = 0;
+
   if (endpoint     == (sm_base_t *)all_instance ||
       all_instance == NULL                  ||
       endpoint     == NULL)
@@ -120,7 +168,40 @@ sm_all_update(sm_base_t *endpoint)
     return;
   }
 
-  generate_json((sm_base_t *)all_instance);
+  vt = all_instance->vtab;
+
+  /* Not composed yet; that will happen on the first request. */
+  if (vt->json_buffer == NULL) {
+    return;
+  }
+
+  idx = endpoint->vtab->all_slot;
+
+  /* A module we have not seen before; compose again from scratch. */
+  if (idx < 0 || idx >= all_nslots || all_slots[idx].inst != endpoint) {
+    vt->json_buffer = NULL;
+    vt->json_length = 0;
+    return;
+  }
+
+  slot = &all_slots[idx];
+  len  = endpoint->vtab->json_length;
+
+  json_writer_splice(&vt->writer,
+                     slot->offset,
+                     slot->length,
+                     endpoint->vtab->json_buffer,
+                     len);
+
+  for (i = idx + 1; i < all_nslots; i++) {
+    all_slots[i].offset = all_slots[i].offset - slot->length + len;
+  }
+
+  slot->length = len;
+
+  vt->json_buffer = json_writer_finish(&vt->writer);
+  vt->json_length = json_writer_length(&vt->writer);
+  vt->generation++;
 }
 
 /* sm_all.c ends here. */
@@ -0,0 +1,769 @@
+/*
+ * sm_cgroup.c --- Control group usage.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 19:02:31
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_cgroup.c
+ * @author Paul Ward
+ * @brief Control group usage.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <limits.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+# include <sys/inotify.h>
+#endif
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_cgroup.h"
+#include "endpoints.h"
+#include "timers.h"
+#include "fdwatch.h"
+#include "utils.h"
+#include "procfs.h"
+
+/*
+ * A member of a flat-keyed file, such as `cpu.stat'.
+ */
+typedef struct {
+  cgroup_file_t   file;
+  const char     *key;
+  cgroup_value_t  value;
+} cgroup_key_t;
+
+/*
+ * A run of values emitted as one object, present when `file' is.
+ */
+typedef struct {
+  const char     *name;
+  cgroup_file_t   file;
+  cgroup_value_t  first;
+  cgroup_value_t  last;
+} cgroup_section_t;
+
+static endpoint_t        *cgroup_endpoint    = NULL;
+static sm_cgroup_t       *cgroup_instance    = NULL;
+static timer_task_t      *cgroup_timer_task  = NULL;
+static json_template_t    cgroup_template;
+static int                cgroup_template_ok = 0;
+static json_hole_value_t *cgroup_values      = NULL;
+static int                cgroup_max_values  = 0;
+static struct timeval     cgroup_last;
+static char               cgroup_root[PATH_MAX];
+static int                cgroup_notify      = -1;
+
+static const char strName[]         = "cgroup";
+static const char strUpdated[]      = "updatedAt";
+static const char strRoot[]         = "root";
+static const char strGroups[]       = "groups";
+static const char strUsage[]        = "usage";
+static const char strPids[]         = "pids";
+
+static const char *file_names[CG_NFILES] = {
+  "cpu.stat",
+  "memory.current",
+  "memory.stat",
+  "io.stat",
+  "pids.current"
+};
+
+static const size_t file_sizes[CG_NFILES] = {
+  1024,
+  64,
+  4096,
+  1024,
+  64
+};
+
+static const char *value_names[CG_NVALUES] = {
+  "usageUsec",
+  "userUsec",
+  "systemUsec",
+  "nrThrottled",
+  "throttledUsec",
+  "current",
+  "anon",
+  "file",
+  "kernel",
+  "shmem",
+  "majorFaults",
+  "readBytes",
+  "writeBytes",
+  "reads",
+  "writes",
+  "pids"
+};
+
+static const cgroup_key_t keys[] = {
+  { CG_CPU_STAT,    "usage_usec",     CG_CPU_USAGE          },
+  { CG_CPU_STAT,    "user_usec",      CG_CPU_USER           },
+  { CG_CPU_STAT,    "system_usec",    CG_CPU_SYSTEM         },
+  { CG_CPU_STAT,    "nr_throttled",   CG_CPU_THROTTLED      },
+  { CG_CPU_STAT,    "throttled_usec", CG_CPU_THROTTLED_USEC },
+  { CG_MEMORY_STAT, "anon",           CG_MEM_ANON           },
+  { CG_MEMORY_STAT, "file",           CG_MEM_FILE           },
+  { CG_MEMORY_STAT, "kernel",         CG_MEM_KERNEL         },
+  { CG_MEMORY_STAT, "shmem",          CG_MEM_SHMEM          },
+  { CG_MEMORY_STAT, "pgmajfault",     CG_MEM_MAJFAULT       },
+  { CG_IO_STAT,     "rbytes",         CG_IO_RBYTES          },
+  { CG_IO_STAT,     "wbytes",         CG_IO_WBYTES          },
+  { CG_IO_STAT,     "rios",           CG_IO_RIOS            },
+  { CG_IO_STAT,     "wios",           CG_IO_WIOS            }
+};
+
+static const cgroup_section_t sections[] = {
+  { "cpu",    CG_CPU_STAT,       CG_CPU_USAGE,   CG_CPU_THROTTLED_USEC },
+  { "memory", CG_MEMORY_CURRENT, CG_MEM_CURRENT, CG_MEM_MAJFAULT       },
+  { "io",     CG_IO_STAT,        CG_IO_RBYTES,   CG_IO_WIOS            }
+};
+
+#define NKEYS     (sizeof(keys) / sizeof(keys[0]))
+#define NSECTIONS (sizeof(sections) / sizeof(sections[0]))
+
+/* {{{ Sampling: */
+
+static
+void
+set_key(cgroup_table_t         *tab,
+        int                     slot,
+        cgroup_file_t           file,
+        const procfs_scan_t    *key,
+        uint64_t                value,
+        bool                    sum)
+{
+  size_t i = 0;
+
+  for (i = 0; i < NKEYS; i++) {
+    if (keys[i].file == file && procfs_equal(key, keys[i].key)) {
+      if (sum) {
+        tab->value[keys[i].value][slot] += value;
+      } else {
+        tab->value[keys[i].value][slot]  = value;
+      }
+
+      return;
+    }
+  }
+}
+
+/*
+ * Read a group's files again.  `cpu.stat' and `memory.stat' are lines of
+ * `key value'; `io.stat' has a line of `key=value' pairs per device,
+ * which are summed:
+ *
+ *   8:0 rbytes=1459200 wbytes=314773504 rios=192 wios=353 dbytes=0 dios=0
+ */
+static
+void
+cgroup_sample(cgroup_table_t *tab, int slot)
+{
+  cgroup_group_t *grp = &tab->groups[slot];
+  procfs_scan_t   scan;
+  procfs_scan_t   line;
+  procfs_scan_t   key;
+  procfs_scan_t   pair;
+  int             f   = 0;
+  int             i   = 0;
+
+  for (i = 0; i < CG_NVALUES; i++) {
+    tab->value[i][slot] = 0;
+  }
+
+  for (f = 0; f < CG_NFILES; f++) {
+    if (grp->file[f].fd < 0 || procfs_read(&grp->file[f]) < 0) {
+      continue;
+    }
+
+    procfs_scan_file(&scan, &grp->file[f]);
+
+    switch (f) {
+      case CG_MEMORY_CURRENT:
+        tab->value[CG_MEM_CURRENT][slot] = procfs_u64(&scan);
+        break;
+
+      case CG_PIDS_CURRENT:
+        tab->value[CG_PIDS][slot] = procfs_u64(&scan);
+        break;
+
+      case CG_IO_STAT:
+        while (procfs_next_line(&scan, &line)) {
+          procfs_next_token(&line, &key);
+
+          while (procfs_next_token(&line, &pair)) {
+            if (procfs_split(&pair, '=', &key)) {
+              set_key(tab, slot, f, &key, procfs_u64(&pair), true);
+            }
+          }
+        }
+        break;
+
+      default:
+        while (procfs_next_line(&scan, &line)) {
+          if (procfs_next_token(&line, &key)) {
+            set_key(tab, slot, f, &key, procfs_u64(&line), false);
+          }
+        }
+        break;
+    }
+  }
+}
+
+/* }}} */
+/* {{{ Groups: */
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static
+void
+full_path(const char *path, char *buf, size_t size)
+{
+  snprintf(buf, size, "%s%s", cgroup_root, strcmp(path, "/") ? path : "");
+}
+
+static
+int
+cgroup_find(const cgroup_table_t *tab, const char *path)
+{
+  int i = 0;
+
+  for (i = 0; i < tab->count; i++) {
+    if (strcmp(tab->groups[i].path, path) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static
+int
+cgroup_find_watch(const cgroup_table_t *tab, int wd)
+{
+  int i = 0;
+
+  for (i = 0; i < tab->count; i++) {
+    if (tab->groups[i].wd == wd) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/*
+ * Start following a group: watch it for children, and open its files.
+ */
+static
+void
+cgroup_add(cgroup_table_t *tab, const char *path)
+{
+  cgroup_group_t *grp = NULL;
+  char            dir[PATH_MAX];
+  char            file[PATH_MAX + 32];
+  int             wd  = -1;
+  int             i   = 0;
+
+  full_path(path, dir, sizeof(dir));
+
+  wd = inotify_add_watch(cgroup_notify,
+                         dir,
+                         IN_CREATE | IN_DELETE | IN_MOVE | IN_ONLYDIR);
+
+  if (wd < 0) {
+    /* It has gone again already. */
+    if (errno != ENOENT) {
+      syslog(LOG_ERR, "Could not watch %s: %s", dir, strerror(errno));
+    }
+
+    return;
+  }
+
+  if (tab->count == tab->size) {
+    tab->size       = tab->size ? tab->size * 2 : 32;
+    tab->groups     = xrealloc(tab->groups,
+                               tab->size * sizeof(cgroup_group_t));
+    tab->prev_usage = xrealloc(tab->prev_usage,
+                               tab->size * sizeof(uint64_t));
+    tab->cpu        = xrealloc(tab->cpu, tab->size * sizeof(double));
+
+    for (i = 0; i < CG_NVALUES; i++) {
+      tab->value[i] = xrealloc(tab->value[i], tab->size * sizeof(uint64_t));
+    }
+  }
+
+  grp       = &tab->groups[tab->count];
+  grp->path = xmalloc(strlen(path) + 1);
+  grp->wd   = wd;
+
+  strcpy(grp->path, path);
+
+  /*
+   * Each group holds a descriptor per file it has, so a host with many
+   * groups needs a generous descriptor limit.
+   */
+  for (i = 0; i < CG_NFILES; i++) {
+    snprintf(file, sizeof(file), "%s/%s", dir, file_names[i]);
+    procfs_open(&grp->file[i], file, file_sizes[i]);
+  }
+
+  cgroup_sample(tab, tab->count);
+  tab->prev_usage[tab->count] = tab->value[CG_CPU_USAGE][tab->count];
+  tab->cpu[tab->count]        = 0.0;
+
+  tab->count++;
+  tab->changed = true;
+}
+
+/*
+ * Add a group and everything below it.  A new group may already have
+ * children by the time its creation is noticed.
+ */
+static
+void
+cgroup_walk(cgroup_table_t *tab, const char *path)
+{
+  struct dirent *ent = NULL;
+  DIR           *dir = NULL;
+  char           buf[PATH_MAX];
+  char           child[PATH_MAX];
+
+  if (cgroup_find(tab, path) < 0) {
+    cgroup_add(tab, path);
+  }
+
+  full_path(path, buf, sizeof(buf));
+
+  if ((dir = opendir(buf)) == NULL) {
+    return;
+  }
+
+  while ((ent = readdir(dir)) != NULL) {
+    if (ent->d_type != DT_DIR || ent->d_name[0] == '.') {
+      continue;
+    }
+
+    snprintf(child,
+             sizeof(child),
+             "%s/%s",
+             strcmp(path, "/") ? path : "",
+             ent->d_name);
+    cgroup_walk(tab, child);
+  }
+
+  closedir(dir);
+}
+
+static
+void
+cgroup_remove(cgroup_table_t *tab, int slot)
+{
+  cgroup_group_t *grp  = &tab->groups[slot];
+  int             tail = tab->count - slot - 1;
+  int             i    = 0;
+
+  /* The watch is usually gone with the directory. */
+  inotify_rm_watch(cgroup_notify, grp->wd);
+
+  for (i = 0; i < CG_NFILES; i++) {
+    procfs_close(&grp->file[i]);
+  }
+
+  free(grp->path);
+
+  memmove(&tab->groups[slot],
+          &tab->groups[slot + 1],
+          tail * sizeof(cgroup_group_t));
+  memmove(&tab->prev_usage[slot],
+          &tab->prev_usage[slot + 1],
+          tail * sizeof(uint64_t));
+  memmove(&tab->cpu[slot], &tab->cpu[slot + 1], tail * sizeof(double));
+
+  for (i = 0; i < CG_NVALUES; i++) {
+    memmove(&tab->value[i][slot],
+            &tab->value[i][slot + 1],
+            tail * sizeof(uint64_t));
+  }
+
+  tab->count--;
+  tab->changed = true;
+}
+
+/*
+ * Forget a group and anything still listed below it.
+ */
+static
+void
+cgroup_prune(cgroup_table_t *tab, const char *path)
+{
+  size_t len = strlen(path);
+  int    i   = 0;
+
+  for (i = 0; i < tab->count; ) {
+    if (strncmp(tab->groups[i].path, path, len) == 0 &&
+        (tab->groups[i].path[len] == '\0' ||
+         tab->groups[i].path[len] == '/'))
+    {
+      cgroup_remove(tab, i);
+    } else {
+      i++;
+    }
+  }
+}
+
+/*
+ * Groups were created, removed or renamed.  If the kernel dropped events,
+ * start again from the top.
+ */
+static
+void
+cgroup_event(int fd, void *data)
+{
+  cgroup_table_t             *tab = &cgroup_instance->table;
+  const struct inotify_event *ev  = NULL;
+  char                        path[PATH_MAX];
+  ssize_t                     len    = 0;
+  ssize_t                     off    = 0;
+  bool                        lost   = false;
+  int                         parent = -1;
+
+  /* Suitably aligned for the events. */
+  union {
+    struct inotify_event ev;
+    char                 buf[4096];
+  } u;
+
+  while ((len = read(fd, u.buf, sizeof(u.buf))) > 0) {
+    for (off = 0; off < len; off += sizeof(*ev) + ev->len) {
+      ev = (const struct inotify_event *)(u.buf + off);
+
+      if (ev->mask & IN_Q_OVERFLOW) {
+        lost = true;
+        continue;
+      }
+
+      if (!(ev->mask & IN_ISDIR) || ev->len == 0) {
+        continue;
+      }
+
+      if ((parent = cgroup_find_watch(tab, ev->wd)) < 0) {
+        continue;
+      }
+
+      snprintf(path,
+               sizeof(path),
+               "%s/%s",
+               strcmp(tab->groups[parent].path, "/")
+                 ? tab->groups[parent].path
+                 : "",
+               ev->name);
+
+      if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+        cgroup_walk(tab, path);
+      } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        cgroup_prune(tab, path);
+      }
+    }
+  }
+
+  /* Any group may have gone unnoticed, so forget them all. */
+  if (lost) {
+    while (tab->count > 0) {
+      cgroup_remove(tab, tab->count - 1);
+    }
+
+    cgroup_walk(tab, "/");
+  }
+
+  if (tab->changed) {
+    generate_json((sm_base_t *)cgroup_instance);
+  }
+}
+
+/*
+ * Pick the unified hierarchy: mounted on /sys/fs/cgroup itself, or beside
+ * the v1 controllers on a hybrid host.
+ */
+static
+bool
+find_root(void)
+{
+  static const char *roots[] = {
+    "/sys/fs/cgroup",
+    "/sys/fs/cgroup/unified"
+  };
+  struct stat  st;
+  char         buf[PATH_MAX];
+  size_t       i = 0;
+
+  for (i = 0; i < sizeof(roots) / sizeof(roots[0]); i++) {
+    snprintf(buf, sizeof(buf), "%s/cgroup.controllers", roots[i]);
+
+    if (stat(buf, &st) == 0) {
+      snprintf(cgroup_root, sizeof(cgroup_root), "%s", roots[i]);
+      return true;
+    }
+  }
+
+  return false;
+}
+#endif
+
+/* }}} */
+
+void
+get_cgroup(void *data)
+{
+  sm_cgroup_t    *ptr  = (sm_cgroup_t *)data;
+  cgroup_table_t *tab  = &ptr->table;
+  struct timeval  now;
+  uint64_t        used = 0;
+  double          secs = 0.0;
+  int             i    = 0;
+
+  gettimeofday(&now, NULL);
+
+  secs = elapsed_secs(&cgroup_last, &now);
+
+  for (i = 0; i < tab->count; i++) {
+    cgroup_sample(tab, i);
+
+    used         = tab->value[CG_CPU_USAGE][i] - tab->prev_usage[i];
+    tab->cpu[i]  = 0.0;
+
+    if (secs > 0 && tab->value[CG_CPU_USAGE][i] >= tab->prev_usage[i]) {
+      tab->cpu[i] = round2((double)used / (secs * 10000.0));
+    }
+
+    tab->prev_usage[i] = tab->value[CG_CPU_USAGE][i];
+  }
+
+  if (tab->changed && cgroup_template_ok) {
+    json_template_free(&cgroup_template);
+    cgroup_template_ok = 0;
+  }
+
+  tab->changed = false;
+  ptr->time    = now.tv_sec;
+  cgroup_last  = now;
+}
+
+void
+cgroup_timer(timer_clientdata_t data, struct timeval *now)
+{
+#ifdef DEBUG
+  printf("TIMER FIRE - Updating cgroups\n");
+#endif
+
+  generate_json((sm_base_t *)cgroup_instance);
+}
+
+/*
+ * The document only changes shape when groups come or go.  A group has a
+ * section for each controller whose files it has.
+ */
+static
+void
+make_cgroup_template(void)
+{
+  json_template_t *tpl  = &cgroup_template;
+  json_writer_t   *w    = &tpl->writer;
+  cgroup_table_t  *tab  = &cgroup_instance->table;
+  cgroup_group_t  *grp  = NULL;
+  size_t           s    = 0;
+  int              slot = 0;
+  int              i    = 0;
+
+  json_template_init(tpl);
+
+  json_write_begin_object(w);
+
+  json_write_key(w, strUpdated);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+  json_write_key(w, strRoot);
+  json_write_string(w, cgroup_root);
+
+  json_write_key(w, strGroups);
+  json_write_begin_object(w);
+
+  for (slot = 0; slot < tab->count; slot++) {
+    grp = &tab->groups[slot];
+
+    json_write_key(w, grp->path);
+    json_write_begin_object(w);
+
+    for (s = 0; s < NSECTIONS; s++) {
+      if (grp->file[sections[s].file].fd < 0) {
+        continue;
+      }
+
+      json_write_key(w, sections[s].name);
+      json_write_begin_object(w);
+
+      if (sections[s].file == CG_CPU_STAT) {
+        json_write_key(w, strUsage);
+        json_template_hole(tpl, JSON_HOLE_NUMBER);
+      }
+
+      for (i = sections[s].first; i <= (int)sections[s].last; i++) {
+        json_write_key(w, value_names[i]);
+        json_template_hole(tpl, JSON_HOLE_UINT64);
+      }
+
+      json_write_end_object(w);
+    }
+
+    if (grp->file[CG_PIDS_CURRENT].fd >= 0) {
+      json_write_key(w, strPids);
+      json_template_hole(tpl, JSON_HOLE_UINT64);
+    }
+
+    json_write_end_object(w);
+  }
+
+  json_write_end_object(w);
+
+  json_write_end_object(w);
+
+  json_template_finish(tpl);
+  cgroup_template_ok = 1;
+
+  if (tpl->nholes > cgroup_max_values) {
+    cgroup_max_values = tpl->nholes;
+    cgroup_values     = xrealloc(cgroup_values,
+                                 cgroup_max_values * sizeof(json_hole_value_t));
+  }
+}
+
+void
+emit_cgroup(json_writer_t *out)
+{
+  cgroup_table_t *tab  = &cgroup_instance->table;
+  cgroup_group_t *grp  = NULL;
+  size_t          s    = 0;
+  int             hole = 0;
+  int             slot = 0;
+  int             i    = 0;
+
+  if (!cgroup_template_ok) {
+    make_cgroup_template();
+  }
+
+  cgroup_values[hole++]._int64 = cgroup_instance->time;
+
+  for (slot = 0; slot < tab->count; slot++) {
+    grp = &tab->groups[slot];
+
+    for (s = 0; s < NSECTIONS; s++) {
+      if (grp->file[sections[s].file].fd < 0) {
+        continue;
+      }
+
+      if (sections[s].file == CG_CPU_STAT) {
+        cgroup_values[hole++]._number = tab->cpu[slot];
+      }
+
+      for (i = sections[s].first; i <= (int)sections[s].last; i++) {
+        cgroup_values[hole++]._uint64 = tab->value[i][slot];
+      }
+    }
+
+    if (grp->file[CG_PIDS_CURRENT].fd >= 0) {
+      cgroup_values[hole++]._uint64 = tab->value[CG_PIDS][slot];
+    }
+  }
+
+  json_template_render(&cgroup_template, out, cgroup_values);
+}
+
+void
+sm_cgroup_init(void)
+{
+  if (cgroup_instance == NULL) {
+    cgroup_instance       = xcalloc(1, sizeof(sm_cgroup_t));
+    cgroup_instance->vtab = xmalloc(sizeof(sm_vtable_t));
+
+    MAKE_VTABLE(cgroup_instance, &get_cgroup, &emit_cgroup, 0);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+    if (!find_root()) {
+      syslog(LOG_ERR, "No cgroup v2 hierarchy found");
+    } else if ((cgroup_notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) {
+      syslog(LOG_ERR, "Could not create inotify instance: %s",
+             strerror(errno));
+    } else {
+      cgroup_walk(&cgroup_instance->table, "/");
+      fdwatch_add_handler(cgroup_notify, FDW_READ, &cgroup_event, NULL);
+    }
+#endif
+
+    generate_json((sm_base_t *)cgroup_instance);
+  }
+
+  if (cgroup_endpoint == NULL) {
+    cgroup_endpoint = endpoint_create(strName, cgroup_instance);
+  }
+
+  if (cgroup_timer_task == NULL) {
+    timer_clientdata_t data;
+
+    data.l = 0;
+    cgroup_timer_task = tmr_create(NULL,
+                                   &cgroup_timer,
+                                   data,
+                                   5000,
+                                   1);
+  }
+}
+
+/* sm_cgroup.c ends here. */
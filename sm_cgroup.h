@@ -0,0 +1,119 @@
+/*
+ * sm_cgroup.h --- Control group usage.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 19:02:16
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_cgroup.h
+ * @author Paul Ward
+ * @brief Control group usage.
+ */
+
+#ifndef _sm_cgroup_h_
+#define _sm_cgroup_h_
+
+#include <sys/types.h>
+
+#include "vtable.h"
+#include "procfs.h"
+
+/*
+ * Files read from each group.  Which of them exist depends on the
+ * controllers enabled for the group.
+ */
+typedef enum {
+  CG_CPU_STAT,
+  CG_MEMORY_CURRENT,
+  CG_MEMORY_STAT,
+  CG_IO_STAT,
+  CG_PIDS_CURRENT,
+  CG_NFILES
+} cgroup_file_t;
+
+typedef enum {
+  CG_CPU_USAGE,                         /* Microseconds. */
+  CG_CPU_USER,
+  CG_CPU_SYSTEM,
+  CG_CPU_THROTTLED,                     /* Periods. */
+  CG_CPU_THROTTLED_USEC,
+  CG_MEM_CURRENT,                       /* Bytes. */
+  CG_MEM_ANON,
+  CG_MEM_FILE,
+  CG_MEM_KERNEL,
+  CG_MEM_SHMEM,
+  CG_MEM_MAJFAULT,
+  CG_IO_RBYTES,                         /* Summed over all devices. */
+  CG_IO_WBYTES,
+  CG_IO_RIOS,
+  CG_IO_WIOS,
+  CG_PIDS,
+  CG_NVALUES
+} cgroup_value_t;
+
+typedef struct {
+  char          *path;                  /* Relative to the root; "/" for it. */
+  int            wd;                    /* inotify watch. */
+  procfs_file_t  file[CG_NFILES];       /* Closed where missing. */
+} cgroup_group_t;
+
+/*
+ * Every group in the hierarchy.  Groups only come and go on inotify
+ * events; their files are kept open and read again every tick.
+ */
+typedef struct {
+  int             count;
+  int             size;
+  bool            changed;              /* Groups differ from last time. */
+  cgroup_group_t *groups;
+  uint64_t       *value[CG_NVALUES];
+  uint64_t       *prev_usage;           /* CG_CPU_USAGE last tick. */
+  double         *cpu;                  /* Percent of one CPU. */
+} cgroup_table_t;
+
+typedef struct {
+  sm_vtable_t    *vtab;
+  cgroup_table_t  table;
+  time_t          time;                 /* Update time. */
+} sm_cgroup_t;
+
+void sm_cgroup_init(void);
+
+#endif /* !_sm_cgroup_h_ */
+
+/* sm_cgroup.h ends here. */
@@ -48,20 +48,47 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <strings.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <syslog.h>
 #include <time.h>
 
 #include "config.h"
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+# include <sys/utsname.h>
+# include <dirent.h>
+#endif
+
 #include "json.h"
 #include "vtable.h"
 #include "sm_cpu.h"
 #include "endpoints.h"
 #include "timers.h"
 #include "utils.h"
+#include "procfs.h"
 
-static endpoint_t   *cpu_endpoint   = NULL;
-static sm_cpu_t     *cpu_instance   = NULL;
-static timer_task_t *cpu_timer_task = NULL;
+static endpoint_t        *cpu_endpoint    = NULL;
+static sm_cpu_t          *cpu_instance    = NULL;
+static timer_task_t      *cpu_timer_task  = NULL;
+static json_template_t    cpu_template;
+static int                cpu_template_ok = 0;
+static json_hole_value_t *cpu_values      = NULL;
+static int                cpu_max_values  = 0;
+
+/*
+ * Holes in the CPU template, in document order.
+ */
+enum {
+  CPU_HOLE_UPDATED,
+  CPU_HOLE_WORD_SIZE,
+  CPU_HOLE_CLOCK_SPEED,
+  CPU_HOLE_NUM_ONLINE,
+  CPU_HOLE_NUM_CONF,
+  CPU_NHOLES                            /* Usage and then each core follow. */
+};
 
 static const char strUnknown[]      = "unknown";
 static const char strName[]         = "cpu";
@@ -72,6 +99,56 @@ static const char strWordSize[]     = "wordSize";
 static const char strArchitecture[] = "architecture";
 static const char strModelName[]    = "model";
 static const char strUpdated[]      = "updatedAt";
+static const char strUsage[]        = "usage";
+static const char strCores[]        = "cores";
+static const char strId[]           = "id";
+static const char strCoreParam[]    = "core";
+static const char strCoreRoute[]    = "cpu/:core";
+static const char strTopology[]     = "topology";
+static const char strSockets[]      = "sockets";
+static const char strNumCores[]     = "cores";
+static const char strThreads[]      = "threads";
+static const char strPerCore[]      = "threadsPerCore";
+static const char strCaches[]       = "caches";
+static const char strLevel[]        = "level";
+static const char strType[]         = "type";
+static const char strSize[]         = "size";
+static const char strShared[]       = "shared";
+static const char strSocket[]       = "socket";
+static const char strCore[]         = "core";
+
+/*
+ * Keys for each of `cpu_pct_t'.
+ */
+static const char *pct_names[CPU_NPCTS] = {
+  "user",
+  "system",
+  "iowait",
+  "steal",
+  "idle"
+};
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static const char strProcStat[]     = "/proc/stat";
+static const char strProcCpuinfo[]  = "/proc/cpuinfo";
+static const char strSysCpu[]       = "/sys/devices/system/cpu";
+
+/*
+ * `/proc/cpuinfo' keys naming the model, by preference.  x86 uses the
+ * first, MIPS the second, older ARM the third and POWER the last.
+ */
+static const char *model_keys[] = {
+  "model name",
+  "cpu model",
+  "Processor",
+  "cpu",
+  NULL
+};
+
+static char          cpu_model[128];
+static char          cpu_arch[65];
+static procfs_file_t stat_file;
+#endif
 
 #if PLATFORM_EQ(PLATFORM_BSD)
 # if PLATFORM_GTE(PLATFORM_BSD, PLATFORM_ULTRIX)
@@ -81,6 +158,518 @@ extern      printf();
 # endif
 #endif
 
+/* {{{ Utilisation: */
+
+/*
+ * Make room for `slots' CPUs.  New slots have no previous sample.
+ */
+static
+void
+cpu_stat_grow(cpu_stat_t *st, int slots)
+{
+  int i = 0;
+
+  if (slots <= st->size) {
+    return;
+  }
+
+  st->id = xrealloc(st->id, slots * sizeof(int));
+
+  for (i = 0; i < CPU_NTICKS; i++) {
+    st->ticks[i] = xrealloc(st->ticks[i], slots * sizeof(uint64_t));
+    st->prev[i]  = xrealloc(st->prev[i], slots * sizeof(uint64_t));
+  }
+
+  for (i = 0; i < CPU_NPCTS; i++) {
+    st->pct[i] = xrealloc(st->pct[i], slots * sizeof(double));
+  }
+
+  for (i = st->size; i < slots; i++) {
+    st->id[i] = -2;                     /* Matches no line. */
+  }
+
+  st->size = slots;
+}
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+/*
+ * Pull the `cpu' lines out of /proc/stat into `st->ticks'.  A slot whose CPU
+ * is not the one it held last time loses its previous sample.
+ */
+static
+void
+parse_proc_stat(cpu_stat_t *st, const procfs_file_t *file)
+{
+  procfs_scan_t scan;
+  procfs_scan_t line;
+  int           slot = 0;
+  int           id   = 0;
+  int           i    = 0;
+
+  procfs_scan_file(&scan, file);
+
+  while (procfs_next_line(&scan, &line)) {
+    if (!procfs_prefix(&line, "cpu")) {
+      continue;
+    }
+
+    id = procfs_empty(&line) || *line.pos == ' '
+      ? -1
+      : (int)procfs_u64(&line);
+
+    cpu_stat_grow(st, slot + 1);
+
+    if (slot >= st->count || st->id[slot] != id) {
+      st->id[slot] = id;
+      st->changed  = true;
+
+      for (i = 0; i < CPU_NTICKS; i++) {
+        st->prev[i][slot] = 0;
+      }
+    }
+
+    /* Older kernels have fewer columns; the rest read as zero. */
+    for (i = 0; i < CPU_NTICKS; i++) {
+      st->ticks[i][slot] = procfs_u64(&line);
+    }
+
+    slot++;
+  }
+
+  if (slot != st->count) {
+    st->changed = true;
+  }
+
+  st->count = slot;
+}
+#endif
+
+/*
+ * `part' as a percentage of `total', to two decimal places.
+ */
+static
+double
+cpu_percent(uint64_t part, uint64_t total)
+{
+  if (total == 0) {
+    return 0.0;
+  }
+
+  return round2((double)part * 100.0 / (double)total);
+}
+
+/*
+ * Turn the difference between the two samples into percentages, then keep
+ * the latest sample as the previous one.
+ */
+static
+void
+cpu_stat_update(cpu_stat_t *st)
+{
+  uint64_t  delta[CPU_NTICKS];
+  uint64_t  total = 0;
+  uint64_t *swap  = NULL;
+  int       slot  = 0;
+  int       i     = 0;
+
+  for (slot = 0; slot < st->count; slot++) {
+    total = 0;
+
+    /* Some counters, iowait notably, can step backwards. */
+    for (i = 0; i < CPU_NTICKS; i++) {
+      delta[i] = st->ticks[i][slot] > st->prev[i][slot]
+        ? st->ticks[i][slot] - st->prev[i][slot]
+        : 0;
+      total   += delta[i];
+    }
+
+    st->pct[CPU_PCT_USER][slot]   =
+      cpu_percent(delta[CPU_TICK_USER] + delta[CPU_TICK_NICE], total);
+    st->pct[CPU_PCT_SYSTEM][slot] =
+      cpu_percent(delta[CPU_TICK_SYSTEM] +
+                  delta[CPU_TICK_IRQ]    +
+                  delta[CPU_TICK_SOFTIRQ],
+                  total);
+    st->pct[CPU_PCT_IOWAIT][slot] = cpu_percent(delta[CPU_TICK_IOWAIT], total);
+    st->pct[CPU_PCT_STEAL][slot]  = cpu_percent(delta[CPU_TICK_STEAL], total);
+    st->pct[CPU_PCT_IDLE][slot]   = cpu_percent(delta[CPU_TICK_IDLE], total);
+  }
+
+  for (i = 0; i < CPU_NTICKS; i++) {
+    swap         = st->prev[i];
+    st->prev[i]  = st->ticks[i];
+    st->ticks[i] = swap;
+  }
+}
+
+/*
+ * Slot holding `cpuN', or -1.
+ */
+static
+int
+cpu_stat_slot(const cpu_stat_t *st, int id)
+{
+  int slot = 0;
+
+  for (slot = 1; slot < st->count; slot++) {
+    if (st->id[slot] == id) {
+      return slot;
+    }
+  }
+
+  return -1;
+}
+
+/* }}} */
+
+/* {{{ Topology: */
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+/*
+ * Read a small sysfs attribute as an integer.
+ */
+static
+bool
+read_sys_long(const char *path, long *val)
+{
+  procfs_scan_t scan;
+  char          buf[64];
+  ssize_t       len = procfs_read_once(path, buf, sizeof(buf));
+
+  if (len <= 0) {
+    return false;
+  }
+
+  procfs_scan_init(&scan, buf, len);
+  *val = (long)procfs_i64(&scan);
+
+  return true;
+}
+
+/*
+ * Number of CPUs in a list such as `0-3,8-11'.
+ */
+static
+int
+count_cpu_list(const char *list, size_t len)
+{
+  procfs_scan_t scan;
+  procfs_scan_t range;
+  uint64_t      first = 0;
+  uint64_t      last  = 0;
+  int           count = 0;
+
+  procfs_scan_init(&scan, list, len);
+
+  while (!procfs_empty(&scan)) {
+    if (!procfs_split(&scan, ',', &range)) {
+      range    = scan;
+      scan.pos = scan.end;
+    }
+
+    first = procfs_u64(&range);
+    last  = procfs_prefix(&range, "-") ? procfs_u64(&range) : first;
+
+    if (last >= first) {
+      count += (int)(last - first + 1);
+    }
+  }
+
+  return count;
+}
+
+static
+void
+cpu_topo_grow(cpu_topo_t *topo, int count)
+{
+  int i = 0;
+
+  if (count <= topo->count) {
+    return;
+  }
+
+  topo->present   = xrealloc(topo->present, count * sizeof(bool));
+  topo->package   = xrealloc(topo->package, count * sizeof(int));
+  topo->core      = xrealloc(topo->core, count * sizeof(int));
+  topo->freq_file = xrealloc(topo->freq_file, count * sizeof(procfs_file_t));
+  topo->freq      = xrealloc(topo->freq, count * sizeof(long));
+
+  for (i = topo->count; i < count; i++) {
+    topo->present[i]      = false;
+    topo->package[i]      = -1;
+    topo->core[i]         = -1;
+    topo->freq_file[i].fd = -1;
+    topo->freq[i]         = 0;
+  }
+
+  topo->count = count;
+}
+
+/*
+ * Walk `/sys/devices/system/cpu/cpuN', noting where each CPU sits and
+ * keeping its frequency file open for sampling.
+ */
+static
+void
+probe_topology(sm_cpu_t *ptr)
+{
+  cpu_topo_t    *topo = &ptr->topo;
+  DIR           *dir  = NULL;
+  struct dirent *ent  = NULL;
+  procfs_scan_t  name;
+  char           path[256];
+  long           val  = 0;
+  int            id   = 0;
+  int            i    = 0;
+  int            j    = 0;
+
+  dir = opendir(strSysCpu);
+
+  if (dir == NULL) {
+    syslog(LOG_ERR, "Could not open %s: %s", strSysCpu, strerror(errno));
+    return;
+  }
+
+  while ((ent = readdir(dir)) != NULL) {
+    procfs_scan_init(&name, ent->d_name, strlen(ent->d_name));
+
+    if (!procfs_prefix(&name, "cpu")   ||
+        procfs_empty(&name)            ||
+        *name.pos < '0' || *name.pos > '9')
+    {
+      continue;
+    }
+
+    id = (int)procfs_u64(&name);
+
+    if (!procfs_empty(&name)) {
+      continue;
+    }
+
+    cpu_topo_grow(topo, id + 1);
+    topo->present[id] = true;
+
+    snprintf(path, sizeof(path),
+             "%s/cpu%d/topology/physical_package_id", strSysCpu, id);
+    if (read_sys_long(path, &val)) {
+      topo->package[id] = (int)val;
+    }
+
+    snprintf(path, sizeof(path), "%s/cpu%d/topology/core_id", strSysCpu, id);
+    if (read_sys_long(path, &val)) {
+      topo->core[id] = (int)val;
+    }
+
+    snprintf(path, sizeof(path),
+             "%s/cpu%d/cpufreq/scaling_cur_freq", strSysCpu, id);
+    procfs_open(&topo->freq_file[id], path, 32);
+  }
+
+  closedir(dir);
+
+  /* Count distinct packages and distinct (package, core) pairs. */
+  for (i = 0; i < topo->count; i++) {
+    if (!topo->present[i]) {
+      continue;
+    }
+
+    ptr->threads++;
+
+    for (j = 0; j < i; j++) {
+      if (topo->present[j] && topo->package[j] == topo->package[i]) {
+        break;
+      }
+    }
+
+    if (j == i) {
+      ptr->sockets++;
+    }
+
+    for (j = 0; j < i; j++) {
+      if (topo->present[j]                     &&
+          topo->package[j] == topo->package[i] &&
+          topo->core[j]    == topo->core[i])
+      {
+        break;
+      }
+    }
+
+    if (j == i) {
+      ptr->cores++;
+    }
+  }
+}
+
+/*
+ * The cache hierarchy as seen from the first CPU.
+ */
+static
+void
+probe_caches(sm_cpu_t *ptr)
+{
+  cpu_cache_t  *cache = NULL;
+  procfs_scan_t scan;
+  char          path[256];
+  char          buf[256];
+  ssize_t       len   = 0;
+  long          val   = 0;
+  int           i     = 0;
+
+  for (i = 0; i < CPU_MAX_CACHES; i++) {
+    snprintf(path, sizeof(path), "%s/cpu0/cache/index%d/level", strSysCpu, i);
+    if (!read_sys_long(path, &val)) {
+      break;
+    }
+
+    cache        = &ptr->caches[ptr->num_caches++];
+    cache->level = (int)val;
+
+    snprintf(path, sizeof(path), "%s/cpu0/cache/index%d/type", strSysCpu, i);
+    if (procfs_read_once(path, cache->type, sizeof(cache->type)) < 0) {
+      strcpy(cache->type, strUnknown);
+    }
+
+    /* Sizes come as `48K' or `2M'. */
+    snprintf(path, sizeof(path), "%s/cpu0/cache/index%d/size", strSysCpu, i);
+    len = procfs_read_once(path, buf, sizeof(buf));
+    if (len > 0) {
+      procfs_scan_init(&scan, buf, len);
+      cache->size = (long)procfs_u64(&scan);
+
+      if (procfs_prefix(&scan, "M")) {
+        cache->size *= 1024;
+      }
+    }
+
+    snprintf(path, sizeof(path),
+             "%s/cpu0/cache/index%d/shared_cpu_list", strSysCpu, i);
+    len = procfs_read_once(path, buf, sizeof(buf));
+    if (len > 0) {
+      cache->shared = count_cpu_list(buf, len);
+    }
+  }
+}
+
+/*
+ * Take the model from `/proc/cpuinfo', along with each CPU's clock for
+ * machines that have no cpufreq driver.
+ */
+static
+void
+probe_cpuinfo(sm_cpu_t *ptr)
+{
+  cpu_topo_t    *topo = &ptr->topo;
+  procfs_file_t  file;
+  procfs_scan_t  scan;
+  procfs_scan_t  line;
+  procfs_scan_t  key;
+  int            cur  = -1;
+  int            i    = 0;
+
+  if (!procfs_open(&file, strProcCpuinfo, 16384)) {
+    syslog(LOG_ERR, "Could not open %s: %s", strProcCpuinfo, strerror(errno));
+    return;
+  }
+
+  if (procfs_read(&file) < 0) {
+    procfs_close(&file);
+    return;
+  }
+
+  procfs_scan_file(&scan, &file);
+
+  while (procfs_next_line(&scan, &line)) {
+    if (!procfs_split(&line, ':', &key)) {
+      continue;
+    }
+
+    /* Keys are padded with tabs and spaces up to the colon. */
+    procfs_trim(&key);
+    procfs_trim(&line);
+
+    if (procfs_equal(&key, "processor")) {
+      cur = (int)procfs_u64(&line);
+      continue;
+    }
+
+    if (procfs_equal(&key, "cpu MHz")) {
+      if (cur >= 0 && cur < topo->count && topo->freq[cur] == 0) {
+        topo->freq[cur] = (long)procfs_u64(&line);
+      }
+
+      continue;
+    }
+
+    if (cpu_model[0] != '\0') {
+      continue;
+    }
+
+    for (i = 0; model_keys[i] != NULL; i++) {
+      if (procfs_equal(&key, model_keys[i])) {
+        procfs_copy(&line, cpu_model, sizeof(cpu_model));
+        break;
+      }
+    }
+  }
+
+  procfs_close(&file);
+}
+
+/*
+ * Refresh each CPU's clock from its open `scaling_cur_freq' and return the
+ * mean across them, in MHz.
+ */
+static
+long
+sample_freq(cpu_topo_t *topo)
+{
+  procfs_scan_t scan;
+  long          total = 0;
+  int           count = 0;
+  int           i     = 0;
+
+  for (i = 0; i < topo->count; i++) {
+    if (procfs_read(&topo->freq_file[i]) > 0) {
+      procfs_scan_file(&scan, &topo->freq_file[i]);
+      topo->freq[i] = (long)(procfs_u64(&scan) / 1000);
+    }
+
+    if (topo->present[i] && topo->freq[i] > 0) {
+      total += topo->freq[i];
+      count++;
+    }
+  }
+
+  return count ? total / count : 0;
+}
+#endif
+
+/*
+ * Work out what the machine is made of.  This only happens once.
+ */
+static
+void
+probe_cpu(sm_cpu_t *ptr)
+{
+#if PLATFORM_EQ(PLATFORM_LINUX)
+  struct utsname name;
+
+  if (uname(&name) == 0) {
+    snprintf(cpu_arch, sizeof(cpu_arch), "%s", name.machine);
+  }
+
+  probe_topology(ptr);
+  probe_caches(ptr);
+  probe_cpuinfo(ptr);
+
+  if (!procfs_open(&stat_file, strProcStat, 4096)) {
+    syslog(LOG_ERR, "Could not open %s: %s", strProcStat, strerror(errno));
+  }
+#endif
+}
+
+/* }}} */
+
 void
 get_cpu(void *data)
 {
@@ -93,6 +682,18 @@ get_cpu(void *data)
   ptr->word_size      = __WORDSIZE;
   ptr->architecture   = (char *)strUnknown;
   ptr->model          = (char *)strUnknown;
+#elif PLATFORM_EQ(PLATFORM_LINUX)
+  ptr->num_configured = sysconf(_SC_NPROCESSORS_CONF);
+  ptr->num_online     = sysconf(_SC_NPROCESSORS_ONLN);
+  ptr->clock_speed    = sample_freq(&ptr->topo);
+  ptr->word_size      = __WORDSIZE;
+  ptr->architecture   = cpu_arch[0]  ? cpu_arch  : (char *)strUnknown;
+  ptr->model          = cpu_model[0] ? cpu_model : (char *)strUnknown;
+
+  if (procfs_read(&stat_file) >= 0) {
+    parse_proc_stat(&ptr->stat, &stat_file);
+    cpu_stat_update(&ptr->stat);
+  }
 #else
   ptr->num_configured = sysconf(_SC_NPROCESSORS_CONF);
   ptr->num_online     = sysconf(_SC_NPROCESSORS_ONLN);
@@ -102,6 +703,12 @@ get_cpu(void *data)
   ptr->model          = (char *)strUnknown;
 #endif
 
+  if (ptr->stat.changed && cpu_template_ok) {
+    json_template_free(&cpu_template);
+    cpu_template_ok = 0;
+  }
+
+  ptr->stat.changed   = false;
   ptr->time           = time(NULL);
 }
 
@@ -115,52 +722,255 @@ cpu_timer(timer_clientdata_t data, struct timeval *now)
   generate_json((sm_base_t *)cpu_instance);
 }
 
+/*
+ * Write one set of utilisation figures as holes.
+ */
+static
+void
+make_pct_holes(json_template_t *tpl)
+{
+  int i = 0;
+
+  for (i = 0; i < CPU_NPCTS; i++) {
+    json_write_key(&tpl->writer, pct_names[i]);
+    json_template_hole(tpl, JSON_HOLE_NUMBER);
+  }
+}
+
+/*
+ * Where `cpuN' sits: its package, and its core within the package.
+ */
+static
+void
+write_placement(json_writer_t *w, const cpu_topo_t *topo, int id)
+{
+  bool known = id >= 0 && id < topo->count && topo->present[id];
+
+  json_write_key(w, strSocket);
+  json_write_int64(w, known ? topo->package[id] : -1);
+  json_write_key(w, strCore);
+  json_write_int64(w, known ? topo->core[id] : -1);
+}
+
+/*
+ * Current clock of `cpuN' in MHz, or 0 if not known.
+ */
+static
+long
+cpu_freq(const cpu_topo_t *topo, int id)
+{
+  return id >= 0 && id < topo->count ? topo->freq[id] : 0;
+}
+
+/*
+ * The shape of the CPU document only changes when CPUs come or go, and its
+ * strings and topology are fixed once the first sample has been taken, so
+ * serialise it once with holes for the numbers.
+ */
+static
+void
+make_cpu_template(void)
+{
+  json_template_t *tpl   = &cpu_template;
+  json_writer_t   *w     = &tpl->writer;
+  cpu_stat_t      *st    = &cpu_instance->stat;
+  cpu_cache_t     *cache = NULL;
+  int              slot  = 0;
+  int              nvals = 0;
+  int              i     = 0;
+
+  json_template_init(tpl);
+
+  json_write_begin_object(w);
+
+  json_write_key(w, strUpdated);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+  json_write_key(w, strModelName);
+  json_write_string(w, cpu_instance->model);
+  json_write_key(w, strArchitecture);
+  json_write_string(w, cpu_instance->architecture);
+  json_write_key(w, strWordSize);
+  json_template_hole(tpl, JSON_HOLE_UINT64);
+  json_write_key(w, strClockSpeed);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+  json_write_key(w, strNumOnln);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+  json_write_key(w, strNumConf);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+
+  json_write_key(w, strTopology);
+  json_write_begin_object(w);
+  json_write_key(w, strSockets);
+  json_write_int64(w, cpu_instance->sockets);
+  json_write_key(w, strNumCores);
+  json_write_int64(w, cpu_instance->cores);
+  json_write_key(w, strThreads);
+  json_write_int64(w, cpu_instance->threads);
+  json_write_key(w, strPerCore);
+  json_write_int64(w, cpu_instance->cores
+                      ? cpu_instance->threads / cpu_instance->cores
+                      : 0);
+  json_write_end_object(w);
+
+  json_write_key(w, strCaches);
+  json_write_begin_array(w);
+
+  for (i = 0; i < cpu_instance->num_caches; i++) {
+    cache = &cpu_instance->caches[i];
+
+    json_write_begin_object(w);
+    json_write_key(w, strLevel);
+    json_write_int64(w, cache->level);
+    json_write_key(w, strType);
+    json_write_string(w, cache->type);
+    json_write_key(w, strSize);
+    json_write_int64(w, cache->size);
+    json_write_key(w, strShared);
+    json_write_int64(w, cache->shared);
+    json_write_end_object(w);
+  }
+
+  json_write_end_array(w);
+
+  json_write_key(w, strUsage);
+  json_write_begin_object(w);
+  make_pct_holes(tpl);
+  json_write_end_object(w);
+
+  json_write_key(w, strCores);
+  json_write_begin_array(w);
+
+  for (slot = 1; slot < st->count; slot++) {
+    json_write_begin_object(w);
+    json_write_key(w, strId);
+    json_write_int64(w, st->id[slot]);
+    write_placement(w, &cpu_instance->topo, st->id[slot]);
+    json_write_key(w, strClockSpeed);
+    json_template_hole(tpl, JSON_HOLE_INT64);
+    make_pct_holes(tpl);
+    json_write_end_object(w);
+  }
+
+  json_write_end_array(w);
+
+  json_write_end_object(w);
+
+  json_template_finish(tpl);
+  cpu_template_ok = 1;
+
+  nvals = tpl->nholes;
+
+  if (nvals > cpu_max_values) {
+    cpu_max_values = nvals;
+    cpu_values     = xrealloc(cpu_values,
+                              cpu_max_values * sizeof(json_hole_value_t));
+  }
+}
+
 void
-emit_cpu(json_node_t **out)
-{
-  json_node_t *ret = out ? json_mkobject() : NULL;
-
-  json_prepend_member(ret,
-                      strNumConf,
-                      json_mknumber(cpu_instance->num_configured));
-  json_prepend_member(ret,
-                      strNumOnln,
-                      json_mknumber(cpu_instance->num_online));
-  json_prepend_member(ret,
-                      strClockSpeed,
-                      json_mknumber(cpu_instance->clock_speed));
-  json_prepend_member(ret,
-                      strWordSize,
-                      json_mknumber(cpu_instance->word_size));
-  json_prepend_member(ret,
-                      strArchitecture,
-                      json_mkstring(cpu_instance->architecture));
-  json_prepend_member(ret,
-                      strModelName,
-                      json_mkstring(cpu_instance->model));
-  json_prepend_member(ret,
-                      strUpdated,
-                      json_mknumber(cpu_instance->time));
-
-  if (out) {
-    *out = ret;
+emit_cpu(json_writer_t *out)
+{
+  json_hole_value_t *values = NULL;
+  cpu_stat_t        *st     = &cpu_instance->stat;
+  int                slot   = 0;
+  int                hole   = CPU_NHOLES;
+  int                i      = 0;
+
+  if (!cpu_template_ok) {
+    make_cpu_template();
+  }
+
+  values = cpu_values;
+
+  values[CPU_HOLE_UPDATED]._int64     = cpu_instance->time;
+  values[CPU_HOLE_WORD_SIZE]._uint64  = cpu_instance->word_size;
+  values[CPU_HOLE_CLOCK_SPEED]._int64 = cpu_instance->clock_speed;
+  values[CPU_HOLE_NUM_ONLINE]._int64  = cpu_instance->num_online;
+  values[CPU_HOLE_NUM_CONF]._int64    = cpu_instance->num_configured;
+
+  /* Slot 0 is the aggregate, and goes in `usage'. */
+  for (slot = 0; slot < st->count || slot == 0; slot++) {
+    if (slot > 0) {
+      values[hole++]._int64 = cpu_freq(&cpu_instance->topo, st->id[slot]);
+    }
+
+    for (i = 0; i < CPU_NPCTS; i++) {
+      values[hole++]._number = slot < st->count ? st->pct[i][slot] : 0.0;
+    }
+  }
+
+  json_template_render(&cpu_template, out, values);
+}
+
+/*
+ * `cpu/:core' -- the figures for one core.
+ */
+static
+bool
+serve_cpu(void *data, const route_match_t *match, json_writer_t *out)
+{
+  sm_cpu_t            *ptr   = (sm_cpu_t *)data;
+  const route_param_t *param = route_param(match, strCoreParam);
+  size_t               pos   = 0;
+  int                  id    = 0;
+  int                  slot  = 0;
+  int                  i     = 0;
+
+  if (param == NULL || param->length == 0 || param->length > 9) {
+    return false;
   }
+
+  for (pos = 0; pos < param->length; pos++) {
+    if (param->value[pos] < '0' || param->value[pos] > '9') {
+      return false;
+    }
+
+    id = id * 10 + (param->value[pos] - '0');
+  }
+
+  slot = cpu_stat_slot(&ptr->stat, id);
+
+  if (slot < 0) {
+    return false;
+  }
+
+  json_write_begin_object(out);
+  json_write_key(out, strUpdated);
+  json_write_int64(out, ptr->time);
+  json_write_key(out, strId);
+  json_write_int64(out, id);
+  write_placement(out, &ptr->topo, id);
+  json_write_key(out, strClockSpeed);
+  json_write_int64(out, cpu_freq(&ptr->topo, id));
+
+  for (i = 0; i < CPU_NPCTS; i++) {
+    json_write_key(out, pct_names[i]);
+    json_write_number(out, ptr->stat.pct[i][slot]);
+  }
+
+  json_write_end_object(out);
+
+  return true;
 }
 
 void
 sm_cpu_init(void)
 {
   if (cpu_instance == NULL) {
-    cpu_instance       = xmalloc(sizeof(sm_cpu_t));
+    cpu_instance       = xcalloc(1, sizeof(sm_cpu_t));
     cpu_instance->vtab = xmalloc(sizeof(sm_vtable_t));
 
     MAKE_VTABLE(cpu_instance, &get_cpu, &emit_cpu, 0);
+    cpu_instance->vtab->serve = &serve_cpu;
+
+    probe_cpu(cpu_instance);
 
     generate_json((sm_base_t *)cpu_instance);
   }
 
   if (cpu_endpoint == NULL) {
     cpu_endpoint = endpoint_create(strName, cpu_instance);
+    endpoint_add_route(cpu_endpoint, strCoreRoute);
   }
 
   if (cpu_timer_task == NULL) {
@@ -51,6 +51,73 @@
 #include <sys/types.h>
 
 #include "vtable.h"
+#include "procfs.h"
+
+/*
+ * Counters on a `cpu' line of /proc/stat, in the order they appear there.
+ */
+typedef enum {
+  CPU_TICK_USER,
+  CPU_TICK_NICE,
+  CPU_TICK_SYSTEM,
+  CPU_TICK_IDLE,
+  CPU_TICK_IOWAIT,
+  CPU_TICK_IRQ,
+  CPU_TICK_SOFTIRQ,
+  CPU_TICK_STEAL,
+  CPU_NTICKS
+} cpu_tick_t;
+
+/*
+ * Utilisation figures, as percentages of the last sampling interval.
+ */
+typedef enum {
+  CPU_PCT_USER,                         /* user + nice */
+  CPU_PCT_SYSTEM,                       /* system + irq + softirq */
+  CPU_PCT_IOWAIT,
+  CPU_PCT_STEAL,
+  CPU_PCT_IDLE,
+  CPU_NPCTS
+} cpu_pct_t;
+
+/*
+ * Jiffy counters as a structure of arrays.  Every array is indexed by slot:
+ * slot 0 is the aggregate `cpu' line and slot n + 1 the n-th `cpuN' line.
+ */
+typedef struct {
+  int       count;                      /* Slots in use. */
+  int       size;                       /* Slots allocated. */
+  bool      changed;                    /* Set of CPUs differs from last time. */
+  int      *id;                         /* N of `cpuN', or -1 for slot 0. */
+  uint64_t *ticks[CPU_NTICKS];          /* Latest sample. */
+  uint64_t *prev[CPU_NTICKS];           /* Previous sample. */
+  double   *pct[CPU_NPCTS];             /* Utilisation between the two. */
+} cpu_stat_t;
+
+/*
+ * Where each CPU sits, indexed by the N of `cpuN'.  Filled in once at
+ * start-up; only `freq' changes afterwards.
+ */
+typedef struct {
+  int            count;                 /* Highest CPU number + 1. */
+  bool          *present;               /* CPU exists. */
+  int           *package;               /* Physical package (socket). */
+  int           *core;                  /* Core within the package. */
+  procfs_file_t *freq_file;             /* `scaling_cur_freq', if any. */
+  long          *freq;                  /* Current clock in MHz. */
+} cpu_topo_t;
+
+#define CPU_MAX_CACHES 8
+
+/*
+ * One level of cache, as seen from the first CPU.
+ */
+typedef struct {
+  int  level;
+  char type[16];                        /* Data, Instruction or Unified. */
+  long size;                            /* Size in KiB. */
+  int  shared;                          /* Number of CPUs sharing it. */
+} cpu_cache_t;
 
 typedef struct {
   sm_vtable_t *vtab;
@@ -61,6 +128,13 @@ typedef struct {
   char        *architecture;            /* CPU architecture. */
   char        *model;                   /* CPU model. */
   time_t       time;                    /* Update time. */
+  int          sockets;                 /* Physical packages. */
+  int          cores;                   /* Physical cores. */
+  int          threads;                 /* Hardware threads. */
+  cpu_cache_t  caches[CPU_MAX_CACHES];  /* Cache hierarchy. */
+  int          num_caches;
+  cpu_topo_t   topo;                    /* Per-CPU placement and clock. */
+  cpu_stat_t   stat;                    /* Per-CPU utilisation. */
 } sm_cpu_t;
 
 void sm_cpu_init(void);
@@ -0,0 +1,597 @@
+/*
+ * sm_disk.c --- Block device statistics.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 17:20:11
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_disk.c
+ * @author Paul Ward
+ * @brief Block device statistics.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_disk.h"
+#include "endpoints.h"
+#include "timers.h"
+#include "utils.h"
+#include "procfs.h"
+
+/*
+ * What became of one line of /proc/diskstats.
+ */
+typedef struct {
+  char name[DISK_NAME_MAX];
+  int  slot;                            /* Slot in the table, or -1. */
+} disk_line_t;
+
+static endpoint_t        *disk_endpoint    = NULL;
+static sm_disk_t         *disk_instance    = NULL;
+static timer_task_t      *disk_timer_task  = NULL;
+static json_template_t    disk_template;
+static int                disk_template_ok = 0;
+static json_hole_value_t *disk_values      = NULL;
+static int                disk_max_values  = 0;
+static struct timeval     disk_last;
+static disk_line_t       *disk_lines       = NULL;
+static int                disk_nlines      = 0;
+static int                disk_max_lines   = 0;
+
+static const char strName[]         = "disk";
+static const char strUpdated[]      = "updatedAt";
+static const char strDevices[]      = "devices";
+static const char strDeviceParam[]  = "device";
+static const char strDeviceRoute[]  = "disk/:device";
+
+/*
+ * Keys for the counters reported as they are, and for `disk_stat_t'.
+ */
+static const struct {
+  int         counter;
+  const char *name;
+} count_keys[] = {
+  { DISK_READS,         "reads"        },
+  { DISK_WRITES,        "writes"       },
+  { DISK_READ_SECTORS,  "readBytes"    },
+  { DISK_WRITE_SECTORS, "writtenBytes" },
+  { DISK_IN_FLIGHT,     "inFlight"     }
+};
+
+#define NCOUNT_KEYS (sizeof(count_keys) / sizeof(count_keys[0]))
+
+static const char *stat_names[DISK_NSTATS] = {
+  "readIops",
+  "writeIops",
+  "readBytesPerSec",
+  "writeBytesPerSec",
+  "readAwait",
+  "writeAwait",
+  "await",
+  "queueDepth",
+  "utilisation"
+};
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static const char strProcDiskstats[] = "/proc/diskstats";
+static const char strSysBlock[]      = "/sys/block";
+
+/*
+ * Column of /proc/diskstats, after the name, holding each counter.
+ */
+static const int disk_columns[DISK_NCOUNTERS] = {
+  0, 2, 3, 4, 6, 7, 8, 9, 10
+};
+
+#define DISK_NCOLUMNS 11
+
+static procfs_file_t diskstats_file;
+#endif
+
+static
+void
+disk_table_grow(disk_table_t *tab, int slots)
+{
+  int i = 0;
+
+  if (slots <= tab->size) {
+    return;
+  }
+
+  tab->name = xrealloc(tab->name, slots * sizeof(*tab->name));
+
+  for (i = 0; i < DISK_NCOUNTERS; i++) {
+    tab->value[i] = xrealloc(tab->value[i], slots * sizeof(uint64_t));
+    tab->prev[i]  = xrealloc(tab->prev[i], slots * sizeof(uint64_t));
+  }
+
+  for (i = 0; i < DISK_NSTATS; i++) {
+    tab->stat[i] = xrealloc(tab->stat[i], slots * sizeof(double));
+  }
+
+  tab->size = slots;
+}
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+/*
+ * Whole disks have a directory in /sys/block; partitions do not.  Only
+ * asked when a device first appears on a line.
+ */
+static
+bool
+is_whole_disk(const char *name)
+{
+  char  path[64 + DISK_NAME_MAX];
+  char *p = NULL;
+
+  snprintf(path, sizeof(path), "%s/%s", strSysBlock, name);
+
+  /* `cciss/c0d0' is `cciss!c0d0' in sysfs. */
+  for (p = path + sizeof(strSysBlock); *p != '\0'; p++) {
+    if (*p == '/') {
+      *p = '!';
+    }
+  }
+
+  return access(path, F_OK) == 0;
+}
+
+/*
+ * Work out again which lines are whole disks, and give each a slot.
+ */
+static
+void
+index_diskstats(disk_table_t *tab)
+{
+  procfs_scan_t  scan;
+  procfs_scan_t  line;
+  procfs_scan_t  name;
+  disk_line_t   *ent  = NULL;
+  int            slot = 0;
+
+  disk_nlines = 0;
+  procfs_scan_file(&scan, &diskstats_file);
+
+  while (procfs_next_line(&scan, &line)) {
+    procfs_u64(&line);
+    procfs_u64(&line);
+
+    if (!procfs_next_token(&line, &name)) {
+      continue;
+    }
+
+    if (disk_nlines == disk_max_lines) {
+      disk_max_lines = disk_max_lines ? disk_max_lines * 2 : 32;
+      disk_lines     = xrealloc(disk_lines,
+                                disk_max_lines * sizeof(disk_line_t));
+    }
+
+    ent       = &disk_lines[disk_nlines++];
+    ent->slot = -1;
+    procfs_copy(&name, ent->name, DISK_NAME_MAX);
+
+    if (!is_whole_disk(ent->name)) {
+      continue;
+    }
+
+    disk_table_grow(tab, slot + 1);
+    memcpy(tab->name[slot], ent->name, DISK_NAME_MAX);
+
+    ent->slot = slot++;
+  }
+
+  tab->count   = slot;
+  tab->changed = true;
+}
+
+/*
+ * Read the counters of each whole disk into its slot.  Returns false if
+ * the devices are not the ones that were indexed.
+ */
+static
+bool
+parse_diskstats(disk_table_t *tab)
+{
+  procfs_scan_t scan;
+  procfs_scan_t line;
+  procfs_scan_t name;
+  uint64_t      cols[DISK_NCOLUMNS];
+  int           n    = 0;
+  int           slot = 0;
+  int           i    = 0;
+
+  procfs_scan_file(&scan, &diskstats_file);
+
+  while (procfs_next_line(&scan, &line)) {
+    procfs_u64(&line);
+    procfs_u64(&line);
+
+    if (!procfs_next_token(&line, &name)) {
+      continue;
+    }
+
+    if (n >= disk_nlines || !procfs_equal(&name, disk_lines[n].name)) {
+      return false;
+    }
+
+    slot = disk_lines[n++].slot;
+
+    if (slot < 0) {
+      continue;
+    }
+
+    for (i = 0; i < DISK_NCOLUMNS; i++) {
+      cols[i] = procfs_u64(&line);
+    }
+
+    for (i = 0; i < DISK_NCOUNTERS; i++) {
+      tab->value[i][slot] = cols[disk_columns[i]];
+    }
+  }
+
+  return n == disk_nlines;
+}
+#endif
+
+/*
+ * Derive rates, latencies and utilisation from the change in the counters
+ * over `secs' seconds.
+ */
+static
+void
+disk_table_stats(disk_table_t *tab, double secs)
+{
+  uint64_t delta[DISK_NCOUNTERS];
+  double   ms   = secs * 1000.0;
+  int      slot = 0;
+  int      i    = 0;
+
+  for (slot = 0; slot < tab->count; slot++) {
+    for (i = 0; i < DISK_NCOUNTERS; i++) {
+      delta[i] = tab->value[i][slot] >= tab->prev[i][slot]
+        ? tab->value[i][slot] - tab->prev[i][slot]
+        : 0;
+      tab->prev[i][slot] = tab->value[i][slot];
+    }
+
+    for (i = 0; i < DISK_NSTATS; i++) {
+      tab->stat[i][slot] = 0.0;
+    }
+
+    if (secs <= 0) {
+      continue;
+    }
+
+    tab->stat[DISK_READ_IOPS][slot]   = round2(delta[DISK_READS] / secs);
+    tab->stat[DISK_WRITE_IOPS][slot]  = round2(delta[DISK_WRITES] / secs);
+    tab->stat[DISK_READ_BPS][slot]    =
+      round2(delta[DISK_READ_SECTORS] * 512.0 / secs);
+    tab->stat[DISK_WRITE_BPS][slot]   =
+      round2(delta[DISK_WRITE_SECTORS] * 512.0 / secs);
+    tab->stat[DISK_QUEUE_DEPTH][slot] = round2(delta[DISK_QUEUE_MS] / ms);
+    tab->stat[DISK_UTIL][slot]        =
+      round2(MIN(delta[DISK_IO_MS] * 100.0 / ms, 100.0));
+
+    if (delta[DISK_READS] > 0) {
+      tab->stat[DISK_READ_AWAIT][slot] =
+        round2((double)delta[DISK_READ_MS] / delta[DISK_READS]);
+    }
+
+    if (delta[DISK_WRITES] > 0) {
+      tab->stat[DISK_WRITE_AWAIT][slot] =
+        round2((double)delta[DISK_WRITE_MS] / delta[DISK_WRITES]);
+    }
+
+    if (delta[DISK_READS] + delta[DISK_WRITES] > 0) {
+      tab->stat[DISK_AWAIT][slot] =
+        round2((double)(delta[DISK_READ_MS] + delta[DISK_WRITE_MS]) /
+               (delta[DISK_READS] + delta[DISK_WRITES]));
+    }
+  }
+}
+
+static
+int
+disk_table_find(const disk_table_t *tab, const char *name, size_t len)
+{
+  int slot = 0;
+
+  for (slot = 0; slot < tab->count; slot++) {
+    if (strlen(tab->name[slot]) == len &&
+        memcmp(tab->name[slot], name, len) == 0)
+    {
+      return slot;
+    }
+  }
+
+  return -1;
+}
+
+void
+get_disk(void *data)
+{
+  sm_disk_t      *ptr  = (sm_disk_t *)data;
+  struct timeval  now;
+  double          secs = 0.0;
+  int             i    = 0;
+
+  gettimeofday(&now, NULL);
+
+  secs = elapsed_secs(&disk_last, &now);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+  if (procfs_read(&diskstats_file) > 0) {
+    if (!parse_diskstats(&ptr->table)) {
+      index_diskstats(&ptr->table);
+      parse_diskstats(&ptr->table);
+
+      /* No history yet; the first figures come out as zero. */
+      for (i = 0; i < DISK_NCOUNTERS; i++) {
+        memcpy(ptr->table.prev[i],
+               ptr->table.value[i],
+               ptr->table.count * sizeof(uint64_t));
+      }
+    }
+
+    disk_table_stats(&ptr->table, secs);
+  }
+#endif
+
+  if (ptr->table.changed && disk_template_ok) {
+    json_template_free(&disk_template);
+    disk_template_ok = 0;
+  }
+
+  ptr->table.changed = false;
+  ptr->time          = now.tv_sec;
+  disk_last          = now;
+}
+
+void
+disk_timer(timer_clientdata_t data, struct timeval *now)
+{
+#ifdef DEBUG
+  printf("TIMER FIRE - Updating disks\n");
+#endif
+
+  generate_json((sm_base_t *)disk_instance);
+}
+
+/*
+ * One disk's counter value for `count_keys[i]'; sector counts are turned
+ * into bytes.
+ */
+static
+uint64_t
+disk_count(const disk_table_t *tab, int slot, int i)
+{
+  int      counter = count_keys[i].counter;
+  uint64_t val     = tab->value[counter][slot];
+
+  if (counter == DISK_READ_SECTORS || counter == DISK_WRITE_SECTORS) {
+    val *= 512;
+  }
+
+  return val;
+}
+
+/*
+ * One disk.  With a template, holes are made instead of values written.
+ */
+static
+void
+write_disk(json_writer_t      *w,
+           json_template_t    *tpl,
+           const disk_table_t *tab,
+           int                 slot)
+{
+  size_t i = 0;
+
+  json_write_begin_object(w);
+
+  for (i = 0; i < NCOUNT_KEYS; i++) {
+    json_write_key(w, count_keys[i].name);
+
+    if (tpl != NULL) {
+      json_template_hole(tpl, JSON_HOLE_UINT64);
+    } else {
+      json_write_uint64(w, disk_count(tab, slot, i));
+    }
+  }
+
+  for (i = 0; i < DISK_NSTATS; i++) {
+    json_write_key(w, stat_names[i]);
+
+    if (tpl != NULL) {
+      json_template_hole(tpl, JSON_HOLE_NUMBER);
+    } else {
+      json_write_number(w, tab->stat[i][slot]);
+    }
+  }
+
+  json_write_end_object(w);
+}
+
+/*
+ * The document only changes shape when disks come or go.
+ */
+static
+void
+make_disk_template(void)
+{
+  json_template_t *tpl  = &disk_template;
+  json_writer_t   *w    = &tpl->writer;
+  disk_table_t    *tab  = &disk_instance->table;
+  int              slot = 0;
+
+  json_template_init(tpl);
+
+  json_write_begin_object(w);
+
+  json_write_key(w, strUpdated);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+
+  json_write_key(w, strDevices);
+  json_write_begin_object(w);
+
+  for (slot = 0; slot < tab->count; slot++) {
+    json_write_key(w, tab->name[slot]);
+    write_disk(w, tpl, tab, slot);
+  }
+
+  json_write_end_object(w);
+
+  json_write_end_object(w);
+
+  json_template_finish(tpl);
+  disk_template_ok = 1;
+
+  if (tpl->nholes > disk_max_values) {
+    disk_max_values = tpl->nholes;
+    disk_values     = xrealloc(disk_values,
+                               disk_max_values * sizeof(json_hole_value_t));
+  }
+}
+
+void
+emit_disk(json_writer_t *out)
+{
+  disk_table_t *tab  = &disk_instance->table;
+  int           hole = 0;
+  int           slot = 0;
+  size_t        i    = 0;
+
+  if (!disk_template_ok) {
+    make_disk_template();
+  }
+
+  disk_values[hole++]._int64 = disk_instance->time;
+
+  /* Same order as `write_disk'. */
+  for (slot = 0; slot < tab->count; slot++) {
+    for (i = 0; i < NCOUNT_KEYS; i++) {
+      disk_values[hole++]._uint64 = disk_count(tab, slot, i);
+    }
+
+    for (i = 0; i < DISK_NSTATS; i++) {
+      disk_values[hole++]._number = tab->stat[i][slot];
+    }
+  }
+
+  json_template_render(&disk_template, out, disk_values);
+}
+
+/*
+ * `disk/:device' -- one disk.
+ */
+static
+bool
+serve_disk(void *data, const route_match_t *match, json_writer_t *out)
+{
+  sm_disk_t           *ptr   = (sm_disk_t *)data;
+  const route_param_t *param = route_param(match, strDeviceParam);
+  int                  slot  = 0;
+
+  if (param == NULL) {
+    return false;
+  }
+
+  slot = disk_table_find(&ptr->table, param->value, param->length);
+
+  if (slot < 0) {
+    return false;
+  }
+
+  write_disk(out, NULL, &ptr->table, slot);
+
+  return true;
+}
+
+void
+sm_disk_init(void)
+{
+  if (disk_instance == NULL) {
+    disk_instance       = xcalloc(1, sizeof(sm_disk_t));
+    disk_instance->vtab = xmalloc(sizeof(sm_vtable_t));
+
+    MAKE_VTABLE(disk_instance, &get_disk, &emit_disk, 0);
+    disk_instance->vtab->serve = &serve_disk;
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+    if (!procfs_open(&diskstats_file, strProcDiskstats, 4096)) {
+      syslog(LOG_ERR,
+             "Could not open %s: %s",
+             strProcDiskstats,
+             strerror(errno));
+    }
+#endif
+
+    generate_json((sm_base_t *)disk_instance);
+  }
+
+  if (disk_endpoint == NULL) {
+    disk_endpoint = endpoint_create(strName, disk_instance);
+    endpoint_add_route(disk_endpoint, strDeviceRoute);
+  }
+
+  if (disk_timer_task == NULL) {
+    timer_clientdata_t data;
+
+    data.l = 0;
+    disk_timer_task = tmr_create(NULL,
+                                 &disk_timer,
+                                 data,
+                                 1000,
+                                 1);
+  }
+}
+
+/* sm_disk.c ends here. */
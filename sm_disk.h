@@ -0,0 +1,112 @@
+/*
+ * sm_disk.h --- Block device statistics.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 17:20:05
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_disk.h
+ * @author Paul Ward
+ * @brief Block device statistics.
+ */
+
+#ifndef _sm_disk_h_
+#define _sm_disk_h_
+
+#include <sys/types.h>
+
+#include "vtable.h"
+
+#define DISK_NAME_MAX 32
+
+/*
+ * Counters taken from /proc/diskstats.
+ */
+typedef enum {
+  DISK_READS,                           /* Reads completed. */
+  DISK_READ_SECTORS,
+  DISK_READ_MS,                         /* Time spent reading. */
+  DISK_WRITES,                          /* Writes completed. */
+  DISK_WRITE_SECTORS,
+  DISK_WRITE_MS,                        /* Time spent writing. */
+  DISK_IN_FLIGHT,                       /* I/Os in progress; not a counter. */
+  DISK_IO_MS,                           /* Time with I/O in progress. */
+  DISK_QUEUE_MS,                        /* Weighted time with I/O in progress. */
+  DISK_NCOUNTERS
+} disk_counter_t;
+
+/*
+ * Figures derived from the change in the counters between two samples.
+ */
+typedef enum {
+  DISK_READ_IOPS,
+  DISK_WRITE_IOPS,
+  DISK_READ_BPS,                        /* Bytes per second. */
+  DISK_WRITE_BPS,
+  DISK_READ_AWAIT,                      /* Milliseconds per read. */
+  DISK_WRITE_AWAIT,
+  DISK_AWAIT,                           /* Milliseconds per I/O. */
+  DISK_QUEUE_DEPTH,                     /* Average requests outstanding. */
+  DISK_UTIL,                            /* Percentage of time busy. */
+  DISK_NSTATS
+} disk_stat_t;
+
+/*
+ * Whole disks as a structure of arrays; partitions are left out.
+ */
+typedef struct {
+  int       count;                      /* Slots in use. */
+  int       size;                       /* Slots allocated. */
+  bool      changed;                    /* Disks differ from last time. */
+  char    (*name)[DISK_NAME_MAX];
+  uint64_t *value[DISK_NCOUNTERS];      /* Latest counters. */
+  uint64_t *prev[DISK_NCOUNTERS];       /* Counters at the previous sample. */
+  double   *stat[DISK_NSTATS];          /* Derived between the two. */
+} disk_table_t;
+
+typedef struct {
+  sm_vtable_t  *vtab;
+  disk_table_t  table;
+  time_t        time;                   /* Update time. */
+} sm_disk_t;
+
+void sm_disk_init(void);
+
+#endif /* !_sm_disk_h_ */
+
+/* sm_disk.h ends here. */
@@ -0,0 +1,642 @@
+/*
+ * sm_fs.c --- Filesystem usage.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 17:44:58
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_fs.c
+ * @author Paul Ward
+ * @brief Filesystem usage.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/statvfs.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_fs.h"
+#include "endpoints.h"
+#include "timers.h"
+#include "fdwatch.h"
+#include "utils.h"
+#include "procfs.h"
+
+/*
+ * statvfs() on a network filesystem waits on the server, and a hung server
+ * would stall the whole event loop with it.  The same goes for FUSE, whose
+ * server is a process that may hang.  Such mounts are left out unless
+ * FS_SAMPLE_NETWORK is defined non-zero.
+ */
+#ifndef FS_SAMPLE_NETWORK
+# define FS_SAMPLE_NETWORK  0
+#endif
+
+static endpoint_t        *fs_endpoint    = NULL;
+static sm_fs_t           *fs_instance    = NULL;
+static timer_task_t      *fs_timer_task  = NULL;
+static json_template_t    fs_template;
+static int                fs_template_ok = 0;
+static json_hole_value_t *fs_values      = NULL;
+static int                fs_max_values  = 0;
+static bool               fs_stale       = true;  /* Mount table changed. */
+
+static const char strName[]         = "fs";
+static const char strUpdated[]      = "updatedAt";
+static const char strFilesystems[]  = "filesystems";
+static const char strDevice[]       = "device";
+static const char strType[]         = "type";
+static const char strUsedPercent[]  = "usedPercent";
+static const char strInodesPercent[] = "inodesUsedPercent";
+
+static const char *value_names[FS_NVALUES] = {
+  "size",
+  "used",
+  "available",
+  "inodes",
+  "inodesFree"
+};
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static const char strMountinfo[]    = "/proc/self/mountinfo";
+static const char strFuse[]         = "fuse";
+
+/*
+ * Filesystems with no storage behind them, which are not worth a
+ * statvfs().  On an autofs trigger point it would go further, and mount
+ * whatever is behind the trigger.
+ */
+static const char *pseudo_types[] = {
+  "autofs",
+  "proc",
+  "sysfs",
+  "cgroup",
+  "cgroup2",
+  "tracefs",
+  "debugfs",
+  "securityfs",
+  "bpf",
+  "pstore",
+  "configfs",
+  "fusectl",
+  "devpts",
+  "mqueue",
+  "hugetlbfs",
+  "binfmt_misc",
+  "efivarfs",
+  "selinuxfs",
+  "rpc_pipefs",
+  "nsfs",
+  NULL
+};
+
+#if !FS_SAMPLE_NETWORK
+static const char *network_types[] = {
+  "nfs",
+  "nfs4",
+  "cifs",
+  "smb3",
+  "smbfs",
+  "ncpfs",
+  "afs",
+  "coda",
+  "ceph",
+  "glusterfs",
+  "lustre",
+  "9p",
+  NULL
+};
+#endif
+
+static procfs_file_t mountinfo_file;
+
+/*
+ * Mount points seen while reading mountinfo, as slots in the table being
+ * built, or -1.
+ */
+static int          *point_slots     = NULL;
+static size_t        point_size      = 0;
+#endif
+
+/*
+ * `used' as a percentage of `used + avail', to two places, as df(1) does.
+ */
+static
+double
+percent(uint64_t used, uint64_t avail)
+{
+  if (used + avail == 0) {
+    return 0.0;
+  }
+
+  return round2((double)used * 100.0 / (double)(used + avail));
+}
+
+static
+void
+fs_table_clear(fs_table_t *tab)
+{
+  int i = 0;
+
+  for (i = 0; i < tab->count; i++) {
+    free(tab->mounts[i].mount_point);
+    free(tab->mounts[i].device);
+    free(tab->mounts[i].type);
+  }
+
+  tab->count   = 0;
+  tab->changed = true;
+}
+
+/*
+ * Append a mount, taking ownership of its strings.
+ */
+static
+fs_mount_t *
+fs_table_add(fs_table_t *tab)
+{
+  int i = 0;
+
+  if (tab->count == tab->size) {
+    tab->size   = tab->size ? tab->size * 2 : 16;
+    tab->mounts = xrealloc(tab->mounts, tab->size * sizeof(fs_mount_t));
+
+    for (i = 0; i < FS_NVALUES; i++) {
+      tab->value[i] = xrealloc(tab->value[i], tab->size * sizeof(uint64_t));
+    }
+  }
+
+  return &tab->mounts[tab->count++];
+}
+
+/*
+ * Refresh one mount's figures.  Returns false if it has no storage behind
+ * it, as with proc or sysfs.
+ */
+static
+bool
+fs_sample(fs_table_t *tab, int slot)
+{
+  struct statvfs sv;
+  uint64_t       frsize = 0;
+
+  if (statvfs(tab->mounts[slot].mount_point, &sv) != 0 || sv.f_blocks == 0) {
+    memset(&sv, 0, sizeof(sv));
+  }
+
+  frsize = sv.f_frsize ? sv.f_frsize : sv.f_bsize;
+
+  tab->value[FS_SIZE][slot]        = (uint64_t)sv.f_blocks * frsize;
+  tab->value[FS_USED][slot]        = (uint64_t)(sv.f_blocks - sv.f_bfree)
+                                     * frsize;
+  tab->value[FS_AVAILABLE][slot]   = (uint64_t)sv.f_bavail * frsize;
+  tab->value[FS_INODES][slot]      = sv.f_files;
+  tab->value[FS_INODES_FREE][slot] = sv.f_ffree;
+
+  return sv.f_blocks != 0;
+}
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static
+bool
+type_listed(const char *type, const char **types)
+{
+  int i = 0;
+
+  for (i = 0; types[i] != NULL; i++) {
+    if (strcmp(type, types[i]) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*
+ * Whether a mount of `type' is left out without looking at it; see above.
+ * `fuseblk' has a block device behind it, and is kept.
+ */
+static
+bool
+fs_skip(const char *type)
+{
+  if (type_listed(type, pseudo_types)) {
+    return true;
+  }
+
+#if !FS_SAMPLE_NETWORK
+  if (strncmp(type, strFuse, sizeof(strFuse) - 1) == 0 &&
+      (type[sizeof(strFuse) - 1] == '\0' || type[sizeof(strFuse) - 1] == '.'))
+  {
+    return true;
+  }
+
+  return type_listed(type, network_types);
+#else
+  return false;
+#endif
+}
+
+/*
+ * Where `point' is, or would go, in `point_slots'.
+ */
+static
+size_t
+point_slot(const fs_table_t *tab, const char *point, unsigned long hash)
+{
+  size_t mask = point_size - 1;
+  size_t i    = hash & mask;
+  int    slot = 0;
+
+  while ((slot = point_slots[i]) >= 0) {
+    if (tab->mounts[slot].hash == hash &&
+        strcmp(tab->mounts[slot].mount_point, point) == 0)
+    {
+      break;
+    }
+
+    i = (i + 1) & mask;
+  }
+
+  return i;
+}
+
+/*
+ * Make room for `count' mount points, keeping the first `count - 1'.
+ */
+static
+void
+point_grow(const fs_table_t *tab, int count)
+{
+  int i = 0;
+
+  if ((size_t)count * 2 <= point_size) {
+    return;
+  }
+
+  while ((size_t)count * 2 > point_size) {
+    point_size = point_size ? point_size * 2 : 64;
+  }
+
+  point_slots = xrealloc(point_slots, point_size * sizeof(int));
+  memset(point_slots, 0xFF, point_size * sizeof(int));
+
+  for (i = 0; i < count - 1; i++) {
+    point_slots[point_slot(tab,
+                           tab->mounts[i].mount_point,
+                           tab->mounts[i].hash)] = i;
+  }
+}
+
+/*
+ * Copy a mountinfo field, undoing the octal escapes (`\040' for a space)
+ * the kernel uses for awkward characters.
+ */
+static
+char *
+unescape(const procfs_scan_t *field)
+{
+  const char *p   = field->pos;
+  char       *out = xmalloc(procfs_length(field) + 1);
+  char       *q   = out;
+
+  while (p < field->end) {
+    if (*p == '\\'     &&
+        field->end - p >= 4 &&
+        p[1] >= '0' && p[1] <= '3' &&
+        p[2] >= '0' && p[2] <= '7' &&
+        p[3] >= '0' && p[3] <= '7')
+    {
+      *q++ = (char)(((p[1] - '0') << 6) | ((p[2] - '0') << 3) | (p[3] - '0'));
+      p   += 4;
+    } else {
+      *q++ = *p++;
+    }
+  }
+
+  *q = '\0';
+
+  return out;
+}
+
+/*
+ * Build the mount list again from /proc/self/mountinfo:
+ *
+ *   36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw
+ *
+ * Mounts without storage are dropped, as is any mount hidden by a later
+ * one on the same mount point, and network mounts unless asked for.  Those
+ * whose type says they have no storage are dropped without a statvfs().
+ */
+static
+void
+load_mounts(fs_table_t *tab)
+{
+  procfs_scan_t  scan;
+  procfs_scan_t  line;
+  procfs_scan_t  tok;
+  procfs_scan_t  point;
+  procfs_scan_t  type;
+  procfs_scan_t  source;
+  fs_mount_t    *mnt  = NULL;
+  size_t         slot = 0;
+  int            i    = 0;
+
+  fs_table_clear(tab);
+
+  if (procfs_read(&mountinfo_file) < 0) {
+    return;
+  }
+
+  if (point_slots != NULL) {
+    memset(point_slots, 0xFF, point_size * sizeof(int));
+  }
+
+  procfs_scan_file(&scan, &mountinfo_file);
+
+  while (procfs_next_line(&scan, &line)) {
+    /* Mount ID, parent ID, major:minor, root. */
+    for (i = 0; i < 4; i++) {
+      procfs_next_token(&line, &tok);
+    }
+
+    if (!procfs_next_token(&line, &point)) {
+      continue;
+    }
+
+    /* Options, then optional fields up to a lone `-'. */
+    while (procfs_next_token(&line, &tok) && !procfs_equal(&tok, "-"))
+      ;
+
+    if (!procfs_next_token(&line, &type) ||
+        !procfs_next_token(&line, &source))
+    {
+      continue;
+    }
+
+    mnt              = fs_table_add(tab);
+    mnt->mount_point = unescape(&point);
+    mnt->device      = unescape(&source);
+    mnt->type        = unescape(&type);
+    mnt->hash        = str_hash(mnt->mount_point);
+
+    point_grow(tab, tab->count);
+    slot = point_slot(tab, mnt->mount_point, mnt->hash);
+
+    if (point_slots[slot] < 0) {
+      point_slots[slot] = tab->count - 1;
+      continue;
+    }
+
+    /* A mount over an existing mount point replaces it. */
+    i = point_slots[slot];
+
+    free(tab->mounts[i].mount_point);
+    free(tab->mounts[i].device);
+    free(tab->mounts[i].type);
+
+    tab->mounts[i] = *mnt;
+    tab->count--;
+  }
+
+  /* Keep only what has storage behind it. */
+  for (i = 0; i < tab->count; ) {
+    if (!fs_skip(tab->mounts[i].type) && fs_sample(tab, i)) {
+      i++;
+      continue;
+    }
+
+    free(tab->mounts[i].mount_point);
+    free(tab->mounts[i].device);
+    free(tab->mounts[i].type);
+
+    tab->count--;
+    memmove(&tab->mounts[i],
+            &tab->mounts[i + 1],
+            (tab->count - i) * sizeof(fs_mount_t));
+  }
+}
+
+/*
+ * The mount table changed.  Reading it again is left to the next sample,
+ * which is taken straight away.
+ */
+static
+void
+mounts_changed(int fd, void *data)
+{
+  fs_stale = true;
+
+  generate_json((sm_base_t *)fs_instance);
+}
+#endif
+
+void
+get_fs(void *data)
+{
+  sm_fs_t *ptr = (sm_fs_t *)data;
+  int      i   = 0;
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+  if (fs_stale) {
+    load_mounts(&ptr->table);
+    fs_stale = false;
+  } else {
+    for (i = 0; i < ptr->table.count; i++) {
+      fs_sample(&ptr->table, i);
+    }
+  }
+#endif
+
+  if (ptr->table.changed && fs_template_ok) {
+    json_template_free(&fs_template);
+    fs_template_ok = 0;
+  }
+
+  ptr->table.changed = false;
+  ptr->time          = time(NULL);
+}
+
+void
+fs_timer(timer_clientdata_t data, struct timeval *now)
+{
+#ifdef DEBUG
+  printf("TIMER FIRE - Updating filesystems\n");
+#endif
+
+  generate_json((sm_base_t *)fs_instance);
+}
+
+/*
+ * The document only changes shape when the mount table does.
+ */
+static
+void
+make_fs_template(void)
+{
+  json_template_t *tpl  = &fs_template;
+  json_writer_t   *w    = &tpl->writer;
+  fs_table_t      *tab  = &fs_instance->table;
+  int              slot = 0;
+  int              i    = 0;
+
+  json_template_init(tpl);
+
+  json_write_begin_object(w);
+
+  json_write_key(w, strUpdated);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+
+  json_write_key(w, strFilesystems);
+  json_write_begin_object(w);
+
+  for (slot = 0; slot < tab->count; slot++) {
+    json_write_key(w, tab->mounts[slot].mount_point);
+    json_write_begin_object(w);
+
+    json_write_key(w, strDevice);
+    json_write_string(w, tab->mounts[slot].device);
+    json_write_key(w, strType);
+    json_write_string(w, tab->mounts[slot].type);
+
+    for (i = 0; i < FS_NVALUES; i++) {
+      json_write_key(w, value_names[i]);
+      json_template_hole(tpl, JSON_HOLE_UINT64);
+    }
+
+    json_write_key(w, strUsedPercent);
+    json_template_hole(tpl, JSON_HOLE_NUMBER);
+    json_write_key(w, strInodesPercent);
+    json_template_hole(tpl, JSON_HOLE_NUMBER);
+
+    json_write_end_object(w);
+  }
+
+  json_write_end_object(w);
+
+  json_write_end_object(w);
+
+  json_template_finish(tpl);
+  fs_template_ok = 1;
+
+  if (tpl->nholes > fs_max_values) {
+    fs_max_values = tpl->nholes;
+    fs_values     = xrealloc(fs_values,
+                             fs_max_values * sizeof(json_hole_value_t));
+  }
+}
+
+void
+emit_fs(json_writer_t *out)
+{
+  fs_table_t *tab  = &fs_instance->table;
+  int         hole = 0;
+  int         slot = 0;
+  int         i    = 0;
+
+  if (!fs_template_ok) {
+    make_fs_template();
+  }
+
+  fs_values[hole++]._int64 = fs_instance->time;
+
+  for (slot = 0; slot < tab->count; slot++) {
+    for (i = 0; i < FS_NVALUES; i++) {
+      fs_values[hole++]._uint64 = tab->value[i][slot];
+    }
+
+    fs_values[hole++]._number = percent(tab->value[FS_USED][slot],
+                                        tab->value[FS_AVAILABLE][slot]);
+    fs_values[hole++]._number =
+      percent(tab->value[FS_INODES][slot] - tab->value[FS_INODES_FREE][slot],
+              tab->value[FS_INODES_FREE][slot]);
+  }
+
+  json_template_render(&fs_template, out, fs_values);
+}
+
+void
+sm_fs_init(void)
+{
+  if (fs_instance == NULL) {
+    fs_instance       = xcalloc(1, sizeof(sm_fs_t));
+    fs_instance->vtab = xmalloc(sizeof(sm_vtable_t));
+
+    MAKE_VTABLE(fs_instance, &get_fs, &emit_fs, 0);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+    /* The kernel flags mountinfo with POLLPRI when mounts change. */
+    if (procfs_open(&mountinfo_file, strMountinfo, 16384)) {
+      fdwatch_add_handler(mountinfo_file.fd,
+                          FDW_PRI,
+                          &mounts_changed,
+                          NULL);
+    } else {
+      syslog(LOG_ERR, "Could not open %s: %s", strMountinfo, strerror(errno));
+    }
+#endif
+
+    generate_json((sm_base_t *)fs_instance);
+  }
+
+  if (fs_endpoint == NULL) {
+    fs_endpoint = endpoint_create(strName, fs_instance);
+  }
+
+  if (fs_timer_task == NULL) {
+    timer_clientdata_t data;
+
+    data.l = 0;
+    fs_timer_task = tmr_create(NULL,
+                               &fs_timer,
+                               data,
+                               10000,
+                               1);
+  }
+}
+
+/* sm_fs.c ends here. */
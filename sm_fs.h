@@ -0,0 +1,96 @@
+/*
+ * sm_fs.h --- Filesystem usage.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 17:44:52
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_fs.h
+ * @author Paul Ward
+ * @brief Filesystem usage.
+ */
+
+#ifndef _sm_fs_h_
+#define _sm_fs_h_
+
+#include <sys/types.h>
+
+#include "vtable.h"
+
+/*
+ * Figures from statvfs(3), in bytes and inodes.
+ */
+typedef enum {
+  FS_SIZE,
+  FS_USED,
+  FS_AVAILABLE,                         /* To unprivileged users. */
+  FS_INODES,
+  FS_INODES_FREE,
+  FS_NVALUES
+} fs_value_t;
+
+typedef struct {
+  char          *mount_point;
+  char          *device;
+  char          *type;
+  unsigned long  hash;                  /* `str_hash' of mount_point. */
+} fs_mount_t;
+
+/*
+ * Mounted filesystems that have storage behind them.  The mounts only
+ * change when the mount table does; the values are refreshed every tick.
+ */
+typedef struct {
+  int         count;
+  int         size;
+  bool        changed;                  /* Mounts differ from last time. */
+  fs_mount_t *mounts;
+  uint64_t   *value[FS_NVALUES];
+} fs_table_t;
+
+typedef struct {
+  sm_vtable_t *vtab;
+  fs_table_t   table;
+  time_t       time;                    /* Update time. */
+} sm_fs_t;
+
+void sm_fs_init(void);
+
+#endif /* !_sm_fs_h_ */
+
+/* sm_fs.h ends here. */
@@ -202,18 +202,20 @@ make_xopen_info(void)
 }
 
 void
-emit_info(json_node_t **out)
+emit_info(json_writer_t *out)
 {
-  json_node_t *ret = out ? json_mkobject() : NULL;
-
-  json_prepend_member(ret, strPosix,    json_mkstring(posix_info));
-  json_prepend_member(ret, strXopen,    json_mkstring(xopen_info));
-  json_prepend_member(ret, strStdC,     json_mkstring(stdc_info));
-  json_prepend_member(ret, strCompiler, json_mkstring(COMPILER_NAME));
-
-  if (out) {
-    *out = ret;
-  }
+  json_write_begin_object(out);
+
+  json_write_key(out, strCompiler);
+  json_write_string(out, COMPILER_NAME);
+  json_write_key(out, strStdC);
+  json_write_string(out, stdc_info);
+  json_write_key(out, strXopen);
+  json_write_string(out, xopen_info);
+  json_write_key(out, strPosix);
+  json_write_string(out, posix_info);
+
+  json_write_end_object(out);
 }
 
 void
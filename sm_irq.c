@@ -0,0 +1,667 @@
+/*
+ * sm_irq.c --- Interrupt distribution.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 20:15:55
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_irq.c
+ * @author Paul Ward
+ * @brief Interrupt distribution.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_irq.h"
+#include "endpoints.h"
+#include "timers.h"
+#include "utils.h"
+#include "procfs.h"
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+static endpoint_t     *irq_endpoint   = NULL;
+static sm_irq_t       *irq_instance   = NULL;
+static timer_task_t   *irq_timer_task = NULL;
+static struct timeval  irq_last;
+
+static const char strName[]         = "irq";
+static const char strUpdated[]      = "updatedAt";
+static const char strInterrupts[]   = "interrupts";
+static const char strSoftirqs[]     = "softirqs";
+static const char strTotal[]        = "total";
+static const char strTop[]          = "top";
+static const char strTopCpus[]      = "topCpus";
+static const char strIrq[]          = "irq";
+static const char strDesc[]         = "name";
+static const char strRate[]         = "rate";
+static const char strCpu[]          = "cpu";
+static const char strBusiest[]      = "busiestCpu";
+static const char strShare[]        = "busiestShare";
+static const char strPerCpu[]       = "perCpu";
+static const char strIrqParam[]     = "irq";
+static const char strIrqRoute[]     = "irq/:irq";
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static const char strProcInterrupts[] = "/proc/interrupts";
+static const char strProcSoftirqs[]   = "/proc/softirqs";
+
+static procfs_file_t interrupts_file;
+static procfs_file_t softirqs_file;
+#endif
+
+/* {{{ Matrices: */
+
+/*
+ * Make room for `rows' rows of the current width.
+ */
+static
+void
+irq_matrix_reserve(irq_matrix_t *m, int rows)
+{
+  size_t cells = (size_t)rows * m->ncpu;
+  int    i     = 0;
+
+  if (rows > m->size) {
+    m->label     = xrealloc(m->label, rows * 2 * sizeof(*m->label));
+    m->per_cpu   = xrealloc(m->per_cpu, rows * 2 * sizeof(bool));
+    m->desc      = xrealloc(m->desc, rows * 2 * sizeof(char *));
+    m->row_total = xrealloc(m->row_total, rows * 2 * sizeof(uint64_t));
+
+    for (i = m->size; i < rows * 2; i++) {
+      m->desc[i] = NULL;
+    }
+
+    m->size = rows * 2;
+  }
+
+  if (cells > m->cells) {
+    m->cells = cells * 2;
+    m->value = xrealloc(m->value, m->cells * sizeof(uint64_t));
+    m->prev  = xrealloc(m->prev, m->cells * sizeof(uint64_t));
+    m->delta = xrealloc(m->delta, m->cells * sizeof(uint64_t));
+  }
+}
+
+/*
+ * `delta = value - prev', cell by cell.
+ *
+ * A counter that went backwards was reset, and counts as no change.  The
+ * counters never come near 2^63, so a reset is exactly a difference with
+ * its top bit set; clearing those with a mask built from that bit keeps
+ * the loop free of comparisons and branches.  gcc does not vectorise the
+ * plain loop at the flags we build with, so the blocks are done by hand
+ * where SSE2 or AVX2 is available, as in `plain_run'.
+ */
+static
+void
+irq_matrix_delta(uint64_t       *delta,
+                 const uint64_t *value,
+                 const uint64_t *prev,
+                 size_t          n)
+{
+  uint64_t d = 0;
+  size_t   i = 0;
+
+#if defined(__AVX2__)
+  __m256i v;
+
+  for (; i + 4 <= n; i += 4) {
+    v = _mm256_sub_epi64(_mm256_loadu_si256((const __m256i *)(value + i)),
+                         _mm256_loadu_si256((const __m256i *)(prev + i)));
+    v = _mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_setzero_si256(), v),
+                            v);
+    _mm256_storeu_si256((__m256i *)(delta + i), v);
+  }
+#elif defined(__SSE2__)
+  __m128i v;
+
+  for (; i + 2 <= n; i += 2) {
+    v = _mm_sub_epi64(_mm_loadu_si128((const __m128i *)(value + i)),
+                      _mm_loadu_si128((const __m128i *)(prev + i)));
+    /* No 64-bit compare in SSE2: spread each lane's top bit instead. */
+    v = _mm_andnot_si128(_mm_shuffle_epi32(_mm_srai_epi32(v, 31),
+                                           _MM_SHUFFLE(3, 3, 1, 1)),
+                         v);
+    _mm_storeu_si128((__m128i *)(delta + i), v);
+  }
+#endif
+
+  for (; i < n; i++) {
+    d        = value[i] - prev[i];
+    delta[i] = d & ~(uint64_t)((int64_t)d >> 63);
+  }
+}
+
+static
+void
+irq_matrix_totals(irq_matrix_t *m)
+{
+  const uint64_t *row = NULL;
+  int             r   = 0;
+  int             c   = 0;
+
+  memset(m->cpu_total, 0, m->ncpu * sizeof(uint64_t));
+
+  for (r = 0; r < m->rows; r++) {
+    row             = m->delta + (size_t)r * m->ncpu;
+    m->row_total[r] = 0;
+
+    for (c = 0; c < m->ncpu; c++) {
+      m->row_total[r] += row[c];
+    }
+
+    /* A lone count, as for ERR or MIS, is not CPU0's. */
+    if (m->per_cpu[r]) {
+      for (c = 0; c < m->ncpu; c++) {
+        m->cpu_total[c] += row[c];
+      }
+    }
+  }
+}
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+/*
+ * Read the CPU columns from the heading:
+ *
+ *              CPU0       CPU1       CPU2       CPU3
+ *
+ * CPUs that are offline are left out, so the numbers may have gaps.
+ */
+static
+void
+parse_heading(irq_matrix_t *m, procfs_scan_t *line)
+{
+  procfs_scan_t tok;
+  int           n  = 0;
+  int           id = 0;
+
+  while (procfs_next_token(line, &tok)) {
+    if (!procfs_prefix(&tok, "CPU")) {
+      continue;
+    }
+
+    id = (int)procfs_u64(&tok);
+
+    if (n == m->cpu_size) {
+      m->cpu_size  = m->cpu_size ? m->cpu_size * 2 : 8;
+      m->cpu_id    = xrealloc(m->cpu_id, m->cpu_size * sizeof(int));
+      m->cpu_total = xrealloc(m->cpu_total, m->cpu_size * sizeof(uint64_t));
+    }
+
+    if (n >= m->ncpu || m->cpu_id[n] != id) {
+      m->changed = true;
+    }
+
+    m->cpu_id[n++] = id;
+  }
+
+  if (n != m->ncpu) {
+    m->changed = true;
+    m->ncpu    = n;
+  }
+
+  /* A new shape; every row is laid out again. */
+  if (m->changed) {
+    m->rows = 0;
+  }
+}
+
+/*
+ * Read one of the matrices:
+ *
+ *    24:       1045          0   IO-APIC   5-edge      ACPI:Ged
+ *   NMI:          0          0   Non-maskable interrupts
+ *   ERR:          0
+ *
+ * Some rows have a single count for the whole system rather than one per
+ * CPU; it is kept in the first column.  Rows are matched to
+ * the last read by label; if they no longer line up, the matrix is
+ * marked as changed and its deltas start again.
+ */
+static
+void
+irq_matrix_read(irq_matrix_t *m, procfs_file_t *file)
+{
+  procfs_scan_t  scan;
+  procfs_scan_t  line;
+  procfs_scan_t  label;
+  uint64_t      *row = NULL;
+  uint64_t      *tmp = NULL;
+  size_t         len = 0;
+  int            r   = 0;
+  int            c   = 0;
+
+  m->changed = false;
+
+  if (procfs_read(file) < 0) {
+    return;
+  }
+
+  procfs_scan_file(&scan, file);
+
+  if (!procfs_next_line(&scan, &line)) {
+    return;
+  }
+
+  parse_heading(m, &line);
+
+  while (procfs_next_line(&scan, &line)) {
+    if (!procfs_split(&line, ':', &label)) {
+      continue;
+    }
+
+    procfs_trim(&label);
+    irq_matrix_reserve(m, r + 1);
+
+    if (r >= m->rows || !procfs_equal(&label, m->label[r])) {
+      procfs_copy(&label, m->label[r], IRQ_LABEL_LEN);
+      m->changed = true;
+    }
+
+    row = m->value + (size_t)r * m->ncpu;
+
+    for (c = 0; c < m->ncpu; c++) {
+      procfs_skip_space(&line);
+
+      if (procfs_empty(&line) || *line.pos < '0' || *line.pos > '9') {
+        break;
+      }
+
+      row[c] = procfs_u64(&line);
+    }
+
+    m->per_cpu[r] = c == m->ncpu;
+
+    for (; c < m->ncpu; c++) {
+      row[c] = 0;
+    }
+
+    /* The device may be renamed, or handed to another driver. */
+    procfs_trim(&line);
+    len = procfs_length(&line);
+
+    if (len == 0) {
+      MAYBE_FREE(m->desc[r]);
+    } else if (m->desc[r] == NULL                  ||
+               strlen(m->desc[r]) != len           ||
+               memcmp(m->desc[r], line.pos, len) != 0)
+    {
+      m->desc[r] = xrealloc(m->desc[r], len + 1);
+      procfs_copy(&line, m->desc[r], len + 1);
+    }
+
+    r++;
+  }
+
+  if (r != m->rows) {
+    m->changed = true;
+    m->rows    = r;
+  }
+
+  if (m->changed) {
+    memcpy(m->prev, m->value, (size_t)m->rows * m->ncpu * sizeof(uint64_t));
+  }
+
+  irq_matrix_delta(m->delta, m->value, m->prev, (size_t)m->rows * m->ncpu);
+  irq_matrix_totals(m);
+
+  /* The latest values become the previous ones. */
+  tmp      = m->prev;
+  m->prev  = m->value;
+  m->value = tmp;
+}
+#endif
+
+/*
+ * The `max' largest of `keys', largest first.
+ */
+static
+int
+top_select(const uint64_t *keys, int n, int *out, int max)
+{
+  int count = 0;
+  int i     = 0;
+  int j     = 0;
+
+  for (i = 0; i < n; i++) {
+    if (count == max && keys[i] <= keys[out[count - 1]]) {
+      continue;
+    }
+
+    j = count < max ? count++ : count - 1;
+
+    while (j > 0 && keys[out[j - 1]] < keys[i]) {
+      out[j] = out[j - 1];
+      j--;
+    }
+
+    out[j] = i;
+  }
+
+  return count;
+}
+
+static
+int
+irq_matrix_find(const irq_matrix_t *m, const char *label, size_t len)
+{
+  int r = 0;
+
+  for (r = 0; r < m->rows; r++) {
+    if (strlen(m->label[r]) == len && memcmp(m->label[r], label, len) == 0) {
+      return r;
+    }
+  }
+
+  return -1;
+}
+
+/* }}} */
+
+void
+get_irq(void *data)
+{
+  sm_irq_t       *ptr = (sm_irq_t *)data;
+  struct timeval  now;
+
+  gettimeofday(&now, NULL);
+
+  ptr->secs = elapsed_secs(&irq_last, &now);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+  irq_matrix_read(&ptr->irqs, &interrupts_file);
+  irq_matrix_read(&ptr->softirqs, &softirqs_file);
+#endif
+
+  ptr->time = now.tv_sec;
+  irq_last  = now;
+}
+
+void
+irq_timer(timer_clientdata_t data, struct timeval *now)
+{
+#ifdef DEBUG
+  printf("TIMER FIRE - Updating interrupts\n");
+#endif
+
+  generate_json((sm_base_t *)irq_instance);
+}
+
+/*
+ * Per second over the last tick, to two places.
+ */
+static
+double
+rate(uint64_t delta)
+{
+  if (irq_instance->secs <= 0) {
+    return 0.0;
+  }
+
+  return round2((double)delta / irq_instance->secs);
+}
+
+static
+void
+write_row(json_writer_t *w, const irq_matrix_t *m, int r)
+{
+  const uint64_t *row  = m->delta + (size_t)r * m->ncpu;
+  int             best = 0;
+  int             c    = 0;
+
+  for (c = 1; c < m->ncpu; c++) {
+    if (row[c] > row[best]) {
+      best = c;
+    }
+  }
+
+  json_write_begin_object(w);
+  json_write_key(w, strIrq);
+  json_write_string(w, m->label[r]);
+
+  if (m->desc[r] != NULL) {
+    json_write_key(w, strDesc);
+    json_write_string(w, m->desc[r]);
+  }
+
+  json_write_key(w, strRate);
+  json_write_number(w, rate(m->row_total[r]));
+
+  if (m->ncpu > 0 && m->per_cpu[r]) {
+    json_write_key(w, strBusiest);
+    json_write_int64(w, m->cpu_id[best]);
+    json_write_key(w, strShare);
+    json_write_number(w,
+                      m->row_total[r]
+                        ? round2((double)row[best] * 100.0 / m->row_total[r])
+                        : 0.0);
+  }
+
+  json_write_end_object(w);
+}
+
+/*
+ * The busiest sources and CPUs of one matrix.
+ */
+static
+void
+write_matrix(json_writer_t *w, const char *key, const irq_matrix_t *m)
+{
+  int      top[IRQ_TOP_N];
+  uint64_t total = 0;
+  int      n     = 0;
+  int      i     = 0;
+
+  for (i = 0; i < m->rows; i++) {
+    total += m->row_total[i];
+  }
+
+  json_write_key(w, key);
+  json_write_begin_object(w);
+
+  json_write_key(w, strTotal);
+  json_write_number(w, rate(total));
+
+  n = top_select(m->row_total, m->rows, top, IRQ_TOP_N);
+
+  json_write_key(w, strTop);
+  json_write_begin_array(w);
+
+  for (i = 0; i < n; i++) {
+    write_row(w, m, top[i]);
+  }
+
+  json_write_end_array(w);
+
+  n = top_select(m->cpu_total, m->ncpu, top, IRQ_TOP_N);
+
+  json_write_key(w, strTopCpus);
+  json_write_begin_array(w);
+
+  for (i = 0; i < n; i++) {
+    json_write_begin_object(w);
+    json_write_key(w, strCpu);
+    json_write_int64(w, m->cpu_id[top[i]]);
+    json_write_key(w, strRate);
+    json_write_number(w, rate(m->cpu_total[top[i]]));
+    json_write_end_object(w);
+  }
+
+  json_write_end_array(w);
+
+  json_write_end_object(w);
+}
+
+/*
+ * Which sources are busiest changes from tick to tick, so there is no
+ * template here.
+ */
+void
+emit_irq(json_writer_t *out)
+{
+  json_write_begin_object(out);
+
+  json_write_key(out, strUpdated);
+  json_write_int64(out, irq_instance->time);
+
+  write_matrix(out, strInterrupts, &irq_instance->irqs);
+  write_matrix(out, strSoftirqs, &irq_instance->softirqs);
+
+  json_write_end_object(out);
+}
+
+/*
+ * `irq/:irq' -- one interrupt or softirq, CPU by CPU.  Interrupts are
+ * looked for first; their labels never clash with softirq names.
+ */
+static
+bool
+serve_irq(void *data, const route_match_t *match, json_writer_t *out)
+{
+  sm_irq_t            *ptr   = (sm_irq_t *)data;
+  const route_param_t *param = route_param(match, strIrqParam);
+  const irq_matrix_t  *m     = &ptr->irqs;
+  const uint64_t      *row   = NULL;
+  int                  r     = -1;
+  int                  c     = 0;
+
+  if (param == NULL) {
+    return false;
+  }
+
+  if ((r = irq_matrix_find(m, param->value, param->length)) < 0) {
+    m = &ptr->softirqs;
+    r = irq_matrix_find(m, param->value, param->length);
+  }
+
+  if (r < 0) {
+    return false;
+  }
+
+  row = m->delta + (size_t)r * m->ncpu;
+
+  json_write_begin_object(out);
+  json_write_key(out, strIrq);
+  json_write_string(out, m->label[r]);
+
+  if (m->desc[r] != NULL) {
+    json_write_key(out, strDesc);
+    json_write_string(out, m->desc[r]);
+  }
+
+  json_write_key(out, strRate);
+  json_write_number(out, rate(m->row_total[r]));
+
+  json_write_key(out, strPerCpu);
+  json_write_begin_array(out);
+
+  for (c = 0; c < m->ncpu && m->per_cpu[r]; c++) {
+    json_write_begin_object(out);
+    json_write_key(out, strCpu);
+    json_write_int64(out, m->cpu_id[c]);
+    json_write_key(out, strRate);
+    json_write_number(out, rate(row[c]));
+    json_write_end_object(out);
+  }
+
+  json_write_end_array(out);
+  json_write_end_object(out);
+
+  return true;
+}
+
+void
+sm_irq_init(void)
+{
+  if (irq_instance == NULL) {
+    irq_instance       = xcalloc(1, sizeof(sm_irq_t));
+    irq_instance->vtab = xmalloc(sizeof(sm_vtable_t));
+
+    MAKE_VTABLE(irq_instance, &get_irq, &emit_irq, 0);
+    irq_instance->vtab->serve = &serve_irq;
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+    if (!procfs_open(&interrupts_file, strProcInterrupts, 16384)) {
+      syslog(LOG_ERR, "Could not open %s: %s", strProcInterrupts,
+             strerror(errno));
+    }
+
+    if (!procfs_open(&softirqs_file, strProcSoftirqs, 4096)) {
+      syslog(LOG_ERR, "Could not open %s: %s", strProcSoftirqs,
+             strerror(errno));
+    }
+#endif
+
+    generate_json((sm_base_t *)irq_instance);
+  }
+
+  if (irq_endpoint == NULL) {
+    irq_endpoint = endpoint_create(strName, irq_instance);
+    endpoint_add_route(irq_endpoint, strIrqRoute);
+  }
+
+  if (irq_timer_task == NULL) {
+    timer_clientdata_t data;
+
+    data.l = 0;
+    irq_timer_task = tmr_create(NULL,
+                                &irq_timer,
+                                data,
+                                5000,
+                                1);
+  }
+}
+
+/* sm_irq.c ends here. */
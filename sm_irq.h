@@ -0,0 +1,97 @@
+/*
+ * sm_irq.h --- Interrupt distribution.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 20:15:48
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_irq.h
+ * @author Paul Ward
+ * @brief Interrupt distribution.
+ */
+
+#ifndef _sm_irq_h_
+#define _sm_irq_h_
+
+#include <sys/types.h>
+
+#include "vtable.h"
+
+#ifndef IRQ_TOP_N
+# define IRQ_TOP_N 10                   /* Length of each top list. */
+#endif
+
+#define IRQ_LABEL_LEN 16
+
+/*
+ * A counter matrix, one row per interrupt source and one column per CPU,
+ * as laid out in /proc/interrupts and /proc/softirqs.  `value', `prev'
+ * and `delta' are dense and row-major, `rows' by `ncpu'; the deltas are
+ * over the last tick.
+ */
+typedef struct {
+  int        rows;
+  int        size;                      /* Rows allocated. */
+  int        ncpu;
+  int        cpu_size;                  /* Columns allocated. */
+  size_t     cells;                     /* Cells allocated. */
+  bool       changed;                   /* Rows or columns differ. */
+  int       *cpu_id;                    /* CPU number of each column. */
+  char     (*label)[IRQ_LABEL_LEN];
+  bool      *per_cpu;                   /* A count per CPU, not just one. */
+  char     **desc;                      /* Chip, trigger and device; or NULL. */
+  uint64_t  *value;
+  uint64_t  *prev;
+  uint64_t  *delta;
+  uint64_t  *row_total;                 /* Sum of each row of `delta'. */
+  uint64_t  *cpu_total;                 /* Sum of each column of `delta'. */
+} irq_matrix_t;
+
+typedef struct {
+  sm_vtable_t  *vtab;
+  irq_matrix_t  irqs;
+  irq_matrix_t  softirqs;
+  double        secs;                   /* Length of the last tick. */
+  time_t        time;                   /* Update time. */
+} sm_irq_t;
+
+void sm_irq_init(void);
+
+#endif /* !_sm_irq_h_ */
+
+/* sm_irq.h ends here. */
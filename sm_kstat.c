@@ -0,0 +1,475 @@
+/*
+ * sm_kstat.c --- Kernel counters reported as rates.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 20:52:40
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_kstat.c
+ * @author Paul Ward
+ * @brief Kernel counters reported as rates.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_kstat.h"
+#include "endpoints.h"
+#include "timers.h"
+#include "utils.h"
+#include "procfs.h"
+
+typedef struct {
+  kstat_file_t  file;
+  const char   *group;                  /* NULL for /proc/vmstat. */
+  const char   *name;
+  const char   *key;
+} kstat_def_t;
+
+static const kstat_def_t kstat_defs[] = {
+#define SM_VMSTAT(__name, __key)            \
+  { KSTAT_VMSTAT,  NULL,    __name, __key },
+#define SM_SNMP(__group, __name, __key)     \
+  { KSTAT_SNMP,    __group, __name, __key },
+#define SM_NETSTAT(__group, __name, __key)  \
+  { KSTAT_NETSTAT, __group, __name, __key },
+#include "kstat.def"
+};
+
+#define NKSTATS ((int)(sizeof(kstat_defs) / sizeof(kstat_defs[0])))
+
+static endpoint_t        *kstat_endpoint    = NULL;
+static sm_kstat_t        *kstat_instance    = NULL;
+static timer_task_t      *kstat_timer_task  = NULL;
+static json_template_t    kstat_template;
+static int                kstat_template_ok = 0;
+static json_hole_value_t *kstat_values      = NULL;
+static struct timeval     kstat_last;
+
+static const char strName[]         = "kstat";
+static const char strUpdated[]      = "updatedAt";
+
+/* The document's sections, and which each file's counters go under. */
+static const char *section_names[] = {
+  "vm",
+  "net"
+};
+
+static const int file_sections[KSTAT_NFILES] = {
+  0,
+  1,
+  1
+};
+
+#define NSECTIONS ((int)(sizeof(section_names) / sizeof(section_names[0])))
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static const char *file_names[KSTAT_NFILES] = {
+  "/proc/vmstat",
+  "/proc/net/snmp",
+  "/proc/net/netstat"
+};
+
+static procfs_file_t  kstat_files[KSTAT_NFILES];
+static int            kstat_lines[KSTAT_NFILES];   /* When last mapped. */
+static int           *kstat_order[KSTAT_NFILES];   /* By line and column. */
+static int            kstat_norder[KSTAT_NFILES];
+#endif
+
+/* {{{ Mapping: */
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+/*
+ * Note that counter `i' is at `line', `column'.
+ */
+static
+void
+kstat_place(sm_kstat_t *ptr, kstat_file_t f, int i, int line, int column)
+{
+  int j = kstat_norder[f]++;
+
+  ptr->line[i]   = line;
+  ptr->column[i] = column;
+
+  /* Keep the order sorted, so that sampling is a single pass. */
+  while (j > 0 &&
+         (ptr->line[kstat_order[f][j - 1]] > line ||
+          (ptr->line[kstat_order[f][j - 1]] == line &&
+           ptr->column[kstat_order[f][j - 1]] > column)))
+  {
+    kstat_order[f][j] = kstat_order[f][j - 1];
+    j--;
+  }
+
+  kstat_order[f][j] = i;
+}
+
+/*
+ * Find the counters in the file just read.  /proc/vmstat is a line of
+ * `name value' per counter:
+ *
+ *   pgfault 2840163
+ *
+ * The other two come in pairs of lines, names then values:
+ *
+ *   Tcp: RtoAlgorithm RtoMin RtoMax MaxConn ActiveOpens ...
+ *   Tcp: 1 200 120000 -1 6014 ...
+ */
+static
+void
+kstat_map(sm_kstat_t *ptr, kstat_file_t f)
+{
+  procfs_scan_t scan;
+  procfs_scan_t line;
+  procfs_scan_t values;
+  procfs_scan_t group;
+  procfs_scan_t tok;
+  int           nline  = 0;
+  int           column = 0;
+  int           i      = 0;
+
+  kstat_norder[f] = 0;
+
+  for (i = 0; i < NKSTATS; i++) {
+    if (kstat_defs[i].file == f) {
+      ptr->line[i] = -1;
+    }
+  }
+
+  procfs_scan_file(&scan, &kstat_files[f]);
+
+  while (procfs_next_line(&scan, &line)) {
+    if (f == KSTAT_VMSTAT) {
+      procfs_next_token(&line, &tok);
+
+      for (i = 0; i < NKSTATS; i++) {
+        if (kstat_defs[i].file == f      &&
+            ptr->line[i] < 0             &&
+            procfs_equal(&tok, kstat_defs[i].name))
+        {
+          kstat_place(ptr, f, i, nline, 1);
+        }
+      }
+
+      nline++;
+      continue;
+    }
+
+    if (!procfs_next_line(&scan, &values)) {
+      nline++;
+      break;
+    }
+
+    procfs_next_token(&line, &group);
+
+    if (!procfs_empty(&group) && group.end[-1] == ':') {
+      group.end--;
+    }
+
+    for (column = 1; procfs_next_token(&line, &tok); column++) {
+      for (i = 0; i < NKSTATS; i++) {
+        if (kstat_defs[i].file == f                  &&
+            ptr->line[i] < 0                         &&
+            procfs_equal(&group, kstat_defs[i].group) &&
+            procfs_equal(&tok, kstat_defs[i].name))
+        {
+          kstat_place(ptr, f, i, nline + 1, column);
+        }
+      }
+    }
+
+    nline += 2;
+  }
+
+  kstat_lines[f] = nline;
+}
+
+/*
+ * Read one file and pick out its counters.  Returns false if the file
+ * has changed length since it was mapped, and needs mapping again.
+ */
+static
+bool
+kstat_sample(sm_kstat_t *ptr, kstat_file_t f)
+{
+  procfs_scan_t scan;
+  procfs_scan_t line;
+  procfs_scan_t tok;
+  int           nline  = 0;
+  int           column = 0;
+  int           k      = 0;
+  int           i      = 0;
+
+  procfs_scan_file(&scan, &kstat_files[f]);
+
+  for (nline = 0; procfs_next_line(&scan, &line); nline++) {
+    column = 0;
+
+    for (; k < kstat_norder[f]; k++) {
+      i = kstat_order[f][k];
+
+      if (ptr->line[i] != nline) {
+        break;
+      }
+
+      for (; column < ptr->column[i]; column++) {
+        procfs_next_token(&line, &tok);
+      }
+
+      ptr->value[i] = procfs_u64(&line);
+      column++;
+    }
+  }
+
+  return nline == kstat_lines[f];
+}
+#endif
+
+/* }}} */
+
+void
+get_kstat(void *data)
+{
+  sm_kstat_t     *ptr  = (sm_kstat_t *)data;
+  struct timeval  now;
+  double          secs = 0.0;
+  int             i    = 0;
+  int             f    = 0;
+
+  gettimeofday(&now, NULL);
+
+  secs = elapsed_secs(&kstat_last, &now);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+  for (f = 0; f < KSTAT_NFILES; f++) {
+    if (procfs_read(&kstat_files[f]) < 0) {
+      continue;
+    }
+
+    if (kstat_sample(ptr, f)) {
+      continue;
+    }
+
+    /* A different kernel, in effect; start again from here. */
+    kstat_map(ptr, f);
+    kstat_sample(ptr, f);
+
+    for (i = 0; i < NKSTATS; i++) {
+      if (kstat_defs[i].file == f) {
+        ptr->prev[i] = ptr->value[i];
+      }
+    }
+
+    if (kstat_template_ok) {
+      json_template_free(&kstat_template);
+      kstat_template_ok = 0;
+    }
+  }
+#endif
+
+  for (i = 0; i < NKSTATS; i++) {
+    ptr->rate[i] = 0.0;
+
+    if (secs > 0 && ptr->value[i] >= ptr->prev[i]) {
+      ptr->rate[i] = round2((double)(ptr->value[i] - ptr->prev[i]) / secs);
+    }
+
+    ptr->prev[i] = ptr->value[i];
+  }
+
+  ptr->time  = now.tv_sec;
+  kstat_last = now;
+}
+
+void
+kstat_timer(timer_clientdata_t data, struct timeval *now)
+{
+#ifdef DEBUG
+  printf("TIMER FIRE - Updating kernel counters\n");
+#endif
+
+  generate_json((sm_base_t *)kstat_instance);
+}
+
+/*
+ * Is there a hole for counter `i'?  Only for those the kernel has.
+ */
+#define KSTAT_PRESENT(__ptr, __i) ((__ptr)->line[(__i)] >= 0)
+
+static
+void
+make_kstat_template(void)
+{
+  json_template_t *tpl  = &kstat_template;
+  json_writer_t   *w    = &tpl->writer;
+  sm_kstat_t      *ptr  = kstat_instance;
+  bool             open = false;
+  int              s    = 0;
+  int              i    = 0;
+
+  json_template_init(tpl);
+
+  json_write_begin_object(w);
+
+  json_write_key(w, strUpdated);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+
+  for (s = 0; s < NSECTIONS; s++) {
+    open = false;
+
+    for (i = 0; i < NKSTATS; i++) {
+      if (!KSTAT_PRESENT(ptr, i) || file_sections[kstat_defs[i].file] != s) {
+        continue;
+      }
+
+      if (!open) {
+        json_write_key(w, section_names[s]);
+        json_write_begin_object(w);
+        open = true;
+      }
+
+      json_write_key(w, kstat_defs[i].key);
+      json_template_hole(tpl, JSON_HOLE_NUMBER);
+    }
+
+    if (open) {
+      json_write_end_object(w);
+    }
+  }
+
+  json_write_end_object(w);
+
+  json_template_finish(tpl);
+  kstat_template_ok = 1;
+}
+
+void
+emit_kstat(json_writer_t *out)
+{
+  sm_kstat_t *ptr  = kstat_instance;
+  int         hole = 0;
+  int         s    = 0;
+  int         i    = 0;
+
+  if (!kstat_template_ok) {
+    make_kstat_template();
+  }
+
+  kstat_values[hole++]._int64 = ptr->time;
+
+  /* In the same order as the template's holes. */
+  for (s = 0; s < NSECTIONS; s++) {
+    for (i = 0; i < NKSTATS; i++) {
+      if (KSTAT_PRESENT(ptr, i) && file_sections[kstat_defs[i].file] == s) {
+        kstat_values[hole++]._number = ptr->rate[i];
+      }
+    }
+  }
+
+  json_template_render(&kstat_template, out, kstat_values);
+}
+
+void
+sm_kstat_init(void)
+{
+  int f = 0;
+
+  if (kstat_instance == NULL) {
+    kstat_instance         = xcalloc(1, sizeof(sm_kstat_t));
+    kstat_instance->vtab   = xmalloc(sizeof(sm_vtable_t));
+    kstat_instance->count  = NKSTATS;
+    kstat_instance->line   = xmalloc(NKSTATS * sizeof(int));
+    kstat_instance->column = xcalloc(NKSTATS, sizeof(int));
+    kstat_instance->value  = xcalloc(NKSTATS, sizeof(uint64_t));
+    kstat_instance->prev   = xcalloc(NKSTATS, sizeof(uint64_t));
+    kstat_instance->rate   = xcalloc(NKSTATS, sizeof(double));
+    kstat_values           = xmalloc((NKSTATS + 1)
+                                     * sizeof(json_hole_value_t));
+
+    memset(kstat_instance->line, -1, NKSTATS * sizeof(int));
+
+    MAKE_VTABLE(kstat_instance, &get_kstat, &emit_kstat, 0);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+    /* Map the files now, so that sampling never has to search them. */
+    for (f = 0; f < KSTAT_NFILES; f++) {
+      kstat_order[f] = xmalloc(NKSTATS * sizeof(int));
+
+      if (!procfs_open(&kstat_files[f], file_names[f], 8192)) {
+        syslog(LOG_ERR, "Could not open %s: %s", file_names[f],
+               strerror(errno));
+        continue;
+      }
+
+      if (procfs_read(&kstat_files[f]) >= 0) {
+        kstat_map(kstat_instance, f);
+      }
+    }
+#endif
+
+    generate_json((sm_base_t *)kstat_instance);
+  }
+
+  if (kstat_endpoint == NULL) {
+    kstat_endpoint = endpoint_create(strName, kstat_instance);
+  }
+
+  if (kstat_timer_task == NULL) {
+    timer_clientdata_t data;
+
+    data.l = 0;
+    kstat_timer_task = tmr_create(NULL,
+                                  &kstat_timer,
+                                  data,
+                                  5000,
+                                  1);
+  }
+}
+
+/* sm_kstat.c ends here. */
@@ -0,0 +1,82 @@
+/*
+ * sm_kstat.h --- Kernel counters reported as rates.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 20:52:31
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_kstat.h
+ * @author Paul Ward
+ * @brief Kernel counters reported as rates.
+ */
+
+#ifndef _sm_kstat_h_
+#define _sm_kstat_h_
+
+#include <sys/types.h>
+
+#include "vtable.h"
+
+typedef enum {
+  KSTAT_VMSTAT,
+  KSTAT_SNMP,
+  KSTAT_NETSTAT,
+  KSTAT_NFILES
+} kstat_file_t;
+
+/*
+ * Counters as a structure of arrays, in the order of kstat.def.  Where
+ * each one lives in its file -- its line, and its column on that line --
+ * is worked out once, and again only if the file changes length.
+ */
+typedef struct {
+  sm_vtable_t *vtab;
+  int          count;
+  int         *line;                    /* -1 if the kernel lacks it. */
+  int         *column;
+  uint64_t    *value;
+  uint64_t    *prev;
+  double      *rate;                    /* Per second, over the last tick. */
+  time_t       time;                    /* Update time. */
+} sm_kstat_t;
+
+void sm_kstat_init(void);
+
+#endif /* !_sm_kstat_h_ */
+
+/* sm_kstat.h ends here. */
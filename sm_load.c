@@ -0,0 +1,479 @@
+/*
+ * sm_load.c --- Load average and pressure stall information.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 16:31:16
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_load.c
+ * @author Paul Ward
+ * @brief Load average and pressure stall information.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_load.h"
+#include "endpoints.h"
+#include "timers.h"
+#include "fdwatch.h"
+#include "utils.h"
+#include "procfs.h"
+
+/*
+ * PSI trigger: wake up when tasks have been stalled for PSI_TRIGGER_STALL
+ * microseconds within any PSI_TRIGGER_WINDOW microseconds.  The kernel
+ * fires a trigger at most once per window, and without CAP_SYS_RESOURCE
+ * only accepts windows that are a multiple of two seconds.
+ */
+#ifndef PSI_TRIGGER_STALL
+# define PSI_TRIGGER_STALL   200000
+#endif
+
+#ifndef PSI_TRIGGER_WINDOW
+# define PSI_TRIGGER_WINDOW  2000000
+#endif
+
+static endpoint_t      *load_endpoint    = NULL;
+static sm_load_t       *load_instance    = NULL;
+static timer_task_t    *load_timer_task  = NULL;
+static json_template_t  load_template;
+static int              load_template_ok = 0;
+
+static const char strName[]         = "load";
+static const char strUpdated[]      = "updatedAt";
+static const char strAverage[]      = "average";
+static const char strRunnable[]     = "runnable";
+static const char strTasks[]        = "tasks";
+static const char strLastPid[]      = "lastPid";
+static const char strPressure[]     = "pressure";
+static const char strEvents[]       = "events";
+static const char strAvg10[]        = "avg10";
+static const char strAvg60[]        = "avg60";
+static const char strAvg300[]       = "avg300";
+static const char strTotal[]        = "total";
+
+static const char *load_names[3] = { "1m", "5m", "15m" };
+
+static const char *psi_names[PSI_NRESOURCES] = {
+  "cpu",
+  "memory",
+  "io"
+};
+
+static const char *psi_kinds[PSI_NKINDS] = {
+  "some",
+  "full"
+};
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static const char strProcLoadavg[]  = "/proc/loadavg";
+
+static const char *psi_paths[PSI_NRESOURCES] = {
+  "/proc/pressure/cpu",
+  "/proc/pressure/memory",
+  "/proc/pressure/io"
+};
+
+static procfs_file_t loadavg_file;
+static procfs_file_t psi_files[PSI_NRESOURCES];
+#endif
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+/*
+ * `0.30 0.25 0.20 2/123 4567'
+ */
+static
+void
+parse_loadavg(sm_load_t *ptr)
+{
+  procfs_scan_t scan;
+  int           i = 0;
+
+  procfs_scan_file(&scan, &loadavg_file);
+
+  for (i = 0; i < 3; i++) {
+    procfs_skip_space(&scan);
+    ptr->load[i] = procfs_fixed(&scan);
+  }
+
+  ptr->runnable = (long)procfs_u64(&scan);
+  procfs_prefix(&scan, "/");
+  ptr->tasks    = (long)procfs_u64(&scan);
+  ptr->last_pid = (long)procfs_u64(&scan);
+}
+
+/*
+ * `some avg10=0.00 avg60=0.00 avg300=0.00 total=0', then the same for
+ * `full'.
+ */
+static
+void
+parse_pressure(psi_t *psi, const procfs_file_t *file)
+{
+  procfs_scan_t  scan;
+  procfs_scan_t  line;
+  procfs_scan_t  tok;
+  procfs_scan_t  key;
+  psi_line_t    *dst = NULL;
+
+  procfs_scan_file(&scan, file);
+
+  while (procfs_next_line(&scan, &line)) {
+    if (!procfs_next_token(&line, &tok)) {
+      continue;
+    }
+
+    if (procfs_equal(&tok, psi_kinds[PSI_SOME])) {
+      dst = &psi->line[PSI_SOME];
+    } else if (procfs_equal(&tok, psi_kinds[PSI_FULL])) {
+      dst = &psi->line[PSI_FULL];
+    } else {
+      continue;
+    }
+
+    while (procfs_next_token(&line, &tok)) {
+      if (!procfs_split(&tok, '=', &key)) {
+        continue;
+      }
+
+      if (procfs_equal(&key, strAvg10)) {
+        dst->avg10 = procfs_fixed(&tok);
+      } else if (procfs_equal(&key, strAvg60)) {
+        dst->avg60 = procfs_fixed(&tok);
+      } else if (procfs_equal(&key, strAvg300)) {
+        dst->avg300 = procfs_fixed(&tok);
+      } else if (procfs_equal(&key, strTotal)) {
+        dst->total = procfs_u64(&tok);
+      }
+    }
+  }
+}
+#endif
+
+void
+get_load(void *data)
+{
+  sm_load_t *ptr = (sm_load_t *)data;
+  int        i   = 0;
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+  if (procfs_read(&loadavg_file) > 0) {
+    parse_loadavg(ptr);
+  }
+
+  for (i = 0; i < PSI_NRESOURCES; i++) {
+    if (ptr->pressure[i].available && procfs_read(&psi_files[i]) > 0) {
+      parse_pressure(&ptr->pressure[i], &psi_files[i]);
+    }
+  }
+#else
+  if (getloadavg(ptr->load, 3) < 0) {
+    for (i = 0; i < 3; i++) {
+      ptr->load[i] = 0.0;
+    }
+  }
+#endif
+
+  ptr->time = time(NULL);
+}
+
+void
+load_timer(timer_clientdata_t data, struct timeval *now)
+{
+#ifdef DEBUG
+  printf("TIMER FIRE - Updating load\n");
+#endif
+
+  generate_json((sm_base_t *)load_instance);
+}
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+/*
+ * A PSI trigger fired: stalls crossed the threshold, so sample now rather
+ * than at the next tick.
+ */
+static
+void
+psi_event(int fd, void *data)
+{
+  psi_t *psi = (psi_t *)data;
+
+  /* The trigger has gone away. */
+  if (!fdwatch_check_fd(fd)) {
+    syslog(LOG_NOTICE, "PSI trigger on fd %d no longer usable", fd);
+    fdwatch_del_fd(fd);
+    close(fd);
+    psi->trigger_fd = -1;
+    return;
+  }
+
+  psi->events++;
+
+  generate_json((sm_base_t *)load_instance);
+}
+
+/*
+ * Open a resource's pressure file for sampling and, on a separate
+ * descriptor, arm a trigger on it.  Triggers need a 5.2 kernel and may be
+ * refused to unprivileged users, in which case the resource is still
+ * sampled on the timer.
+ */
+static
+void
+psi_open(psi_t *psi, int res)
+{
+  char buf[64];
+  int  len = 0;
+  int  fd  = -1;
+
+  psi->trigger_fd = -1;
+  psi->available  = procfs_open(&psi_files[res], psi_paths[res], 256);
+
+  if (!psi->available) {
+    return;
+  }
+
+  fd = open(psi_paths[res], O_RDWR | O_NONBLOCK);
+
+  if (fd < 0) {
+    return;
+  }
+
+  len = snprintf(buf,
+                 sizeof(buf),
+                 "%s %d %d",
+                 psi_kinds[PSI_SOME],
+                 PSI_TRIGGER_STALL,
+                 PSI_TRIGGER_WINDOW);
+
+  /* The kernel wants the terminating NUL as well. */
+  if (write(fd, buf, len + 1) < 0) {
+    syslog(LOG_NOTICE,
+           "Could not arm PSI trigger on %s: %s",
+           psi_paths[res],
+           strerror(errno));
+    close(fd);
+    return;
+  }
+
+  psi->trigger_fd = fd;
+  fdwatch_add_handler(fd, FDW_PRI, &psi_event, psi);
+}
+#endif
+
+/*
+ * The document's shape depends only on which pressure files exist, which
+ * is settled at start-up.
+ */
+static
+void
+make_load_template(void)
+{
+  json_template_t *tpl = &load_template;
+  json_writer_t   *w   = &tpl->writer;
+  int              i   = 0;
+  int              j   = 0;
+
+  json_template_init(tpl);
+
+  json_write_begin_object(w);
+
+  json_write_key(w, strUpdated);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+
+  json_write_key(w, strAverage);
+  json_write_begin_object(w);
+
+  for (i = 0; i < 3; i++) {
+    json_write_key(w, load_names[i]);
+    json_template_hole(tpl, JSON_HOLE_NUMBER);
+  }
+
+  json_write_end_object(w);
+
+  json_write_key(w, strRunnable);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+  json_write_key(w, strTasks);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+  json_write_key(w, strLastPid);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+
+  json_write_key(w, strPressure);
+  json_write_begin_object(w);
+
+  for (i = 0; i < PSI_NRESOURCES; i++) {
+    if (!load_instance->pressure[i].available) {
+      continue;
+    }
+
+    json_write_key(w, psi_names[i]);
+    json_write_begin_object(w);
+
+    for (j = 0; j < PSI_NKINDS; j++) {
+      json_write_key(w, psi_kinds[j]);
+      json_write_begin_object(w);
+      json_write_key(w, strAvg10);
+      json_template_hole(tpl, JSON_HOLE_NUMBER);
+      json_write_key(w, strAvg60);
+      json_template_hole(tpl, JSON_HOLE_NUMBER);
+      json_write_key(w, strAvg300);
+      json_template_hole(tpl, JSON_HOLE_NUMBER);
+      json_write_key(w, strTotal);
+      json_template_hole(tpl, JSON_HOLE_UINT64);
+      json_write_end_object(w);
+    }
+
+    json_write_key(w, strEvents);
+    json_template_hole(tpl, JSON_HOLE_UINT64);
+
+    json_write_end_object(w);
+  }
+
+  json_write_end_object(w);
+
+  json_write_end_object(w);
+
+  json_template_finish(tpl);
+  load_template_ok = 1;
+}
+
+void
+emit_load(json_writer_t *out)
+{
+  json_hole_value_t  values[7 + PSI_NRESOURCES * (PSI_NKINDS * 4 + 1)];
+  sm_load_t         *ptr  = load_instance;
+  psi_line_t        *line = NULL;
+  int                n    = 0;
+  int                i    = 0;
+  int                j    = 0;
+
+  if (!load_template_ok) {
+    make_load_template();
+  }
+
+  values[n++]._int64 = ptr->time;
+
+  for (i = 0; i < 3; i++) {
+    values[n++]._number = ptr->load[i];
+  }
+
+  values[n++]._int64 = ptr->runnable;
+  values[n++]._int64 = ptr->tasks;
+  values[n++]._int64 = ptr->last_pid;
+
+  for (i = 0; i < PSI_NRESOURCES; i++) {
+    if (!ptr->pressure[i].available) {
+      continue;
+    }
+
+    for (j = 0; j < PSI_NKINDS; j++) {
+      line = &ptr->pressure[i].line[j];
+
+      values[n++]._number = line->avg10;
+      values[n++]._number = line->avg60;
+      values[n++]._number = line->avg300;
+      values[n++]._uint64 = line->total;
+    }
+
+    values[n++]._uint64 = ptr->pressure[i].events;
+  }
+
+  json_template_render(&load_template, out, values);
+}
+
+void
+sm_load_init(void)
+{
+  int i = 0;
+
+  if (load_instance == NULL) {
+    load_instance       = xcalloc(1, sizeof(sm_load_t));
+    load_instance->vtab = xmalloc(sizeof(sm_vtable_t));
+
+    MAKE_VTABLE(load_instance, &get_load, &emit_load, 0);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+    if (!procfs_open(&loadavg_file, strProcLoadavg, 128)) {
+      syslog(LOG_ERR,
+             "Could not open %s: %s",
+             strProcLoadavg,
+             strerror(errno));
+    }
+
+    for (i = 0; i < PSI_NRESOURCES; i++) {
+      psi_open(&load_instance->pressure[i], i);
+    }
+#else
+    for (i = 0; i < PSI_NRESOURCES; i++) {
+      load_instance->pressure[i].trigger_fd = -1;
+    }
+#endif
+
+    generate_json((sm_base_t *)load_instance);
+  }
+
+  if (load_endpoint == NULL) {
+    load_endpoint = endpoint_create(strName, load_instance);
+  }
+
+  if (load_timer_task == NULL) {
+    timer_clientdata_t data;
+
+    data.l = 0;
+    load_timer_task = tmr_create(NULL,
+                                 &load_timer,
+                                 data,
+                                 10000,
+                                 1);
+  }
+}
+
+/* sm_load.c ends here. */
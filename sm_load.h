@@ -0,0 +1,99 @@
+/*
+ * sm_load.h --- Load average and pressure stall information.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 16:31:09
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_load.h
+ * @author Paul Ward
+ * @brief Load average and pressure stall information.
+ */
+
+#ifndef _sm_load_h_
+#define _sm_load_h_
+
+#include <sys/types.h>
+
+#include "vtable.h"
+
+typedef enum {
+  PSI_CPU,
+  PSI_MEMORY,
+  PSI_IO,
+  PSI_NRESOURCES
+} psi_resource_t;
+
+typedef enum {
+  PSI_SOME,                             /* Some tasks stalled. */
+  PSI_FULL,                             /* All non-idle tasks stalled. */
+  PSI_NKINDS
+} psi_kind_t;
+
+/*
+ * One line of a /proc/pressure file.
+ */
+typedef struct {
+  double   avg10;                       /* Percentage over 10 seconds. */
+  double   avg60;
+  double   avg300;
+  uint64_t total;                       /* Total stall time in us. */
+} psi_line_t;
+
+typedef struct {
+  bool          available;              /* Kernel has PSI for this. */
+  int           trigger_fd;             /* Armed trigger, or -1. */
+  unsigned long events;                 /* Times the trigger has fired. */
+  psi_line_t    line[PSI_NKINDS];
+} psi_t;
+
+typedef struct {
+  sm_vtable_t *vtab;
+  double       load[3];                 /* 1, 5 and 15 minute averages. */
+  long         runnable;                /* Runnable scheduling entities. */
+  long         tasks;                   /* Existing scheduling entities. */
+  long         last_pid;                /* Most recently created PID. */
+  psi_t        pressure[PSI_NRESOURCES];
+  time_t       time;                    /* Update time. */
+} sm_load_t;
+
+void sm_load_init(void);
+
+#endif /* !_sm_load_h_ */
+
+/* sm_load.h ends here. */
@@ -0,0 +1,347 @@
+/*
+ * sm_mem.c --- Memory information.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 16:02:51
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_mem.c
+ * @author Paul Ward
+ * @brief Memory information.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_mem.h"
+#include "endpoints.h"
+#include "timers.h"
+#include "utils.h"
+#include "procfs.h"
+
+/*
+ * What to do with one line of /proc/meminfo.
+ */
+typedef struct {
+  int      field;                       /* `mem_field_t', or -1 to skip. */
+  uint64_t scale;                       /* 1024 for `kB', otherwise 1. */
+} mem_line_t;
+
+static endpoint_t      *mem_endpoint    = NULL;
+static sm_mem_t        *mem_instance    = NULL;
+static timer_task_t    *mem_timer_task  = NULL;
+static json_template_t  mem_template;
+static int              mem_template_ok = 0;
+
+static const char strName[]         = "mem";
+static const char strUpdated[]      = "updatedAt";
+static const char strSwap[]         = "swap";
+static const char strHugePages[]    = "hugePages";
+static const char strSlab[]         = "slab";
+
+/*
+ * /proc/meminfo key for each of `mem_field_t'.
+ */
+static const char *meminfo_keys[MEM_NFIELDS] = {
+  "MemTotal",
+  "MemFree",
+  "MemAvailable",
+  "Buffers",
+  "Cached",
+  "Dirty",
+  "Writeback",
+  "Shmem",
+  "SwapTotal",
+  "SwapFree",
+  "SwapCached",
+  "HugePages_Total",
+  "HugePages_Free",
+  "HugePages_Rsvd",
+  "Hugepagesize",
+  "Slab",
+  "SReclaimable",
+  "SUnreclaim"
+};
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static const char strProcMeminfo[]  = "/proc/meminfo";
+
+static procfs_file_t  meminfo_file;
+static mem_line_t    *meminfo_lines     = NULL;
+static int            meminfo_nlines    = 0;
+static int            meminfo_max_lines = 0;
+#endif
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+/*
+ * Work out which field, if any, each line of /proc/meminfo holds.  The
+ * kernel always lists the same keys in the same order, so this is only
+ * needed again if the number of lines changes.
+ */
+static
+void
+index_meminfo(void)
+{
+  procfs_scan_t  scan;
+  procfs_scan_t  line;
+  procfs_scan_t  key;
+  mem_line_t    *ent = NULL;
+  int            i   = 0;
+
+  meminfo_nlines = 0;
+  procfs_scan_file(&scan, &meminfo_file);
+
+  while (procfs_next_line(&scan, &line)) {
+    if (meminfo_nlines == meminfo_max_lines) {
+      meminfo_max_lines = meminfo_max_lines ? meminfo_max_lines * 2 : 64;
+      meminfo_lines     = xrealloc(meminfo_lines,
+                                   meminfo_max_lines * sizeof(mem_line_t));
+    }
+
+    ent        = &meminfo_lines[meminfo_nlines++];
+    ent->field = -1;
+    ent->scale = 1;
+
+    if (!procfs_split(&line, ':', &key)) {
+      continue;
+    }
+
+    for (i = 0; i < MEM_NFIELDS; i++) {
+      if (procfs_equal(&key, meminfo_keys[i])) {
+        ent->field = i;
+        break;
+      }
+    }
+
+    procfs_u64(&line);
+    procfs_skip_space(&line);
+
+    if (procfs_prefix(&line, "kB")) {
+      ent->scale = 1024;
+    }
+  }
+}
+
+/*
+ * One pass over /proc/meminfo, by line number.  Returns false if the file
+ * no longer has the shape it was indexed with.
+ */
+static
+bool
+parse_meminfo(sm_mem_t *ptr)
+{
+  procfs_scan_t scan;
+  procfs_scan_t line;
+  procfs_scan_t key;
+  int           n = 0;
+
+  procfs_scan_file(&scan, &meminfo_file);
+
+  for (n = 0; procfs_next_line(&scan, &line); n++) {
+    if (n >= meminfo_nlines) {
+      return false;
+    }
+
+    if (meminfo_lines[n].field < 0 || !procfs_split(&line, ':', &key)) {
+      continue;
+    }
+
+    ptr->fields[meminfo_lines[n].field] =
+      procfs_u64(&line) * meminfo_lines[n].scale;
+  }
+
+  return n == meminfo_nlines;
+}
+#endif
+
+void
+get_mem(void *data)
+{
+  sm_mem_t *ptr = (sm_mem_t *)data;
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+  if (procfs_read(&meminfo_file) >= 0 && !parse_meminfo(ptr)) {
+    index_meminfo();
+    parse_meminfo(ptr);
+  }
+#endif
+
+  ptr->time = time(NULL);
+}
+
+void
+mem_timer(timer_clientdata_t data, struct timeval *now)
+{
+#ifdef DEBUG
+  printf("TIMER FIRE - Updating memory\n");
+#endif
+
+  generate_json((sm_base_t *)mem_instance);
+}
+
+/*
+ * Write `key' and a hole for its value.  Holes must be made in the order
+ * of `mem_field_t', after the update time.
+ */
+static
+void
+mem_hole(json_template_t *tpl, const char *key)
+{
+  json_write_key(&tpl->writer, key);
+  json_template_hole(tpl, JSON_HOLE_UINT64);
+}
+
+/*
+ * The memory document has a fixed shape; serialise it once.
+ */
+static
+void
+make_mem_template(void)
+{
+  json_template_t *tpl = &mem_template;
+  json_writer_t   *w   = &tpl->writer;
+
+  json_template_init(tpl);
+
+  json_write_begin_object(w);
+
+  json_write_key(w, strUpdated);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+
+  mem_hole(tpl, "total");
+  mem_hole(tpl, "free");
+  mem_hole(tpl, "available");
+  mem_hole(tpl, "buffers");
+  mem_hole(tpl, "cached");
+  mem_hole(tpl, "dirty");
+  mem_hole(tpl, "writeback");
+  mem_hole(tpl, "shared");
+
+  json_write_key(w, strSwap);
+  json_write_begin_object(w);
+  mem_hole(tpl, "total");
+  mem_hole(tpl, "free");
+  mem_hole(tpl, "cached");
+  json_write_end_object(w);
+
+  json_write_key(w, strHugePages);
+  json_write_begin_object(w);
+  mem_hole(tpl, "total");
+  mem_hole(tpl, "free");
+  mem_hole(tpl, "reserved");
+  mem_hole(tpl, "pageSize");
+  json_write_end_object(w);
+
+  json_write_key(w, strSlab);
+  json_write_begin_object(w);
+  mem_hole(tpl, "total");
+  mem_hole(tpl, "reclaimable");
+  mem_hole(tpl, "unreclaimable");
+  json_write_end_object(w);
+
+  json_write_end_object(w);
+
+  json_template_finish(tpl);
+  mem_template_ok = 1;
+}
+
+void
+emit_mem(json_writer_t *out)
+{
+  json_hole_value_t values[MEM_NFIELDS + 1];
+  int               i = 0;
+
+  if (!mem_template_ok) {
+    make_mem_template();
+  }
+
+  values[0]._int64 = mem_instance->time;
+
+  for (i = 0; i < MEM_NFIELDS; i++) {
+    values[i + 1]._uint64 = mem_instance->fields[i];
+  }
+
+  json_template_render(&mem_template, out, values);
+}
+
+void
+sm_mem_init(void)
+{
+  if (mem_instance == NULL) {
+    mem_instance       = xcalloc(1, sizeof(sm_mem_t));
+    mem_instance->vtab = xmalloc(sizeof(sm_vtable_t));
+
+    MAKE_VTABLE(mem_instance, &get_mem, &emit_mem, 0);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+    if (!procfs_open(&meminfo_file, strProcMeminfo, 4096)) {
+      syslog(LOG_ERR,
+             "Could not open %s: %s",
+             strProcMeminfo,
+             strerror(errno));
+    }
+#endif
+
+    generate_json((sm_base_t *)mem_instance);
+  }
+
+  if (mem_endpoint == NULL) {
+    mem_endpoint = endpoint_create(strName, mem_instance);
+  }
+
+  if (mem_timer_task == NULL) {
+    timer_clientdata_t data;
+
+    data.l = 0;
+    mem_timer_task = tmr_create(NULL,
+                                &mem_timer,
+                                data,
+                                10000,
+                                1);
+  }
+}
+
+/* sm_mem.c ends here. */
@@ -0,0 +1,91 @@
+/*
+ * sm_mem.h --- Memory information.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 16:02:44
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_mem.h
+ * @author Paul Ward
+ * @brief Memory information.
+ */
+
+#ifndef _sm_mem_h_
+#define _sm_mem_h_
+
+#include <sys/types.h>
+
+#include "vtable.h"
+
+/*
+ * Figures taken from /proc/meminfo.  Sizes are in bytes; the HugePages
+ * counts are in pages.
+ */
+typedef enum {
+  MEM_TOTAL,
+  MEM_FREE,
+  MEM_AVAILABLE,
+  MEM_BUFFERS,
+  MEM_CACHED,
+  MEM_DIRTY,
+  MEM_WRITEBACK,
+  MEM_SHMEM,
+  MEM_SWAP_TOTAL,
+  MEM_SWAP_FREE,
+  MEM_SWAP_CACHED,
+  MEM_HUGE_TOTAL,
+  MEM_HUGE_FREE,
+  MEM_HUGE_RSVD,
+  MEM_HUGE_SIZE,
+  MEM_SLAB,
+  MEM_SLAB_RECLAIMABLE,
+  MEM_SLAB_UNRECLAIMABLE,
+  MEM_NFIELDS
+} mem_field_t;
+
+typedef struct {
+  sm_vtable_t *vtab;
+  uint64_t     fields[MEM_NFIELDS];
+  time_t       time;                    /* Update time. */
+} sm_mem_t;
+
+void sm_mem_init(void);
+
+#endif /* !_sm_mem_h_ */
+
+/* sm_mem.h ends here. */
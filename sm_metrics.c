@@ -0,0 +1,867 @@
+/*
+ * sm_metrics.c --- Prometheus exposition of all the things.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 14:52:31
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_metrics.c
+ * @author Paul Ward
+ * @brief Prometheus exposition of all the things.
+ *
+ * Every JSON module is flattened into the Prometheus text format as its
+ * `emit_json' writes it; nothing is parsed.  Numbers and booleans become
+ * samples named after their path, so `cpu.numOnline' turns into
+ * `sysmon_cpu_num_online'.  Those that only ever go up are counters, and
+ * end in `_total'.
+ *
+ * Maps keyed by name, such as `net.interfaces', are labelled with the key
+ * instead: `sysmon_net_interfaces_rx_bytes_total{iface="eth0"}'.  Array
+ * elements and map entries are further labelled with their strings and
+ * their identifying numbers, such as a process's `pid'; an element with
+ * none is labelled with its index.  Any other strings of an object are
+ * folded into the labels of a single `_info' gauge.
+ *
+ * The text is only rebuilt on the first request after some module has
+ * regenerated.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_metrics.h"
+#include "endpoints.h"
+#include "utils.h"
+
+#if PLATFORM_LT(PLATFORM_BSD, PLATFORM_BSDOS)
+extern double strtod();
+#endif
+
+/*
+ * Growable text.
+ */
+typedef struct {
+  char   *data;
+  size_t  length;
+  size_t  size;
+} text_t;
+
+/*
+ * What a path in a module's document means to us, beyond a gauge.  Paths
+ * are keys joined by `/', with `*' for an array element or map entry, and
+ * a pattern's `*' matches any one key.
+ */
+typedef enum {
+  RULE_MAP,                             /* Keys are values of `label'. */
+  RULE_LABEL,                           /* Identifies its element. */
+  RULE_INFO,                            /* Does not, so is not a label. */
+  RULE_COUNTER                          /* Only ever goes up. */
+} rule_kind_t;
+
+typedef struct {
+  rule_kind_t  kind;
+  const char  *path;
+  const char  *label;
+} rule_t;
+
+/*
+ * A set of labels: those of `parent', then its own.  An array element with
+ * no labels of its own is told apart by its index instead.
+ */
+typedef struct {
+  int    parent;
+  int    first;                         /* First label, or -1. */
+  int    last;
+  int    index;                         /* Element index, or -1. */
+  size_t key;                           /* Index label name, in `label_text'. */
+  size_t key_length;
+} scope_t;
+
+typedef struct {
+  int    next;                          /* Next of the same scope, or -1. */
+  size_t offset;                        /* `name="value"' in `label_text'. */
+  size_t length;
+} label_t;
+
+/*
+ * An object or array being walked.
+ */
+typedef struct {
+  size_t        name_mark;              /* `name' and `path' outside it. */
+  size_t        path_mark;
+  int           scope;                  /* Labels of what it holds. */
+  int           info;                   /* Scope of its `_info' gauge. */
+  int           index;                  /* Next element of an array. */
+  const rule_t *map;
+  bool          array;
+  bool          entity;                 /* Strings in it are labels. */
+} frame_t;
+
+/*
+ * One sample, kept until the module's samples have been sorted into
+ * families.  Its name and then its value are in `samples_text'; its labels
+ * are those of `scope', which may still be growing.
+ */
+typedef struct {
+  size_t offset;
+  size_t name_length;
+  size_t value_length;
+  int    scope;
+  int    seq;
+  bool   counter;
+} sample_t;
+
+static endpoint_t    *metrics_endpoint = NULL;
+static sm_metrics_t  *metrics_instance = NULL;
+static json_writer_t  metrics_writer;
+
+static text_t         metrics_text     = { NULL, 0, 0 };
+static text_t         samples_text     = { NULL, 0, 0 };
+static text_t         label_text       = { NULL, 0, 0 };
+static text_t         name_text        = { NULL, 0, 0 };
+static text_t         path_text        = { NULL, 0, 0 };
+static sample_t      *samples          = NULL;
+static int            nsamples         = 0;
+static int            max_samples      = 0;
+static scope_t       *scopes           = NULL;
+static int            nscopes          = 0;
+static int            max_scopes       = 0;
+static label_t       *labels           = NULL;
+static int            nlabels          = 0;
+static int            max_labels       = 0;
+static frame_t       *frames           = NULL;
+static int            nframes          = 0;
+static int            max_frames       = 0;
+
+static const char strMetrics[]     = "metrics";
+static const char strAll[]         = "all";
+static const char strPrefix[]      = "sysmon";
+static const char strInfo[]        = "_info";
+static const char strTotal[]       = "_total";
+static const char strIndex[]       = "index";
+static const char strValue[]       = "value";
+static const char strContentType[] =
+  "text/plain; version=0.0.4; charset=utf-8";
+
+static const rule_t rules[] = {
+  { RULE_MAP,     "net/interfaces",                     "iface"      },
+  { RULE_MAP,     "disk/devices",                       "device"     },
+  { RULE_MAP,     "fs/filesystems",                     "mountpoint" },
+  { RULE_MAP,     "cgroup/groups",                      "cgroup"     },
+
+  { RULE_LABEL,   "cpu/cores/*/id",                     NULL         },
+  { RULE_LABEL,   "cpu/caches/*/level",                 NULL         },
+  { RULE_LABEL,   "proc/*/*/pid",                       NULL         },
+  { RULE_LABEL,   "sock/listeners/*/port",              NULL         },
+  { RULE_LABEL,   "irq/*/topCpus/*/cpu",                NULL         },
+
+  { RULE_INFO,    "proc/*/*/state",                     NULL         },
+
+  { RULE_COUNTER, "net/interfaces/*/*/bytes",           NULL         },
+  { RULE_COUNTER, "net/interfaces/*/*/packets",         NULL         },
+  { RULE_COUNTER, "net/interfaces/*/*/errors",          NULL         },
+  { RULE_COUNTER, "net/interfaces/*/*/drops",           NULL         },
+  { RULE_COUNTER, "disk/devices/*/reads",               NULL         },
+  { RULE_COUNTER, "disk/devices/*/writes",              NULL         },
+  { RULE_COUNTER, "disk/devices/*/readBytes",           NULL         },
+  { RULE_COUNTER, "disk/devices/*/writtenBytes",        NULL         },
+  { RULE_COUNTER, "cgroup/groups/*/cpu/usageUsec",      NULL         },
+  { RULE_COUNTER, "cgroup/groups/*/cpu/userUsec",       NULL         },
+  { RULE_COUNTER, "cgroup/groups/*/cpu/systemUsec",     NULL         },
+  { RULE_COUNTER, "cgroup/groups/*/cpu/nrThrottled",    NULL         },
+  { RULE_COUNTER, "cgroup/groups/*/cpu/throttledUsec",  NULL         },
+  { RULE_COUNTER, "cgroup/groups/*/memory/majorFaults", NULL         },
+  { RULE_COUNTER, "cgroup/groups/*/io/*",               NULL         },
+  { RULE_COUNTER, "load/pressure/*/*/total",            NULL         },
+  { RULE_COUNTER, "load/pressure/*/events",             NULL         },
+  { RULE_COUNTER, "sock/listenOverflows",               NULL         },
+  { RULE_COUNTER, "sock/listenDrops",                   NULL         }
+};
+
+#define NRULES (sizeof(rules) / sizeof(rules[0]))
+
+/* {{{ Text buffers: */
+
+static
+void
+text_put(text_t *text, const char *str, size_t len)
+{
+  if (text->length + len + 1 > text->size) {
+    while (text->length + len + 1 > text->size) {
+      text->size = text->size ? text->size * 2 : 1024;
+    }
+
+    text->data = xrealloc(text->data, text->size);
+  }
+
+  memcpy(text->data + text->length, str, len);
+  text->length             += len;
+  text->data[text->length]  = '\0';
+}
+
+static
+void
+text_puts(text_t *text, const char *str)
+{
+  text_put(text, str, strlen(str));
+}
+
+/*
+ * Append `str' as part of a metric or label name: camelCase becomes
+ * snake_case and anything Prometheus does not allow becomes `_'.
+ */
+static
+void
+text_put_name(text_t *text, const char *str)
+{
+  char prev = '\0';
+  char c    = '\0';
+
+  for (; *str != '\0'; str++) {
+    c = *str;
+
+    if (isupper((unsigned char)c)) {
+      if (islower((unsigned char)prev) || isdigit((unsigned char)prev)) {
+        text_put(text, "_", 1);
+      }
+
+      c = (char)tolower((unsigned char)c);
+    } else if (!isalnum((unsigned char)c)) {
+      c = '_';
+    }
+
+    text_put(text, &c, 1);
+    prev = *str;
+  }
+}
+
+/*
+ * Append `str' as a quoted label value.
+ */
+static
+void
+text_put_label_value(text_t *text, const char *str)
+{
+  text_put(text, "\"", 1);
+
+  for (; *str != '\0'; str++) {
+    switch (*str) {
+      case '\\': text_put(text, "\\\\", 2); break;
+      case '"':  text_put(text, "\\\"", 2); break;
+      case '\n': text_put(text, "\\n", 2);  break;
+      default:   text_put(text, str, 1);    break;
+    }
+  }
+
+  text_put(text, "\"", 1);
+}
+
+/* }}} */
+/* {{{ Rules: */
+
+/*
+ * Does `path' match `pattern'?
+ */
+static
+bool
+path_match(const char *pattern, const char *path)
+{
+  size_t plen = 0;
+  size_t len  = 0;
+
+  for (;;) {
+    plen = strcspn(pattern, "/");
+    len  = strcspn(path, "/");
+
+    if (!(plen == 1 && *pattern == '*') &&
+        (plen != len || memcmp(pattern, path, len) != 0))
+    {
+      return false;
+    }
+
+    pattern += plen;
+    path    += len;
+
+    if (*pattern == '\0' || *path == '\0') {
+      return (*pattern == '\0' && *path == '\0');
+    }
+
+    pattern++;
+    path++;
+  }
+}
+
+static
+const rule_t *
+find_rule(rule_kind_t kind, const char *path)
+{
+  size_t i = 0;
+
+  for (i = 0; i < NRULES; i++) {
+    if (rules[i].kind == kind && path_match(rules[i].path, path)) {
+      return &rules[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* }}} */
+/* {{{ Labels: */
+
+static
+int
+add_scope(int parent, int index, const char *key)
+{
+  scope_t *scope = NULL;
+
+  if (nscopes == max_scopes) {
+    max_scopes = max_scopes ? max_scopes * 2 : 64;
+    scopes     = xrealloc(scopes, max_scopes * sizeof(scope_t));
+  }
+
+  scope             = &scopes[nscopes];
+  scope->parent     = parent;
+  scope->first      = -1;
+  scope->last       = -1;
+  scope->index      = index;
+  scope->key        = label_text.length;
+
+  text_put_name(&label_text, key);
+  scope->key_length = label_text.length - scope->key;
+
+  return nscopes++;
+}
+
+static
+void
+add_label(int scope, const char *key, const char *value)
+{
+  label_t *label = NULL;
+
+  if (nlabels == max_labels) {
+    max_labels = max_labels ? max_labels * 2 : 64;
+    labels     = xrealloc(labels, max_labels * sizeof(label_t));
+  }
+
+  label         = &labels[nlabels];
+  label->next   = -1;
+  label->offset = label_text.length;
+
+  text_put_name(&label_text, key);
+  text_put(&label_text, "=", 1);
+  text_put_label_value(&label_text, value);
+
+  label->length = label_text.length - label->offset;
+
+  if (scopes[scope].first < 0) {
+    scopes[scope].first = nlabels;
+  } else {
+    labels[scopes[scope].last].next = nlabels;
+  }
+
+  scopes[scope].last = nlabels++;
+}
+
+static
+void
+put_label(text_t *out, bool *first, const char *str, size_t len)
+{
+  if (!*first) {
+    text_put(out, ",", 1);
+  }
+
+  text_put(out, str, len);
+  *first = false;
+}
+
+static
+void
+put_labels(text_t *out, int scope, bool *first)
+{
+  const scope_t *s       = NULL;
+  char           buf[32] = {0};
+  int            i       = 0;
+
+  if (scope < 0) {
+    return;
+  }
+
+  s = &scopes[scope];
+  put_labels(out, s->parent, first);
+
+  if (s->first < 0 && s->index >= 0) {
+    put_label(out, first, label_text.data + s->key, s->key_length);
+    snprintf(buf, sizeof(buf), "=\"%d\"", s->index);
+    text_puts(out, buf);
+  }
+
+  for (i = s->first; i >= 0; i = labels[i].next) {
+    put_label(out, first, label_text.data + labels[i].offset, labels[i].length);
+  }
+}
+
+/* }}} */
+/* {{{ Samples: */
+
+/*
+ * Format a number or boolean; returns false for anything else.
+ */
+static
+bool
+format_value(char *buf, size_t len, const json_event_t *event)
+{
+  switch (event->tag) {
+    case JSON_BOOL:
+      snprintf(buf, len, "%d", event->_u._bool ? 1 : 0);
+      return true;
+
+    case JSON_INT64:
+      snprintf(buf, len, "%lld", (long long)event->_u._int64);
+      return true;
+
+    case JSON_UINT64:
+      snprintf(buf, len, "%llu", (unsigned long long)event->_u._uint64);
+      return true;
+
+    case JSON_NUMBER:
+      snprintf(buf, len, "%.15g", event->_u._number);
+
+      if (strtod(buf, NULL) != event->_u._number) {
+        snprintf(buf, len, "%.17g", event->_u._number);
+      }
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+/*
+ * Record `<name><suffix>{<labels of scope>} <value>'.  Counters are named
+ * with a `_total' suffix.
+ */
+static
+void
+add_sample(const char *suffix, int scope, const char *value, bool counter)
+{
+  sample_t *sample = NULL;
+  size_t    len    = sizeof(strTotal) - 1;
+
+  if (nsamples == max_samples) {
+    max_samples = max_samples ? max_samples * 2 : 64;
+    samples     = xrealloc(samples, max_samples * sizeof(sample_t));
+  }
+
+  sample          = &samples[nsamples];
+  sample->seq     = nsamples++;
+  sample->scope   = scope;
+  sample->counter = counter;
+  sample->offset  = samples_text.length;
+
+  text_put(&samples_text, name_text.data, name_text.length);
+  text_puts(&samples_text, suffix);
+
+  if (counter &&
+      (samples_text.length - sample->offset < len ||
+       strcmp(samples_text.data + samples_text.length - len, strTotal) != 0))
+  {
+    text_puts(&samples_text, strTotal);
+  }
+
+  sample->name_length  = samples_text.length - sample->offset;
+
+  text_puts(&samples_text, value);
+  sample->value_length = strlen(value);
+}
+
+static
+int
+sample_cmp(const void *a, const void *b)
+{
+  const sample_t *sa  = (const sample_t *)a;
+  const sample_t *sb  = (const sample_t *)b;
+  size_t          len = MIN(sa->name_length, sb->name_length);
+  int             ret = 0;
+
+  ret = memcmp(samples_text.data + sa->offset,
+               samples_text.data + sb->offset,
+               len);
+
+  if (ret == 0 && sa->name_length != sb->name_length) {
+    ret = (sa->name_length < sb->name_length) ? -1 : 1;
+  }
+
+  if (ret == 0) {
+    ret = sa->seq - sb->seq;
+  }
+
+  return ret;
+}
+
+/*
+ * Sort the recorded samples into families, write them out with a TYPE line
+ * heading each family, and forget them.
+ */
+static
+void
+flush_samples(text_t *out)
+{
+  const sample_t *prev  = NULL;
+  const sample_t *cur   = NULL;
+  size_t          mark  = 0;
+  bool            first = true;
+  int             i     = 0;
+
+  qsort(samples, nsamples, sizeof(sample_t), &sample_cmp);
+
+  for (i = 0; i < nsamples; i++) {
+    cur = &samples[i];
+
+    if (prev == NULL                           ||
+        prev->name_length != cur->name_length  ||
+        memcmp(samples_text.data + prev->offset,
+               samples_text.data + cur->offset,
+               cur->name_length) != 0)
+    {
+      text_puts(out, "# TYPE ");
+      text_put(out, samples_text.data + cur->offset, cur->name_length);
+      text_puts(out, cur->counter ? " counter\n" : " gauge\n");
+    }
+
+    text_put(out, samples_text.data + cur->offset, cur->name_length);
+
+    mark  = out->length;
+    first = true;
+
+    text_put(out, "{", 1);
+    put_labels(out, cur->scope, &first);
+
+    if (first) {
+      out->length = mark;
+    } else {
+      text_put(out, "}", 1);
+    }
+
+    text_put(out, " ", 1);
+    text_put(out,
+             samples_text.data + cur->offset + cur->name_length,
+             cur->value_length);
+    text_put(out, "\n", 1);
+
+    prev = cur;
+  }
+
+  nsamples            = 0;
+  nscopes             = 0;
+  nlabels             = 0;
+  samples_text.length = 0;
+  label_text.length   = 0;
+}
+
+/* }}} */
+/* {{{ Walking: */
+
+/*
+ * Extend `name' and `path' for a value arriving in `top' under `key'.
+ * Elements and map entries are not named; map entries are labelled
+ * instead.
+ */
+static
+void
+enter(const frame_t *top, const char *key)
+{
+  if (top == NULL) {
+    return;
+  }
+
+  text_put(&path_text, "/", 1);
+
+  if (top->array || top->map != NULL) {
+    text_put(&path_text, "*", 1);
+    return;
+  }
+
+  text_puts(&path_text, key);
+  text_put(&name_text, "_", 1);
+  text_put_name(&name_text, key);
+}
+
+/*
+ * The scope of a value arriving in `top' under `key': an element or map
+ * entry gets a scope of its own.
+ */
+static
+int
+value_scope(frame_t *top, const char *key)
+{
+  const char *label = strIndex;
+  int         scope = -1;
+
+  if (top == NULL) {
+    return -1;
+  }
+
+  if (top->map != NULL) {
+    scope = add_scope(top->scope, -1, top->map->label);
+    add_label(scope, top->map->label, key);
+    return scope;
+  }
+
+  if (top->array) {
+    /* Named after the array, should the array have a name. */
+    if (top->path_mark < path_text.length) {
+      label = strrchr(path_text.data, '/');
+      label = (label != NULL) ? label + 1 : path_text.data;
+      label = (*label == '*') ? strIndex : label;
+    }
+
+    return add_scope(top->scope, top->index++, label);
+  }
+
+  return top->scope;
+}
+
+/*
+ * A string that is not a label goes into an `_info' gauge of its object.
+ */
+static
+void
+add_info(frame_t *top, const char *key, const char *value)
+{
+  if (top->info < 0) {
+    top->info = add_scope(top->scope, -1, strInfo);
+    add_sample(strInfo, top->info, "1", false);
+  }
+
+  add_label(top->info, key, value);
+}
+
+static
+void
+metrics_value(frame_t *top, const json_event_t *event)
+{
+  char        buf[32] = {0};
+  const char *key     = (event->key != NULL) ? event->key : strValue;
+  size_t      name    = name_text.length;
+  int         scope   = 0;
+
+  if (event->tag == JSON_NULL || top == NULL) {
+    return;
+  }
+
+  if (event->tag == JSON_STRING) {
+    if (top->array || top->map != NULL) {
+      scope = value_scope(top, key);
+      add_label(scope, strValue, event->_u._string);
+      add_sample(strInfo, scope, "1", false);
+      return;
+    }
+
+    enter(top, key);
+    name_text.length = name;
+
+    /* A string in an element or map entry says which one it is. */
+    if (top->entity && find_rule(RULE_INFO, path_text.data) == NULL) {
+      add_label(top->scope, key, event->_u._string);
+    } else {
+      add_info(top, key, event->_u._string);
+    }
+    return;
+  }
+
+  if (!format_value(buf, sizeof(buf), event)) {
+    return;
+  }
+
+  scope = value_scope(top, key);
+  enter(top, key);
+
+  if (top->entity && !top->array && top->map == NULL &&
+      find_rule(RULE_LABEL, path_text.data) != NULL)
+  {
+    add_label(top->scope, key, buf);
+  } else {
+    add_sample("", scope, buf, find_rule(RULE_COUNTER, path_text.data) != NULL);
+  }
+}
+
+/*
+ * Sink for a module's document, turning it into samples as it is written.
+ */
+static
+void
+metrics_event(void *data, const json_event_t *event)
+{
+  frame_t *top   = (nframes > 0) ? &frames[nframes - 1] : NULL;
+  frame_t *frame = NULL;
+  size_t   name  = name_text.length;
+  size_t   path  = path_text.length;
+
+  (void)data;
+
+  switch (event->kind) {
+    case JSON_EVENT_BEGIN_OBJECT:
+    case JSON_EVENT_BEGIN_ARRAY:
+      if (nframes == max_frames) {
+        max_frames = max_frames ? max_frames * 2 : 16;
+        frames     = xrealloc(frames, max_frames * sizeof(frame_t));
+        top        = (nframes > 0) ? &frames[nframes - 1] : NULL;
+      }
+
+      frame            = &frames[nframes];
+      frame->name_mark = name;
+      frame->path_mark = path;
+      frame->scope     = value_scope(top, event->key);
+      frame->entity    = (top != NULL && (top->array || top->map != NULL));
+      frame->info      = -1;
+      frame->index     = 0;
+      frame->array     = (event->kind == JSON_EVENT_BEGIN_ARRAY);
+
+      enter(top, event->key);
+
+      frame->map = frame->array ? NULL : find_rule(RULE_MAP, path_text.data);
+      nframes++;
+      return;
+
+    case JSON_EVENT_END_OBJECT:
+    case JSON_EVENT_END_ARRAY:
+      nframes--;
+      name_text.length = frames[nframes].name_mark;
+      path_text.length = frames[nframes].path_mark;
+      break;
+
+    default:
+      metrics_value(top, event);
+      name_text.length = name;
+      path_text.length = path;
+      break;
+  }
+
+  if (name_text.data != NULL) {
+    name_text.data[name_text.length] = '\0';
+    path_text.data[path_text.length] = '\0';
+  }
+}
+
+/* }}} */
+
+static
+void
+get_metrics(void *ptr)
+{
+  endpoint_t        *node = NULL;
+  extern endpoint_t *endpoints;
+
+  metrics_text.length = 0;
+  text_puts(&metrics_text, "");
+
+  endpoint_foreach(node) {
+    sm_base_t *inst = (sm_base_t *)node->instance;
+
+    /* Not JSON, or -- in the case of `/all' -- nothing new. */
+    if (inst->vtab->content_type != NULL  ||
+        inst->vtab->json_buffer  == NULL  ||
+        inst->vtab->emit_json    == NULL  ||
+        strcmp(node->name, strAll) == 0)
+    {
+      continue;
+    }
+
+    name_text.length = 0;
+    path_text.length = 0;
+    nframes          = 0;
+
+    text_puts(&name_text, strPrefix);
+    text_put(&name_text, "_", 1);
+    text_put_name(&name_text, node->name);
+    text_puts(&path_text, node->name);
+
+    json_writer_reset(&metrics_writer);
+    (inst->vtab->emit_json)(&metrics_writer);
+
+    flush_samples(&metrics_text);
+  }
+
+  metrics_instance->vtab->json_buffer = metrics_text.data;
+  metrics_instance->vtab->json_length = metrics_text.length;
+}
+
+void
+sm_metrics_init(void)
+{
+  if (metrics_instance == NULL) {
+    metrics_instance       = xmalloc(sizeof(sm_metrics_t));
+    metrics_instance->vtab = xmalloc(sizeof(sm_vtable_t));
+
+    MAKE_VTABLE(metrics_instance, &get_metrics, NULL, 0);
+
+    metrics_instance->vtab->content_type = strContentType;
+
+    json_writer_init(&metrics_writer);
+    json_writer_set_sink(&metrics_writer, &metrics_event, NULL);
+  }
+
+  if (metrics_endpoint == NULL) {
+    metrics_endpoint = endpoint_create(strMetrics, metrics_instance);
+  }
+}
+
+/*
+ * Some module has regenerated; rebuild on the next request.
+ */
+void
+sm_metrics_update(sm_base_t *endpoint)
+{
+  if (metrics_instance == NULL                      ||
+      endpoint         == (sm_base_t *)metrics_instance)
+  {
+    return;
+  }
+
+  metrics_instance->vtab->json_buffer = NULL;
+  metrics_instance->vtab->json_length = 0;
+}
+
+/* sm_metrics.c ends here. */
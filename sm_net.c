@@ -0,0 +1,494 @@
+/*
+ * sm_net.c --- Network interface statistics.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 16:58:47
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_net.c
+ * @author Paul Ward
+ * @brief Network interface statistics.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <net/if.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_net.h"
+#include "endpoints.h"
+#include "timers.h"
+#include "utils.h"
+#include "procfs.h"
+
+static endpoint_t        *net_endpoint    = NULL;
+static sm_net_t          *net_instance    = NULL;
+static timer_task_t      *net_timer_task  = NULL;
+static json_template_t    net_template;
+static int                net_template_ok = 0;
+static json_hole_value_t *net_values      = NULL;
+static int                net_max_values  = 0;
+static struct timeval     net_last;         /* When the last sample was taken. */
+
+static const char strName[]         = "net";
+static const char strUpdated[]      = "updatedAt";
+static const char strInterfaces[]   = "interfaces";
+static const char strIndex[]        = "index";
+static const char strRx[]           = "rx";
+static const char strTx[]           = "tx";
+static const char strIfaceParam[]   = "iface";
+static const char strIfaceRoute[]   = "net/:iface";
+static const char strDirParam[]     = "dir";
+static const char strDirRoute[]     = "net/:iface/:dir";
+
+/*
+ * Keys for the counters of one direction, and for their rates.
+ */
+static const char *count_names[NET_NCOUNTERS / 2] = {
+  "bytes",
+  "packets",
+  "errors",
+  "drops"
+};
+
+static const char *rate_names[NET_NCOUNTERS / 2] = {
+  "bytesPerSec",
+  "packetsPerSec",
+  "errorsPerSec",
+  "dropsPerSec"
+};
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static const char strProcNetDev[]   = "/proc/net/dev";
+
+/*
+ * Column of /proc/net/dev holding each of `net_counter_t'.
+ */
+static const int net_columns[NET_NCOUNTERS] = { 0, 1, 2, 3, 8, 9, 10, 11 };
+
+#define NET_NCOLUMNS 16
+
+static procfs_file_t netdev_file;
+#endif
+
+static
+void
+net_table_grow(net_table_t *tab, int slots)
+{
+  int i = 0;
+
+  if (slots <= tab->size) {
+    return;
+  }
+
+  tab->name  = xrealloc(tab->name, slots * sizeof(*tab->name));
+  tab->index = xrealloc(tab->index, slots * sizeof(unsigned));
+
+  for (i = 0; i < NET_NCOUNTERS; i++) {
+    tab->value[i] = xrealloc(tab->value[i], slots * sizeof(uint64_t));
+    tab->prev[i]  = xrealloc(tab->prev[i], slots * sizeof(uint64_t));
+    tab->rate[i]  = xrealloc(tab->rate[i], slots * sizeof(double));
+  }
+
+  for (i = tab->size; i < slots; i++) {
+    tab->name[i][0] = '\0';
+  }
+
+  tab->size = slots;
+}
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+/*
+ * Read the counters of each interface into its slot.  An interface that
+ * turns up in a slot for the first time starts with its rates at zero.
+ */
+static
+void
+parse_netdev(net_table_t *tab)
+{
+  procfs_scan_t scan;
+  procfs_scan_t line;
+  procfs_scan_t name;
+  uint64_t      cols[NET_NCOLUMNS];
+  bool          fresh = false;
+  int           slot  = 0;
+  int           i     = 0;
+
+  procfs_scan_file(&scan, &netdev_file);
+
+  /* Two lines of headings. */
+  procfs_next_line(&scan, &line);
+  procfs_next_line(&scan, &line);
+
+  while (procfs_next_line(&scan, &line)) {
+    if (!procfs_split(&line, ':', &name)) {
+      continue;
+    }
+
+    procfs_trim(&name);
+
+    for (i = 0; i < NET_NCOLUMNS; i++) {
+      cols[i] = procfs_u64(&line);
+    }
+
+    net_table_grow(tab, slot + 1);
+
+    fresh = slot >= tab->count || !procfs_equal(&name, tab->name[slot]);
+
+    if (fresh) {
+      procfs_copy(&name, tab->name[slot], IFNAMSIZ);
+      tab->index[slot] = if_nametoindex(tab->name[slot]);
+      tab->changed     = true;
+    }
+
+    for (i = 0; i < NET_NCOUNTERS; i++) {
+      tab->value[i][slot] = cols[net_columns[i]];
+
+      if (fresh) {
+        tab->prev[i][slot] = tab->value[i][slot];
+      }
+    }
+
+    slot++;
+  }
+
+  if (slot != tab->count) {
+    tab->changed = true;
+  }
+
+  tab->count = slot;
+}
+#endif
+
+/*
+ * Turn the change in each counter into a rate over `secs' seconds, to two
+ * decimal places.
+ */
+static
+void
+net_table_rates(net_table_t *tab, double secs)
+{
+  uint64_t *cur  = NULL;
+  uint64_t *prev = NULL;
+  double   *rate = NULL;
+  int       slot = 0;
+  int       i    = 0;
+
+  for (i = 0; i < NET_NCOUNTERS; i++) {
+    cur  = tab->value[i];
+    prev = tab->prev[i];
+    rate = tab->rate[i];
+
+    for (slot = 0; slot < tab->count; slot++) {
+      rate[slot] = secs > 0 && cur[slot] >= prev[slot]
+        ? round2((double)(cur[slot] - prev[slot]) / secs)
+        : 0.0;
+      prev[slot] = cur[slot];
+    }
+  }
+}
+
+static
+int
+net_table_find(const net_table_t *tab, const char *name, size_t len)
+{
+  int slot = 0;
+
+  for (slot = 0; slot < tab->count; slot++) {
+    if (strlen(tab->name[slot]) == len &&
+        memcmp(tab->name[slot], name, len) == 0)
+    {
+      return slot;
+    }
+  }
+
+  return -1;
+}
+
+void
+get_net(void *data)
+{
+  sm_net_t       *ptr  = (sm_net_t *)data;
+  struct timeval  now;
+  double          secs = 0.0;
+
+  gettimeofday(&now, NULL);
+
+  secs = elapsed_secs(&net_last, &now);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+  if (procfs_read(&netdev_file) > 0) {
+    parse_netdev(&ptr->table);
+    net_table_rates(&ptr->table, secs);
+  }
+#endif
+
+  if (ptr->table.changed && net_template_ok) {
+    json_template_free(&net_template);
+    net_template_ok = 0;
+  }
+
+  ptr->table.changed = false;
+  ptr->time          = now.tv_sec;
+  net_last           = now;
+}
+
+void
+net_timer(timer_clientdata_t data, struct timeval *now)
+{
+#ifdef DEBUG
+  printf("TIMER FIRE - Updating network\n");
+#endif
+
+  generate_json((sm_base_t *)net_instance);
+}
+
+/*
+ * One direction of one interface: its counters, then their rates.  With
+ * a template, holes are made instead of values being written.
+ */
+static
+void
+write_direction(json_writer_t     *w,
+                json_template_t   *tpl,
+                const net_table_t *tab,
+                int                slot,
+                int                first)
+{
+  int i = 0;
+
+  json_write_begin_object(w);
+
+  for (i = 0; i < NET_NCOUNTERS / 2; i++) {
+    json_write_key(w, count_names[i]);
+
+    if (tpl != NULL) {
+      json_template_hole(tpl, JSON_HOLE_UINT64);
+    } else {
+      json_write_uint64(w, tab->value[first + i][slot]);
+    }
+  }
+
+  for (i = 0; i < NET_NCOUNTERS / 2; i++) {
+    json_write_key(w, rate_names[i]);
+
+    if (tpl != NULL) {
+      json_template_hole(tpl, JSON_HOLE_NUMBER);
+    } else {
+      json_write_number(w, tab->rate[first + i][slot]);
+    }
+  }
+
+  json_write_end_object(w);
+}
+
+static
+void
+write_iface(json_writer_t     *w,
+            json_template_t   *tpl,
+            const net_table_t *tab,
+            int                slot)
+{
+  json_write_begin_object(w);
+  json_write_key(w, strIndex);
+  json_write_uint64(w, tab->index[slot]);
+  json_write_key(w, strRx);
+  write_direction(w, tpl, tab, slot, NET_RX_BYTES);
+  json_write_key(w, strTx);
+  write_direction(w, tpl, tab, slot, NET_TX_BYTES);
+  json_write_end_object(w);
+}
+
+/*
+ * The document only changes shape when interfaces come or go.
+ */
+static
+void
+make_net_template(void)
+{
+  json_template_t *tpl  = &net_template;
+  json_writer_t   *w    = &tpl->writer;
+  net_table_t     *tab  = &net_instance->table;
+  int              slot = 0;
+
+  json_template_init(tpl);
+
+  json_write_begin_object(w);
+
+  json_write_key(w, strUpdated);
+  json_template_hole(tpl, JSON_HOLE_INT64);
+
+  json_write_key(w, strInterfaces);
+  json_write_begin_object(w);
+
+  for (slot = 0; slot < tab->count; slot++) {
+    json_write_key(w, tab->name[slot]);
+    write_iface(w, tpl, tab, slot);
+  }
+
+  json_write_end_object(w);
+
+  json_write_end_object(w);
+
+  json_template_finish(tpl);
+  net_template_ok = 1;
+
+  if (tpl->nholes > net_max_values) {
+    net_max_values = tpl->nholes;
+    net_values     = xrealloc(net_values,
+                              net_max_values * sizeof(json_hole_value_t));
+  }
+}
+
+void
+emit_net(json_writer_t *out)
+{
+  net_table_t *tab  = &net_instance->table;
+  int          hole = 0;
+  int          slot = 0;
+  int          dir  = 0;
+  int          i    = 0;
+
+  if (!net_template_ok) {
+    make_net_template();
+  }
+
+  net_values[hole++]._int64 = net_instance->time;
+
+  /* Same order as `write_iface'. */
+  for (slot = 0; slot < tab->count; slot++) {
+    for (dir = NET_RX_BYTES; dir < NET_NCOUNTERS; dir += NET_NCOUNTERS / 2) {
+      for (i = dir; i < dir + NET_NCOUNTERS / 2; i++) {
+        net_values[hole++]._uint64 = tab->value[i][slot];
+      }
+
+      for (i = dir; i < dir + NET_NCOUNTERS / 2; i++) {
+        net_values[hole++]._number = tab->rate[i][slot];
+      }
+    }
+  }
+
+  json_template_render(&net_template, out, net_values);
+}
+
+/*
+ * `net/:iface' -- one interface -- and `net/:iface/:dir', one direction of it.
+ */
+static
+bool
+serve_net(void *data, const route_match_t *match, json_writer_t *out)
+{
+  sm_net_t            *ptr   = (sm_net_t *)data;
+  const route_param_t *param = route_param(match, strIfaceParam);
+  const route_param_t *dir   = route_param(match, strDirParam);
+  int                  slot  = 0;
+
+  if (param == NULL) {
+    return false;
+  }
+
+  slot = net_table_find(&ptr->table, param->value, param->length);
+
+  if (slot < 0) {
+    return false;
+  }
+
+  if (dir == NULL) {
+    write_iface(out, NULL, &ptr->table, slot);
+  } else if (dir->length == 2 && memcmp(dir->value, strRx, 2) == 0) {
+    write_direction(out, NULL, &ptr->table, slot, NET_RX_BYTES);
+  } else if (dir->length == 2 && memcmp(dir->value, strTx, 2) == 0) {
+    write_direction(out, NULL, &ptr->table, slot, NET_TX_BYTES);
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+void
+sm_net_init(void)
+{
+  if (net_instance == NULL) {
+    net_instance       = xcalloc(1, sizeof(sm_net_t));
+    net_instance->vtab = xmalloc(sizeof(sm_vtable_t));
+
+    MAKE_VTABLE(net_instance, &get_net, &emit_net, 0);
+    net_instance->vtab->serve = &serve_net;
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+    if (!procfs_open(&netdev_file, strProcNetDev, 4096)) {
+      syslog(LOG_ERR,
+             "Could not open %s: %s",
+             strProcNetDev,
+             strerror(errno));
+    }
+#endif
+
+    generate_json((sm_base_t *)net_instance);
+  }
+
+  if (net_endpoint == NULL) {
+    net_endpoint = endpoint_create(strName, net_instance);
+    endpoint_add_route(net_endpoint, strIfaceRoute);
+    endpoint_add_route(net_endpoint, strDirRoute);
+  }
+
+  if (net_timer_task == NULL) {
+    timer_clientdata_t data;
+
+    data.l = 0;
+    net_timer_task = tmr_create(NULL,
+                                &net_timer,
+                                data,
+                                1000,
+                                1);
+  }
+}
+
+/* sm_net.c ends here. */
@@ -0,0 +1,97 @@
+/*
+ * sm_net.h --- Network interface statistics.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 16:58:40
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_net.h
+ * @author Paul Ward
+ * @brief Network interface statistics.
+ */
+
+#ifndef _sm_net_h_
+#define _sm_net_h_
+
+#include <sys/types.h>
+#include <net/if.h>
+
+#include "vtable.h"
+
+/*
+ * Counters kept for each interface; receive first, then transmit.
+ */
+typedef enum {
+  NET_RX_BYTES,
+  NET_RX_PACKETS,
+  NET_RX_ERRORS,
+  NET_RX_DROPS,
+  NET_TX_BYTES,
+  NET_TX_PACKETS,
+  NET_TX_ERRORS,
+  NET_TX_DROPS,
+  NET_NCOUNTERS
+} net_counter_t;
+
+/*
+ * Interfaces as a structure of arrays, in /proc/net/dev order.  A slot
+ * keeps its interface for as long as the kernel lists it in the same
+ * place, so nothing is looked up again from one sample to the next.
+ */
+typedef struct {
+  int       count;                      /* Slots in use. */
+  int       size;                       /* Slots allocated. */
+  bool      changed;                    /* Interfaces differ from last time. */
+  char    (*name)[IFNAMSIZ];
+  unsigned *index;                      /* Interface index. */
+  uint64_t *value[NET_NCOUNTERS];       /* Latest counters. */
+  uint64_t *prev[NET_NCOUNTERS];        /* Counters at the previous sample. */
+  double   *rate[NET_NCOUNTERS];        /* Per second between the two. */
+} net_table_t;
+
+typedef struct {
+  sm_vtable_t *vtab;
+  net_table_t  table;
+  time_t       time;                    /* Update time. */
+} sm_net_t;
+
+void sm_net_init(void);
+
+#endif /* !_sm_net_h_ */
+
+/* sm_net.h ends here. */
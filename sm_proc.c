@@ -0,0 +1,778 @@
+/*
+ * sm_proc.c --- Process table.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 18:10:44
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_proc.c
+ * @author Paul Ward
+ * @brief Process table.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+# include <sys/syscall.h>
+# include <pthread.h>
+#endif
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_proc.h"
+#include "endpoints.h"
+#include "timers.h"
+#include "utils.h"
+#include "procfs.h"
+
+/*
+ * Scans of at least PROC_WORKER_MIN processes are shared out between up to
+ * PROC_MAX_WORKERS threads.
+ */
+#ifndef PROC_WORKER_MIN
+# define PROC_WORKER_MIN   20000
+#endif
+
+#ifndef PROC_MAX_WORKERS
+# define PROC_MAX_WORKERS  8
+#endif
+
+/*
+ * An entry in a top list.
+ */
+typedef struct {
+  int    sample;
+  double key;
+} proc_top_t;
+
+static endpoint_t     *proc_endpoint   = NULL;
+static sm_proc_t      *proc_instance   = NULL;
+static timer_task_t   *proc_timer_task = NULL;
+static proc_table_t    proc_prev;           /* The scan before the latest. */
+static struct timeval  proc_last;
+static long            proc_hz         = 100;
+
+static const char strName[]         = "proc";
+static const char strUpdated[]      = "updatedAt";
+static const char strCount[]        = "count";
+static const char strRunning[]      = "running";
+static const char strThreads[]      = "threads";
+static const char strTopCpu[]       = "topCpu";
+static const char strTopRss[]       = "topRss";
+static const char strPid[]          = "pid";
+static const char strPName[]        = "name";
+static const char strState[]        = "state";
+static const char strCpu[]          = "cpu";
+static const char strRss[]          = "rss";
+static const char strReadRate[]     = "readBytesPerSec";
+static const char strWriteRate[]    = "writeBytesPerSec";
+static const char strPidParam[]     = "pid";
+static const char strPidRoute[]     = "proc/:pid";
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static const char strProc[]         = "/proc";
+
+/*
+ * What getdents64(2) fills its buffer with.
+ */
+typedef struct {
+  uint64_t       d_ino;
+  int64_t        d_off;
+  unsigned short d_reclen;
+  unsigned char  d_type;
+  char           d_name[];
+} proc_dirent_t;
+
+/*
+ * A share of one scan.
+ */
+typedef struct {
+  proc_sample_t *samples;
+  int            first;
+  int            last;
+} proc_work_t;
+
+static int      proc_dirfd    = -1;
+static char     proc_dents[65536];
+static long     proc_page     = 4096;
+static int      proc_workers  = 1;
+#endif
+
+/* {{{ PID table: */
+
+static
+unsigned
+pid_hash(pid_t pid)
+{
+  return (unsigned)pid * 2654435761u;
+}
+
+static
+void
+proc_table_reserve(proc_table_t *tab, int count)
+{
+  if (count > tab->size) {
+    tab->size    = count + count / 2;
+    tab->samples = xrealloc(tab->samples, tab->size * sizeof(proc_sample_t));
+  }
+}
+
+/*
+ * Index the samples by PID, keeping the index at most half full.
+ */
+static
+void
+proc_table_index(proc_table_t *tab)
+{
+  unsigned size = 64;
+  unsigned h    = 0;
+  int      i    = 0;
+
+  while (size < (unsigned)tab->count * 2) {
+    size *= 2;
+  }
+
+  if (size - 1 != tab->mask || tab->index == NULL) {
+    tab->index = xrealloc(tab->index, size * sizeof(int));
+    tab->mask  = size - 1;
+  }
+
+  memset(tab->index, -1, size * sizeof(int));
+
+  for (i = 0; i < tab->count; i++) {
+    h = pid_hash(tab->samples[i].pid) & tab->mask;
+
+    while (tab->index[h] >= 0) {
+      h = (h + 1) & tab->mask;
+    }
+
+    tab->index[h] = i;
+  }
+}
+
+static
+proc_sample_t *
+proc_table_find(const proc_table_t *tab, pid_t pid)
+{
+  unsigned h = 0;
+
+  if (tab->index == NULL) {
+    return NULL;
+  }
+
+  h = pid_hash(pid) & tab->mask;
+
+  while (tab->index[h] >= 0) {
+    if (tab->samples[tab->index[h]].pid == pid) {
+      return &tab->samples[tab->index[h]];
+    }
+
+    h = (h + 1) & tab->mask;
+  }
+
+  return NULL;
+}
+
+/* }}} */
+/* {{{ Top lists: */
+
+/*
+ * Offer a sample to a bounded min-heap holding the PROC_TOP_N largest
+ * keys seen so far.
+ */
+static
+void
+top_offer(proc_top_t *heap, int *n, int sample, double key)
+{
+  proc_top_t tmp;
+  int        i     = 0;
+  int        child = 0;
+
+  if (*n < PROC_TOP_N) {
+    i = (*n)++;
+    heap[i].sample = sample;
+    heap[i].key    = key;
+
+    while (i > 0 && heap[(i - 1) / 2].key > heap[i].key) {
+      tmp                = heap[i];
+      heap[i]            = heap[(i - 1) / 2];
+      heap[(i - 1) / 2]  = tmp;
+      i                  = (i - 1) / 2;
+    }
+
+    return;
+  }
+
+  if (key <= heap[0].key) {
+    return;
+  }
+
+  heap[0].sample = sample;
+  heap[0].key    = key;
+
+  for (;;) {
+    child = 2 * i + 1;
+
+    if (child >= *n) {
+      break;
+    }
+
+    if (child + 1 < *n && heap[child + 1].key < heap[child].key) {
+      child++;
+    }
+
+    if (heap[i].key <= heap[child].key) {
+      break;
+    }
+
+    tmp         = heap[i];
+    heap[i]     = heap[child];
+    heap[child] = tmp;
+    i           = child;
+  }
+}
+
+static
+int
+top_compare(const void *a, const void *b)
+{
+  double ka = ((const proc_top_t *)a)->key;
+  double kb = ((const proc_top_t *)b)->key;
+
+  return ka < kb ? 1 : ka > kb ? -1 : 0;
+}
+
+/*
+ * Empty a heap into `out', largest first.
+ */
+static
+int
+top_drain(proc_top_t *heap, int n, int *out)
+{
+  int i = 0;
+
+  qsort(heap, n, sizeof(proc_top_t), &top_compare);
+
+  for (i = 0; i < n; i++) {
+    out[i] = heap[i].sample;
+  }
+
+  return n;
+}
+
+/* }}} */
+/* {{{ Scanning: */
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+/*
+ * Read a small file relative to `/proc'.
+ */
+static
+ssize_t
+read_at(const char *path, char *buf, size_t size)
+{
+  ssize_t len = 0;
+  int     fd  = openat(proc_dirfd, path, O_RDONLY);
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  len = read(fd, buf, size - 1);
+  close(fd);
+
+  if (len >= 0) {
+    buf[len] = '\0';
+  }
+
+  return len;
+}
+
+/*
+ * Fill in one sample from `/proc/PID/stat' and `/proc/PID/io'.  Returns
+ * false if the process has gone.
+ *
+ *   1234 (name) S 1 1234 1234 0 -1 4194560 1000 0 0 0 12 5 0 0 20 0 1 ...
+ */
+static
+bool
+read_sample(proc_sample_t *s)
+{
+  procfs_scan_t scan;
+  procfs_scan_t line;
+  procfs_scan_t key;
+  char          path[32];
+  char          buf[1024];
+  const char   *lparen = NULL;
+  const char   *rparen = NULL;
+  ssize_t       len    = 0;
+  int64_t       field[22];
+  int           i      = 0;
+
+  snprintf(path, sizeof(path), "%d/stat", (int)s->pid);
+  len = read_at(path, buf, sizeof(buf));
+
+  if (len <= 0) {
+    return false;
+  }
+
+  /* The name may itself contain parentheses; it ends at the last one. */
+  lparen = memchr(buf, '(', len);
+  rparen = lparen ? strrchr(lparen, ')') : NULL;
+
+  if (rparen == NULL) {
+    return false;
+  }
+
+  len = MIN((size_t)(rparen - lparen - 1), sizeof(s->name) - 1);
+  memcpy(s->name, lparen + 1, len);
+  s->name[len] = '\0';
+
+  procfs_scan_init(&scan, rparen + 1, strlen(rparen + 1));
+  procfs_skip_space(&scan);
+  s->state = procfs_empty(&scan) ? '?' : *scan.pos++;
+
+  /* Fields 4 to 25 of proc(5); some are negative. */
+  for (i = 0; i < 22; i++) {
+    field[i] = procfs_i64(&scan);
+  }
+
+  s->ticks       = (uint64_t)(field[10] + field[11]);
+  s->threads     = (long)field[16];
+  s->start       = (uint64_t)field[18];
+  s->rss         = (uint64_t)field[20] * proc_page;
+  s->read_bytes  = 0;
+  s->write_bytes = 0;
+
+  /* Other users' I/O counters need privilege; do without them. */
+  snprintf(path, sizeof(path), "%d/io", (int)s->pid);
+  len = read_at(path, buf, sizeof(buf));
+
+  if (len > 0) {
+    procfs_scan_init(&scan, buf, len);
+
+    while (procfs_next_line(&scan, &line)) {
+      if (!procfs_split(&line, ':', &key)) {
+        continue;
+      }
+
+      if (procfs_equal(&key, "read_bytes")) {
+        s->read_bytes = procfs_u64(&line);
+      } else if (procfs_equal(&key, "write_bytes")) {
+        s->write_bytes = procfs_u64(&line);
+      }
+    }
+  }
+
+  return true;
+}
+
+static
+void *
+read_samples(void *data)
+{
+  proc_work_t *work = (proc_work_t *)data;
+  int          i    = 0;
+
+  for (i = work->first; i < work->last; i++) {
+    if (!read_sample(&work->samples[i])) {
+      work->samples[i].pid = 0;
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * List the PIDs in /proc into `tab', reading the directory in large
+ * batches through the descriptor kept open for it.
+ */
+static
+void
+list_pids(proc_table_t *tab)
+{
+  proc_dirent_t *ent = NULL;
+  const char    *p   = NULL;
+  long           len = 0;
+  long           off = 0;
+  pid_t          pid = 0;
+
+  tab->count = 0;
+
+  if (lseek(proc_dirfd, 0, SEEK_SET) < 0) {
+    return;
+  }
+
+  while ((len = syscall(SYS_getdents64,
+                        proc_dirfd,
+                        proc_dents,
+                        sizeof(proc_dents))) > 0)
+  {
+    for (off = 0; off < len; off += ent->d_reclen) {
+      ent = (proc_dirent_t *)(proc_dents + off);
+
+      for (p = ent->d_name, pid = 0; *p >= '0' && *p <= '9'; p++) {
+        pid = pid * 10 + (*p - '0');
+      }
+
+      if (*p != '\0' || pid == 0) {
+        continue;
+      }
+
+      proc_table_reserve(tab, tab->count + 1);
+      tab->samples[tab->count++].pid = pid;
+    }
+  }
+}
+
+/*
+ * Read every listed process, sharing the work out between threads when
+ * there is a lot of it, then drop the ones that have gone.
+ */
+static
+void
+read_table(proc_table_t *tab)
+{
+  pthread_t   threads[PROC_MAX_WORKERS];
+  proc_work_t work[PROC_MAX_WORKERS];
+  int         nwork = 1;
+  int         i     = 0;
+  int         j     = 0;
+
+  if (tab->count >= PROC_WORKER_MIN) {
+    nwork = proc_workers;
+  }
+
+  for (i = 0; i < nwork; i++) {
+    work[i].samples = tab->samples;
+    work[i].first   = (int)((long)tab->count * i / nwork);
+    work[i].last    = (int)((long)tab->count * (i + 1) / nwork);
+  }
+
+  /* The calling thread takes the first share itself. */
+  for (i = 1; i < nwork; i++) {
+    if (pthread_create(&threads[i], NULL, &read_samples, &work[i]) != 0) {
+      read_samples(&work[i]);
+      threads[i] = pthread_self();
+    }
+  }
+
+  read_samples(&work[0]);
+
+  for (i = 1; i < nwork; i++) {
+    if (!pthread_equal(threads[i], pthread_self())) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+
+  for (i = 0, j = 0; i < tab->count; i++) {
+    if (tab->samples[i].pid != 0) {
+      tab->samples[j++] = tab->samples[i];
+    }
+  }
+
+  tab->count = j;
+}
+#endif
+
+/*
+ * Work out rates against the previous scan, and the top lists.
+ */
+static
+void
+rate_table(sm_proc_t *ptr, const proc_table_t *prev, double secs)
+{
+  proc_table_t  *tab = &ptr->table;
+  proc_sample_t *s   = NULL;
+  proc_sample_t *old = NULL;
+  proc_top_t     cpu_heap[PROC_TOP_N];
+  proc_top_t     rss_heap[PROC_TOP_N];
+  int            ncpu = 0;
+  int            nrss = 0;
+  int            i    = 0;
+
+  ptr->running = 0;
+  ptr->threads = 0;
+
+  for (i = 0; i < tab->count; i++) {
+    s   = &tab->samples[i];
+    old = proc_table_find(prev, s->pid);
+
+    s->cpu        = 0.0;
+    s->read_rate  = 0.0;
+    s->write_rate = 0.0;
+
+    if (old != NULL && old->start == s->start && secs > 0) {
+      if (s->ticks >= old->ticks) {
+        s->cpu = round2((double)(s->ticks - old->ticks) * 100.0
+                        / (secs * proc_hz));
+      }
+
+      if (s->read_bytes >= old->read_bytes) {
+        s->read_rate = (double)(int64_t)((s->read_bytes - old->read_bytes)
+                                         / secs);
+      }
+
+      if (s->write_bytes >= old->write_bytes) {
+        s->write_rate = (double)(int64_t)((s->write_bytes - old->write_bytes)
+                                          / secs);
+      }
+    }
+
+    if (s->state == 'R') {
+      ptr->running++;
+    }
+
+    ptr->threads += s->threads;
+
+    top_offer(cpu_heap, &ncpu, i, s->cpu);
+    top_offer(rss_heap, &nrss, i, (double)s->rss);
+  }
+
+  ptr->ntop_cpu = top_drain(cpu_heap, ncpu, ptr->top_cpu);
+  ptr->ntop_rss = top_drain(rss_heap, nrss, ptr->top_rss);
+}
+
+/* }}} */
+
+void
+get_proc(void *data)
+{
+  sm_proc_t      *ptr  = (sm_proc_t *)data;
+  proc_table_t    tmp;
+  struct timeval  now;
+  double          secs = 0.0;
+
+  gettimeofday(&now, NULL);
+
+  secs = elapsed_secs(&proc_last, &now);
+
+  /* The latest scan becomes the previous one, and its storage is reused. */
+  tmp        = proc_prev;
+  proc_prev  = ptr->table;
+  ptr->table = tmp;
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+  if (proc_dirfd >= 0) {
+    list_pids(&ptr->table);
+    read_table(&ptr->table);
+  }
+#endif
+
+  proc_table_index(&ptr->table);
+  rate_table(ptr, &proc_prev, secs);
+
+  ptr->time = now.tv_sec;
+  proc_last = now;
+}
+
+void
+proc_timer(timer_clientdata_t data, struct timeval *now)
+{
+#ifdef DEBUG
+  printf("TIMER FIRE - Updating processes\n");
+#endif
+
+  generate_json((sm_base_t *)proc_instance);
+}
+
+static
+void
+write_sample(json_writer_t *w, const proc_sample_t *s)
+{
+  char state[2];
+
+  state[0] = s->state;
+  state[1] = '\0';
+
+  json_write_begin_object(w);
+  json_write_key(w, strPid);
+  json_write_int64(w, s->pid);
+  json_write_key(w, strPName);
+  json_write_string(w, s->name);
+  json_write_key(w, strState);
+  json_write_string(w, state);
+  json_write_key(w, strThreads);
+  json_write_int64(w, s->threads);
+  json_write_key(w, strCpu);
+  json_write_number(w, s->cpu);
+  json_write_key(w, strRss);
+  json_write_uint64(w, s->rss);
+  json_write_key(w, strReadRate);
+  json_write_number(w, s->read_rate);
+  json_write_key(w, strWriteRate);
+  json_write_number(w, s->write_rate);
+  json_write_end_object(w);
+}
+
+static
+void
+write_top(json_writer_t *w, const char *key, const int *top, int n)
+{
+  int i = 0;
+
+  json_write_key(w, key);
+  json_write_begin_array(w);
+
+  for (i = 0; i < n; i++) {
+    write_sample(w, &proc_instance->table.samples[top[i]]);
+  }
+
+  json_write_end_array(w);
+}
+
+/*
+ * The names in the top lists change from scan to scan, so there is no
+ * template here.
+ */
+void
+emit_proc(json_writer_t *out)
+{
+  sm_proc_t *ptr = proc_instance;
+
+  json_write_begin_object(out);
+
+  json_write_key(out, strUpdated);
+  json_write_int64(out, ptr->time);
+  json_write_key(out, strCount);
+  json_write_int64(out, ptr->table.count);
+  json_write_key(out, strRunning);
+  json_write_int64(out, ptr->running);
+  json_write_key(out, strThreads);
+  json_write_int64(out, ptr->threads);
+
+  write_top(out, strTopCpu, ptr->top_cpu, ptr->ntop_cpu);
+  write_top(out, strTopRss, ptr->top_rss, ptr->ntop_rss);
+
+  json_write_end_object(out);
+}
+
+/*
+ * `proc/:pid' -- one process, as of the latest scan.
+ */
+static
+bool
+serve_proc(void *data, const route_match_t *match, json_writer_t *out)
+{
+  sm_proc_t           *ptr   = (sm_proc_t *)data;
+  const route_param_t *param = route_param(match, strPidParam);
+  proc_sample_t       *s     = NULL;
+  size_t               pos   = 0;
+  pid_t                pid   = 0;
+
+  if (param == NULL || param->length == 0 || param->length > 9) {
+    return false;
+  }
+
+  for (pos = 0; pos < param->length; pos++) {
+    if (param->value[pos] < '0' || param->value[pos] > '9') {
+      return false;
+    }
+
+    pid = pid * 10 + (param->value[pos] - '0');
+  }
+
+  s = proc_table_find(&ptr->table, pid);
+
+  if (s == NULL) {
+    return false;
+  }
+
+  write_sample(out, s);
+
+  return true;
+}
+
+void
+sm_proc_init(void)
+{
+  if (proc_instance == NULL) {
+    proc_instance       = xcalloc(1, sizeof(sm_proc_t));
+    proc_instance->vtab = xmalloc(sizeof(sm_vtable_t));
+
+    MAKE_VTABLE(proc_instance, &get_proc, &emit_proc, 0);
+    proc_instance->vtab->serve = &serve_proc;
+
+    memset(&proc_prev, 0, sizeof(proc_prev));
+
+    proc_hz = sysconf(_SC_CLK_TCK);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+    proc_page    = sysconf(_SC_PAGESIZE);
+    proc_workers = (int)MIN(MAX(sysconf(_SC_NPROCESSORS_ONLN), 1),
+                            PROC_MAX_WORKERS);
+    proc_dirfd   = open(strProc, O_RDONLY | O_DIRECTORY);
+
+    if (proc_dirfd < 0) {
+      syslog(LOG_ERR, "Could not open %s: %s", strProc, strerror(errno));
+    }
+#endif
+
+    generate_json((sm_base_t *)proc_instance);
+  }
+
+  if (proc_endpoint == NULL) {
+    proc_endpoint = endpoint_create(strName, proc_instance);
+    endpoint_add_route(proc_endpoint, strPidRoute);
+  }
+
+  if (proc_timer_task == NULL) {
+    timer_clientdata_t data;
+
+    data.l = 0;
+    proc_timer_task = tmr_create(NULL,
+                                 &proc_timer,
+                                 data,
+                                 5000,
+                                 1);
+  }
+}
+
+/* sm_proc.c ends here. */
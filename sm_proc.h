@@ -0,0 +1,105 @@
+/*
+ * sm_proc.h --- Process table.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 18:10:37
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_proc.h
+ * @author Paul Ward
+ * @brief Process table.
+ */
+
+#ifndef _sm_proc_h_
+#define _sm_proc_h_
+
+#include <sys/types.h>
+
+#include "vtable.h"
+
+#ifndef PROC_TOP_N
+# define PROC_TOP_N 10                  /* Length of each top list. */
+#endif
+
+/*
+ * One process, as of the latest scan.  Rates are over the time since the
+ * previous scan, and are zero for a process seen for the first time.
+ */
+typedef struct {
+  pid_t    pid;
+  char     name[16];                    /* `comm', truncated by the kernel. */
+  char     state;
+  long     threads;
+  uint64_t start;                       /* Start time, to spot PID reuse. */
+  uint64_t ticks;                       /* User plus system clock ticks. */
+  uint64_t rss;                         /* Resident set, in bytes. */
+  uint64_t read_bytes;                  /* Storage I/O, if we may see it. */
+  uint64_t write_bytes;
+  double   cpu;                         /* Percent of one CPU. */
+  double   read_rate;                   /* Bytes per second. */
+  double   write_rate;
+} proc_sample_t;
+
+/*
+ * The samples of one scan, with an open-addressing index keyed by PID.
+ */
+typedef struct {
+  proc_sample_t *samples;
+  int            count;
+  int            size;
+  int           *index;                 /* Sample number, or -1. */
+  unsigned       mask;                  /* Size of `index' - 1. */
+} proc_table_t;
+
+typedef struct {
+  sm_vtable_t  *vtab;
+  proc_table_t  table;                  /* Latest scan. */
+  long          running;                /* Processes in state R. */
+  long          threads;                /* Threads across all processes. */
+  int           top_cpu[PROC_TOP_N];    /* Samples, busiest first. */
+  int           ntop_cpu;
+  int           top_rss[PROC_TOP_N];    /* Samples, largest first. */
+  int           ntop_rss;
+  time_t        time;                   /* Update time. */
+} sm_proc_t;
+
+void sm_proc_init(void);
+
+#endif /* !_sm_proc_h_ */
+
+/* sm_proc.h ends here. */
@@ -66,17 +66,18 @@ static const char strPatch[] = "patch";
 static const char strSmVer[] = "smver";
 
 void
-emit_smver(json_node_t **out)
+emit_smver(json_writer_t *out)
 {
-  json_node_t *ret = out ? json_mkobject() : NULL;
+  json_write_begin_object(out);
 
-  json_prepend_member(ret, strMajor,      json_mknumber(VERSION_MAJOR));
-  json_prepend_member(ret, strMinor,      json_mknumber(VERSION_MINOR));
-  json_prepend_member(ret, strPatch,      json_mknumber(VERSION_PATCH));
+  json_write_key(out, strPatch);
+  json_write_int64(out, VERSION_PATCH);
+  json_write_key(out, strMinor);
+  json_write_int64(out, VERSION_MINOR);
+  json_write_key(out, strMajor);
+  json_write_int64(out, VERSION_MAJOR);
 
-  if (out) {
-    *out = ret;
-  }
+  json_write_end_object(out);
 }
 
 void
@@ -0,0 +1,446 @@
+/*
+ * sm_sock.c --- Socket statistics.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 19:41:12
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_sock.c
+ * @author Paul Ward
+ * @brief Socket statistics.
+ */
+
+#include "config.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+# include <netinet/in.h>
+# include <arpa/inet.h>
+# include <linux/netlink.h>
+# include <linux/sock_diag.h>
+# include <linux/inet_diag.h>
+#endif
+
+#include "json.h"
+#include "vtable.h"
+#include "sm_sock.h"
+#include "endpoints.h"
+#include "timers.h"
+#include "utils.h"
+#include "procfs.h"
+
+static endpoint_t   *sock_endpoint   = NULL;
+static sm_sock_t    *sock_instance   = NULL;
+static timer_task_t *sock_timer_task = NULL;
+
+static const char strName[]         = "sock";
+static const char strUpdated[]      = "updatedAt";
+static const char strTcp[]          = "tcp";
+static const char strUdp[]          = "udp";
+static const char strTotal[]        = "total";
+static const char strConnected[]    = "connected";
+static const char strUnconnected[]  = "unconnected";
+static const char strListeners[]    = "listeners";
+static const char strAddress[]      = "address";
+static const char strPort[]         = "port";
+static const char strQueue[]        = "queue";
+static const char strBacklog[]      = "backlog";
+static const char strOverflows[]    = "listenOverflows";
+static const char strDrops[]        = "listenDrops";
+
+static const char *tcp_state_names[SOCK_TCP_NSTATES] = {
+  NULL,
+  "established",
+  "synSent",
+  "synRecv",
+  "finWait1",
+  "finWait2",
+  "timeWait",
+  "close",
+  "closeWait",
+  "lastAck",
+  "listen",
+  "closing",
+  "newSynRecv"
+};
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static const char strNetstat[]      = "/proc/net/netstat";
+
+/*
+ * Dumps are read in batches this large; each socket costs a little under
+ * a hundred bytes, as no extensions are asked for.
+ */
+#define SOCK_RECV_SIZE 65536
+
+typedef void (*sock_visit_t)(sm_sock_t *, const struct inet_diag_msg *);
+
+static int            sock_fd      = -1;
+static uint32_t       sock_seq     = 0;
+static char          *sock_buf     = NULL;
+static procfs_file_t  netstat_file;
+#endif
+
+/* {{{ Netlink: */
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+static
+void
+count_tcp(sm_sock_t *ptr, const struct inet_diag_msg *msg)
+{
+  sock_listener_t *l = NULL;
+
+  if (msg->idiag_state > 0 && msg->idiag_state < SOCK_TCP_NSTATES) {
+    ptr->tcp[msg->idiag_state]++;
+  }
+
+  if (msg->idiag_state != SOCK_TCP_LISTEN) {
+    return;
+  }
+
+  if (ptr->nlisteners == ptr->max_listeners) {
+    ptr->max_listeners = ptr->max_listeners ? ptr->max_listeners * 2 : 16;
+    ptr->listeners     = xrealloc(ptr->listeners,
+                                  ptr->max_listeners
+                                  * sizeof(sock_listener_t));
+  }
+
+  l = &ptr->listeners[ptr->nlisteners++];
+
+  inet_ntop(msg->idiag_family,
+            msg->id.idiag_src,
+            l->address,
+            sizeof(l->address));
+
+  /* For a listener these are the accept queue and its limit. */
+  l->port    = ntohs(msg->id.idiag_sport);
+  l->queue   = msg->idiag_rqueue;
+  l->backlog = msg->idiag_wqueue;
+}
+
+static
+void
+count_udp(sm_sock_t *ptr, const struct inet_diag_msg *msg)
+{
+  if (msg->idiag_state == SOCK_TCP_ESTABLISHED) {
+    ptr->udp_connected++;
+  } else {
+    ptr->udp_unconnected++;
+  }
+}
+
+/*
+ * Dump the sockets of one family and protocol in the given states, which
+ * the kernel filters on, handing each to `visit'.
+ */
+static
+bool
+sock_dump(sm_sock_t    *ptr,
+          int           family,
+          int           protocol,
+          uint32_t      states,
+          sock_visit_t  visit)
+{
+  struct {
+    struct nlmsghdr         nlh;
+    struct inet_diag_req_v2 req;
+  } msg;
+  const struct nlmsghdr *nlh = NULL;
+  const struct nlmsgerr *err = NULL;
+  ssize_t                len = 0;
+
+  memset(&msg, 0, sizeof(msg));
+
+  msg.nlh.nlmsg_len      = sizeof(msg);
+  msg.nlh.nlmsg_type     = SOCK_DIAG_BY_FAMILY;
+  msg.nlh.nlmsg_flags    = NLM_F_REQUEST | NLM_F_DUMP;
+  msg.nlh.nlmsg_seq      = ++sock_seq;
+  msg.req.sdiag_family   = family;
+  msg.req.sdiag_protocol = protocol;
+  msg.req.idiag_states   = states;
+
+  if (send(sock_fd, &msg, sizeof(msg), 0) < 0) {
+    syslog(LOG_ERR, "Could not send sock_diag request: %s", strerror(errno));
+    return false;
+  }
+
+  for (;;) {
+    len = recv(sock_fd, sock_buf, SOCK_RECV_SIZE, 0);
+
+    if (len < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      syslog(LOG_ERR, "Could not read sock_diag reply: %s", strerror(errno));
+      return false;
+    }
+
+    for (nlh = (const struct nlmsghdr *)sock_buf;
+         NLMSG_OK(nlh, len);
+         nlh = NLMSG_NEXT(nlh, len))
+    {
+      if (nlh->nlmsg_seq != sock_seq) {
+        continue;
+      }
+
+      if (nlh->nlmsg_type == NLMSG_DONE) {
+        return true;
+      }
+
+      if (nlh->nlmsg_type == NLMSG_ERROR) {
+        err = (const struct nlmsgerr *)NLMSG_DATA(nlh);
+
+        /* No IPv6, or no UDP diagnostics module; nothing to count. */
+        if (err->error != -ENOENT) {
+          syslog(LOG_ERR, "sock_diag request failed: %s",
+                 strerror(-err->error));
+        }
+
+        return false;
+      }
+
+      visit(ptr, (const struct inet_diag_msg *)NLMSG_DATA(nlh));
+    }
+  }
+}
+
+/*
+ * Pick `ListenOverflows' and `ListenDrops' out of the `TcpExt:' lines of
+ * /proc/net/netstat, which come as a line of names and a line of values.
+ */
+static
+void
+read_listen_drops(sm_sock_t *ptr)
+{
+  procfs_scan_t scan;
+  procfs_scan_t names;
+  procfs_scan_t values;
+  procfs_scan_t name;
+
+  if (procfs_read(&netstat_file) < 0) {
+    return;
+  }
+
+  procfs_scan_file(&scan, &netstat_file);
+
+  while (procfs_next_line(&scan, &names)) {
+    if (!procfs_prefix(&names, "TcpExt:")) {
+      continue;
+    }
+
+    if (!procfs_next_line(&scan, &values) ||
+        !procfs_prefix(&values, "TcpExt:"))
+    {
+      return;
+    }
+
+    while (procfs_next_token(&names, &name)) {
+      if (procfs_equal(&name, "ListenOverflows")) {
+        ptr->listen_overflows = procfs_u64(&values);
+      } else if (procfs_equal(&name, "ListenDrops")) {
+        ptr->listen_drops = procfs_u64(&values);
+      } else {
+        procfs_u64(&values);
+      }
+    }
+
+    return;
+  }
+}
+#endif
+
+/* }}} */
+
+void
+get_sock(void *data)
+{
+  sm_sock_t *ptr = (sm_sock_t *)data;
+
+  memset(ptr->tcp, 0, sizeof(ptr->tcp));
+  ptr->udp_connected   = 0;
+  ptr->udp_unconnected = 0;
+  ptr->nlisteners      = 0;
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+  if (sock_fd >= 0) {
+    /* Every state we report on, and none we do not. */
+    uint32_t tcp_states = ((1u << SOCK_TCP_NSTATES) - 1) & ~1u;
+    uint32_t udp_states = (1u << SOCK_TCP_ESTABLISHED) |
+                          (1u << SOCK_TCP_CLOSE);
+
+    sock_dump(ptr, AF_INET,  IPPROTO_TCP, tcp_states, &count_tcp);
+    sock_dump(ptr, AF_INET6, IPPROTO_TCP, tcp_states, &count_tcp);
+    sock_dump(ptr, AF_INET,  IPPROTO_UDP, udp_states, &count_udp);
+    sock_dump(ptr, AF_INET6, IPPROTO_UDP, udp_states, &count_udp);
+  }
+
+  read_listen_drops(ptr);
+#endif
+
+  ptr->time = time(NULL);
+}
+
+void
+sock_timer(timer_clientdata_t data, struct timeval *now)
+{
+#ifdef DEBUG
+  printf("TIMER FIRE - Updating sockets\n");
+#endif
+
+  generate_json((sm_base_t *)sock_instance);
+}
+
+/*
+ * The listeners come and go, so there is no template here.
+ */
+void
+emit_sock(json_writer_t *out)
+{
+  sm_sock_t       *ptr   = sock_instance;
+  sock_listener_t *l     = NULL;
+  uint64_t         total = 0;
+  int              i     = 0;
+
+  json_write_begin_object(out);
+
+  json_write_key(out, strUpdated);
+  json_write_int64(out, ptr->time);
+
+  json_write_key(out, strTcp);
+  json_write_begin_object(out);
+
+  for (i = SOCK_TCP_ESTABLISHED; i < SOCK_TCP_NSTATES; i++) {
+    json_write_key(out, tcp_state_names[i]);
+    json_write_uint64(out, ptr->tcp[i]);
+    total += ptr->tcp[i];
+  }
+
+  json_write_key(out, strTotal);
+  json_write_uint64(out, total);
+  json_write_end_object(out);
+
+  json_write_key(out, strUdp);
+  json_write_begin_object(out);
+  json_write_key(out, strConnected);
+  json_write_uint64(out, ptr->udp_connected);
+  json_write_key(out, strUnconnected);
+  json_write_uint64(out, ptr->udp_unconnected);
+  json_write_key(out, strTotal);
+  json_write_uint64(out, ptr->udp_connected + ptr->udp_unconnected);
+  json_write_end_object(out);
+
+  json_write_key(out, strOverflows);
+  json_write_uint64(out, ptr->listen_overflows);
+  json_write_key(out, strDrops);
+  json_write_uint64(out, ptr->listen_drops);
+
+  json_write_key(out, strListeners);
+  json_write_begin_array(out);
+
+  for (i = 0; i < ptr->nlisteners; i++) {
+    l = &ptr->listeners[i];
+
+    json_write_begin_object(out);
+    json_write_key(out, strAddress);
+    json_write_string(out, l->address);
+    json_write_key(out, strPort);
+    json_write_int64(out, l->port);
+    json_write_key(out, strQueue);
+    json_write_uint64(out, l->queue);
+    json_write_key(out, strBacklog);
+    json_write_uint64(out, l->backlog);
+    json_write_end_object(out);
+  }
+
+  json_write_end_array(out);
+
+  json_write_end_object(out);
+}
+
+void
+sm_sock_init(void)
+{
+  if (sock_instance == NULL) {
+    sock_instance       = xcalloc(1, sizeof(sm_sock_t));
+    sock_instance->vtab = xmalloc(sizeof(sm_vtable_t));
+
+    MAKE_VTABLE(sock_instance, &get_sock, &emit_sock, 0);
+
+#if PLATFORM_EQ(PLATFORM_LINUX)
+    sock_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+
+    if (sock_fd < 0) {
+      syslog(LOG_ERR, "Could not open sock_diag socket: %s", strerror(errno));
+    } else {
+      sock_buf = xmalloc(SOCK_RECV_SIZE);
+    }
+
+    procfs_open(&netstat_file, strNetstat, 8192);
+#endif
+
+    generate_json((sm_base_t *)sock_instance);
+  }
+
+  if (sock_endpoint == NULL) {
+    sock_endpoint = endpoint_create(strName, sock_instance);
+  }
+
+  if (sock_timer_task == NULL) {
+    timer_clientdata_t data;
+
+    data.l = 0;
+    sock_timer_task = tmr_create(NULL,
+                                 &sock_timer,
+                                 data,
+                                 5000,
+                                 1);
+  }
+}
+
+/* sm_sock.c ends here. */
@@ -0,0 +1,102 @@
+/*
+ * sm_sock.h --- Socket statistics.
+ *
+ * Copyright (c) 2016 Paul Ward <asmodai@gmail.com>
+ *
+ * Author:     Paul Ward <asmodai@gmail.com>
+ * Maintainer: Paul Ward <asmodai@gmail.com>
+ * Created:    19 Oct 2026 19:41:05
+ */
+/* {{{ License: */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer. 
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/* }}} */
+/* {{{ Commentary: */
+/*
+ *
+ */
+/* }}} */
+
+/**
+ * @file sm_sock.h
+ * @author Paul Ward
+ * @brief Socket statistics.
+ */
+
+#ifndef _sm_sock_h_
+#define _sm_sock_h_
+
+#include <sys/types.h>
+
+#include "vtable.h"
+
+/*
+ * TCP states, numbered as the kernel numbers them; slot 0 is unused.
+ */
+typedef enum {
+  SOCK_TCP_ESTABLISHED = 1,
+  SOCK_TCP_SYN_SENT,
+  SOCK_TCP_SYN_RECV,
+  SOCK_TCP_FIN_WAIT1,
+  SOCK_TCP_FIN_WAIT2,
+  SOCK_TCP_TIME_WAIT,
+  SOCK_TCP_CLOSE,
+  SOCK_TCP_CLOSE_WAIT,
+  SOCK_TCP_LAST_ACK,
+  SOCK_TCP_LISTEN,
+  SOCK_TCP_CLOSING,
+  SOCK_TCP_NEW_SYN_RECV,
+  SOCK_TCP_NSTATES
+} sock_tcp_state_t;
+
+/*
+ * A listening TCP socket.  `queue' is the number of connections waiting
+ * to be accepted; `backlog' is the most there may be.
+ */
+typedef struct {
+  char     address[46];                 /* INET6_ADDRSTRLEN */
+  uint16_t port;
+  uint32_t queue;
+  uint32_t backlog;
+} sock_listener_t;
+
+typedef struct {
+  sm_vtable_t     *vtab;
+  uint64_t         tcp[SOCK_TCP_NSTATES];
+  uint64_t         udp_connected;
+  uint64_t         udp_unconnected;
+  uint64_t         listen_overflows;    /* Since boot, all listeners. */
+  uint64_t         listen_drops;
+  sock_listener_t *listeners;
+  int              nlisteners;
+  int              max_listeners;
+  time_t           time;                /* Update time. */
+} sm_sock_t;
+
+void sm_sock_init(void);
+
+#endif /* !_sm_sock_h_ */
+
+/* sm_sock.h ends here. */
@@ -79,25 +79,29 @@ static const char strMachine[]  = "machine";
 static const char strName[]     = "uname";
 
 void
-emit_uname(json_node_t **out)
+emit_uname(json_writer_t *out)
 {
-  struct utsname  name;
-  json_node_t    *ret = out ? json_mkobject() : NULL;
+  struct utsname name;
 
   if ((uname(&name) != 0)) {
     perror("Unable to get uname from kernel");
     exit(1);
   }
 
-  json_prepend_member(ret, strSysName,  json_mkstring(name.sysname));
-  json_prepend_member(ret, strNodeName, json_mkstring(name.nodename));
-  json_prepend_member(ret, strRelease,  json_mkstring(name.release));
-  json_prepend_member(ret, strVersion,  json_mkstring(name.version));
-  json_prepend_member(ret, strMachine,  json_mkstring(name.machine));
+  json_write_begin_object(out);
 
-  if (out) {
-    *out = ret;
-  }
+  json_write_key(out, strMachine);
+  json_write_string(out, name.machine);
+  json_write_key(out, strVersion);
+  json_write_string(out, name.version);
+  json_write_key(out, strRelease);
+  json_write_string(out, name.release);
+  json_write_key(out, strNodeName);
+  json_write_string(out, name.nodename);
+  json_write_key(out, strSysName);
+  json_write_string(out, name.sysname);
+
+  json_write_end_object(out);
 }
 
 void
@@ -104,25 +104,36 @@ xcalloc(size_t nelem, size_t elsize)
   return newmem;
 }
 
+/*
+ * 32-bit FNV-1a, finished with MurmurHash3's avalanche so that the low
+ * bits can index a table directly.  `seed' perturbs the start state; it is
+ * how `mkroutes' searches for a collision-free route table.
+ */
 unsigned long
-pjw_hash(const char *s)
+str_hash_seeded(const char *s, unsigned long seed)
 {
-  unsigned long h    = 0;
-  unsigned long high = 0;
+  unsigned long h = (2166136261UL ^ seed) & 0xFFFFFFFFUL;
 
   while (*s) {
-    h = (h << 4) + *s++;
-
-    if ((high = h & 0xF0000000)) {
-      h ^= high >> 24;
-    }
-
-    h &= ~high;
+    h ^= (unsigned char)*s++;
+    h  = (h * 16777619UL) & 0xFFFFFFFFUL;
   }
 
+  h ^= h >> 16;
+  h  = (h * 0x85EBCA6BUL) & 0xFFFFFFFFUL;
+  h ^= h >> 13;
+  h  = (h * 0xC2B2AE35UL) & 0xFFFFFFFFUL;
+  h ^= h >> 16;
+
   return h;
 }
 
+unsigned long
+str_hash(const char *s)
+{
+  return str_hash_seeded(s, 0);
+}
+
 static
 int
 hexit(char c)
@@ -169,4 +180,27 @@ skip_space(const char **ptr)
   *ptr = s;
 }
 
+/*
+ * Seconds from `last' to `now', or zero if there is no `last' yet.
+ */
+double
+elapsed_secs(const struct timeval *last, const struct timeval *now)
+{
+  if (last->tv_sec == 0) {
+    return 0.0;
+  }
+
+  return (double)(now->tv_sec - last->tv_sec) +
+    (double)(now->tv_usec - last->tv_usec) / 1000000.0;
+}
+
+/*
+ * `val' rounded to two places, as rates and percentages are reported.
+ */
+double
+round2(double val)
+{
+  return (double)(int64_t)(val * 100.0 + 0.5) / 100.0;
+}
+
 /* utils.c ends here. */
@@ -49,6 +49,7 @@
 #define _utils_h_
 
 #include <sys/types.h>
+#include <sys/time.h>
 
 #ifndef MAX
 # define MAX(__a, __b)     ((__a) > (__b) ? (__a) : (__b))
@@ -63,9 +64,12 @@
 void          *xmalloc(size_t);
 void          *xrealloc(void *, size_t);
 void          *xcalloc(size_t, size_t);
-unsigned long  pjw_hash(const char *);
+unsigned long  str_hash(const char *);
+unsigned long  str_hash_seeded(const char *, unsigned long);
 void           strdecode(char *, const char *);
 void           skip_space(const char **);
+double         elapsed_secs(const struct timeval *, const struct timeval *);
+double         round2(double);
 
 #endif /* !_utils_h_ */
 
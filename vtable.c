@@ -51,11 +51,12 @@
 #include "vtable.h"
 #include "utils.h"
 #include "sm_all.h"
+#include "sm_metrics.h"
 
 void
 generate_json(sm_base_t *inst)
 {
-  json_node_t *node = json_mkobject();
+  json_writer_t *writer = &inst->vtab->writer;
 
   if (inst->vtab->only_once == 1 &&
       inst->vtab->done_once == 1)
@@ -63,20 +64,90 @@ generate_json(sm_base_t *inst)
     return;
   }
 
-  MAYBE_FREE(inst->vtab->json_buffer);
-
   if (inst->vtab->get_data != NULL) {
     (inst->vtab->get_data)(inst);
   }
 
   if (inst->vtab->emit_json != NULL) {
-    (inst->vtab->emit_json)(&node);
-    inst->vtab->json_buffer = json_stringify(node, NULL);
-    inst->vtab->json_length = strlen(inst->vtab->json_buffer);
-    json_delete(node);
+    json_writer_reset(writer);
+    (inst->vtab->emit_json)(writer);
+
+    inst->vtab->json_buffer = json_writer_finish(writer);
+    inst->vtab->json_length = json_writer_length(writer);
+    inst->vtab->done_once   = 1;
+    inst->vtab->generation++;
 
     sm_all_update(inst);
+    sm_metrics_update(inst);
+  }
+}
+
+/*
+ * Return `inst's document in the given encoding, storing its length in
+ * `*len'.  Non-JSON encodings are written by `emit_json' from the state
+ * that made `json_buffer', and cached until the next generation.  Modules
+ * that do not produce JSON are returned as they are.  Returns NULL if there
+ * is no document.
+ */
+const char *
+encode_json(sm_base_t *inst, sm_encoding_t encoding, size_t *len)
+{
+  sm_vtable_t  *vt  = inst->vtab;
+  sm_encoded_t *enc = NULL;
+
+  if (vt->json_buffer == NULL) {
+    return NULL;
+  }
+
+  if (encoding == SM_ENCODING_JSON || vt->content_type != NULL) {
+    *len = vt->json_length;
+    return vt->json_buffer;
+  }
+
+  enc = &vt->encoded[encoding];
+
+  if (enc->buffer == NULL) {
+    json_writer_init(&enc->writer);
+    json_writer_set_format(&enc->writer, (json_format_t)encoding);
+  }
+
+  if (enc->buffer == NULL || enc->generation != vt->generation) {
+    json_writer_reset(&enc->writer);
+    (vt->emit_json)(&enc->writer);
+
+    enc->buffer     = json_writer_finish(&enc->writer);
+    enc->length     = json_writer_length(&enc->writer);
+    enc->generation = vt->generation;
   }
+
+  *len = enc->length;
+
+  return enc->buffer;
+}
+
+/*
+ * Return the member index of `inst's JSON document, building it if the
+ * document has changed since it was last asked for.  Returns NULL if there
+ * is no JSON document.
+ */
+const json_index_t *
+index_json(sm_base_t *inst)
+{
+  sm_vtable_t *vt = inst->vtab;
+
+  if (vt->json_buffer == NULL || vt->content_type != NULL) {
+    return NULL;
+  }
+
+  if (vt->index_generation != vt->generation) {
+    if (!json_index_build(&vt->index, vt->json_buffer, vt->json_length)) {
+      return NULL;
+    }
+
+    vt->index_generation = vt->generation;
+  }
+
+  return &vt->index;
 }
 
 /* vtable.c ends here. */
@@ -48,7 +48,10 @@
 #ifndef _vtable_h_
 #define _vtable_h_
 
+#include <string.h>
+
 #include "json.h"
+#include "router.h"
 
 #define MAKE_VTABLE(__inst, __get, __emit, __once) \
   (__inst)->vtab->get_data    = (__get);           \
@@ -56,18 +59,57 @@
   (__inst)->vtab->only_once   = (__once);          \
   (__inst)->vtab->json_buffer = NULL;              \
   (__inst)->vtab->json_length = 0;                 \
-  (__inst)->vtab->done_once   = 0
+  (__inst)->vtab->done_once   = 0;                 \
+  (__inst)->vtab->all_slot    = -1;                \
+  (__inst)->vtab->generation  = 1;                 \
+  (__inst)->vtab->content_type = NULL;             \
+  (__inst)->vtab->serve       = NULL;              \
+  (__inst)->vtab->index_generation = 0;            \
+  json_index_init(&(__inst)->vtab->index);         \
+  memset((__inst)->vtab->encoded,                  \
+         0,                                        \
+         sizeof((__inst)->vtab->encoded));         \
+  json_writer_init(&(__inst)->vtab->writer)
+
+/*
+ * Response encodings.  Modules write JSON as they generate; the others are
+ * written by the same `emit_json' when first asked for.
+ */
+typedef enum {
+  SM_ENCODING_JSON    = JSON_FORMAT_TEXT,
+  SM_ENCODING_CBOR    = JSON_FORMAT_CBOR,
+  SM_ENCODING_MSGPACK = JSON_FORMAT_MSGPACK,
+  SM_ENCODING_MAX
+} sm_encoding_t;
+
+/*
+ * A cached non-JSON rendition of `json_buffer'.
+ */
+typedef struct {
+  json_writer_t  writer;
+  char          *buffer;
+  size_t         length;
+  unsigned long  generation;            /* Generation it was made from. */
+} sm_encoded_t;
 
 /*
  * Virtual function table.
  */
 typedef struct {
-  void   (*get_data)(void *);
-  void   (*emit_json)(json_node_t **);
-  char    *json_buffer;
-  size_t   json_length;
-  int      only_once;
-  int      done_once;
+  void          (*get_data)(void *);
+  void          (*emit_json)(json_writer_t *);
+  json_writer_t   writer;               /* Owns `json_buffer'. */
+  char           *json_buffer;
+  size_t          json_length;
+  int             only_once;
+  int             done_once;
+  int             all_slot;             /* Position within `/all'. */
+  unsigned long   generation;           /* Bumped when `json_buffer' changes. */
+  const char     *content_type;         /* If not JSON, what `json_buffer' is. */
+  bool          (*serve)(void *, const route_match_t *, json_writer_t *);
+  sm_encoded_t    encoded[SM_ENCODING_MAX];
+  json_index_t    index;                /* Members of `json_buffer'. */
+  unsigned long   index_generation;     /* Generation `index' describes. */
 } sm_vtable_t;
 
 /*
@@ -79,7 +121,9 @@ typedef struct {
   sm_vtable_t *vtab;                    /* Virtual function table. */
 } sm_base_t;
 
-void generate_json(sm_base_t *);
+void        generate_json(sm_base_t *);
+const char *encode_json(sm_base_t *, sm_encoding_t, size_t *);
+const json_index_t *index_json(sm_base_t *);
 
 #endif /* !_vtable_h_ */
 